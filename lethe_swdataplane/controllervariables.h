@@ -0,0 +1,25 @@
+#pragma once
+
+// Variables of the Lethe controller (lethe_controller.cpp), the constants of lethe_loadbalancer/controller.py
+
+// Default number of WARM/HOT objects (slb_hash values in table loadbal)
+#define N_HOT 1200
+
+// Default number of the most popular objects that are HOT, the others are WARM1 or WARM2
+#define N_TOP_HOT 100
+
+// Default update interval in milliseconds (INTERVAL_T)
+#define INTERVAL_MS 1000
+
+// Popularity after an interval: POPULARITY_DECAY * popularity + POPULARITY_WEIGHT * requests of the interval
+#define POPULARITY_DECAY 0.5
+#define POPULARITY_WEIGHT 0.7
+
+// Objects whose popularity decayed below this are forgotten
+#define POPULARITY_MIN 1.0
+
+// Default number of objects whose popularity is tracked (space-saving top-K)
+#define POPULARITY_CAPACITY (4 * N_HOT)
+
+// Commands sent to the data plane before their responses are read
+#define CONTROL_PIPELINE_DEPTH 256
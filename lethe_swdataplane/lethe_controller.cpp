@@ -0,0 +1,459 @@
+/* Lethe controller "lethe_controller"
+ * Native version of lethe_loadbalancer/controller.py for the software data plane (lethe_swdataplane.cpp), fast enough
+ * for sub-second update intervals.
+ * Algorithm (every interval "run_interval"):
+ * - Read and reset the request counters of the data plane (register counterReg) in one command, so no requests are
+ *   lost between reading and resetting "read_counters"
+ * - Decay the popularity of all objects and add the requests of the interval. The popularity is kept in an
+ *   exponentially decayed space-saving top-K (popularity_topk.h) instead of a dictionary of all objects "update_popularity"
+ * - The N_HOT most popular objects are at least WARM, the N_TOP_HOT most popular of them are HOT. The other objects
+ *   are put on the stack (WARM1 or WARM2) with the lower sum of popularity, from the least popular on, like
+ *   routine_basic "classify"
+ * - Only the difference to the entries of table loadbal is applied: table_delete for objects that aren't WARM/HOT
+ *   anymore, table_modify for objects whose hotness changed, table_add for new objects. The commands are pipelined,
+ *   and objects never fall back to COLD while the table is updated "apply_delta"
+ * - After an interval without requests (following one with requests), the popularity and table loadbal are reset
+ * The processing time of every interval and its number of table operations are printed.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <csignal>
+#include <cstring>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "pipelinevariables.h"
+#include "controllervariables.h"
+#include "popularity_topk.h"
+
+// hotness of the loadbal actions (same values as mcdslb.p4)
+#define HOTNESS_COLD 0
+#define HOTNESS_WARM1 1
+#define HOTNESS_HOT 2
+#define HOTNESS_WARM2 3
+
+const char *loadbal_actions[] = {"set_server_cold", "set_server_warm1", "set_server_hot", "set_server_warm2"};
+
+int control_port = CONTROL_PORT;
+int interval_ms = INTERVAL_MS;
+int n_hot = N_HOT;
+int n_top_hot = N_TOP_HOT;
+int popularity_capacity = POPULARITY_CAPACITY;
+int max_intervals = 0;
+
+std::atomic<bool> stop_requested(false);
+std::atomic<bool> reset_requested(false);
+
+// connection to the control API of the data plane
+struct control_connection
+{
+    int fd;
+    std::string buffer;  // received, not yet parsed
+};
+
+// entry of table loadbal
+struct loadbal_entry
+{
+    uint32_t handle;
+    uint8_t hotness;
+};
+
+struct interval_stats
+{
+    uint64_t requests;
+    double read_ms;
+    double classify_ms;
+    double update_ms;
+    int adds;
+    int modifies;
+    int deletes;
+    int errors;
+    int hot;
+    int warm1;
+    int warm2;
+    double warm1_sum;
+    double warm2_sum;
+};
+
+control_connection control;
+popularity_topk popularity;
+std::unordered_map<uint32_t, loadbal_entry> loadbal;  // entries of table loadbal by slb_hash
+uint16_t counters[REGISTER_SIZE];
+bool had_requests = false;
+
+bool control_connect(control_connection &c, int port)
+{
+    c.fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (connect(c.fd, (sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(c.fd);
+        return false;
+    }
+    int one = 1;
+    setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    c.buffer.clear();
+    return true;
+}
+
+bool control_write(control_connection &c, const std::string &commands)
+{
+    for (size_t written = 0; written < commands.size();) {
+        ssize_t n = send(c.fd, commands.data() + written, commands.size() - written, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        written += n;
+    }
+    return true;
+}
+
+/* reads the response to the next command (terminated by an empty line) */
+bool control_read_response(control_connection &c, std::string &response)
+{
+    size_t end;
+    for (;;) {
+        // an empty response is a single newline, any other is terminated by an empty line
+        if (!c.buffer.empty() && c.buffer[0] == '\n') {
+            end = 0;
+            break;
+        }
+        if ((end = c.buffer.find("\n\n")) != std::string::npos) {
+            break;
+        }
+        char buf[65536];
+        ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+        if (n <= 0) {
+            return false;
+        }
+        c.buffer.append(buf, n);
+    }
+    response.assign(c.buffer, 0, end);
+    c.buffer.erase(0, end == 0 ? 1 : end + 2);
+    return true;
+}
+
+/* runs {commands} (one per entry) with up to CONTROL_PIPELINE_DEPTH commands in flight and stores their responses */
+bool control_run(control_connection &c, const std::vector<std::string> &commands, std::vector<std::string> &responses)
+{
+    responses.resize(commands.size());
+    for (size_t start = 0; start < commands.size(); start += CONTROL_PIPELINE_DEPTH) {
+        size_t end = std::min(commands.size(), start + CONTROL_PIPELINE_DEPTH);
+        std::string batch;
+        for (size_t i = start; i < end; i++) {
+            batch += commands[i] + "\n";
+        }
+        if (!control_write(c, batch)) {
+            return false;
+        }
+        for (size_t i = start; i < end; i++) {
+            if (!control_read_response(c, responses[i])) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool control_command(control_connection &c, const std::string &command, std::string &response)
+{
+    return control_write(c, command + "\n") && control_read_response(c, response);
+}
+
+inline double elapsed_ms(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+/* reads and resets counterReg into {counters}, returns the sum of the requests */
+bool read_counters(uint64_t *requests)
+{
+    std::string response;
+    if (!control_command(control, "register_read_reset counterReg", response) || response.compare(0, 12, "counterReg= ") != 0) {
+        std::cout << "Can't read counterReg: " << response << std::endl;
+        return false;
+    }
+    const char *p = response.c_str() + 12;
+    *requests = 0;
+    for (uint32_t i = 0; i < REGISTER_SIZE && *p != '\0'; i++) {
+        char *end;
+        counters[i] = strtoul(p, &end, 10);
+        *requests += counters[i];
+        p = *end == ',' ? end + 2 : end;
+    }
+    return true;
+}
+
+void update_popularity()
+{
+    topk_decay(popularity, POPULARITY_DECAY);
+    topk_prune(popularity, POPULARITY_MIN);
+    for (uint32_t i = 0; i < REGISTER_SIZE; i++) {
+        if (counters[i] != 0) {
+            topk_add(popularity, i, POPULARITY_WEIGHT * counters[i]);
+        }
+    }
+}
+
+/* hotness of the n_hot most popular objects in {hotness} (slb_hash -> hotness) */
+void classify(std::unordered_map<uint32_t, uint8_t> &hotness, interval_stats &s)
+{
+    std::vector<std::pair<double, uint32_t>> objects;  // popularity, slb_hash
+    objects.reserve(popularity.heap.size());
+    for (const topk_entry &e : popularity.heap) {
+        objects.push_back({topk_popularity(popularity, e), e.key});
+    }
+    // the n_hot most popular objects, least popular first
+    size_t n = std::min(objects.size(), (size_t)n_hot);
+    std::partial_sort(objects.begin(), objects.begin() + n, objects.end(), std::greater<std::pair<double, uint32_t>>());
+    objects.resize(n);
+    std::reverse(objects.begin(), objects.end());
+
+    s.warm1_sum = s.warm2_sum = 0;
+    for (size_t i = 0; i < objects.size(); i++) {
+        uint32_t key = objects[i].second;
+        if (i + n_top_hot >= objects.size()) {
+            hotness[key] = HOTNESS_HOT;
+            s.hot++;
+        } else if (s.warm1_sum > s.warm2_sum) {
+            hotness[key] = HOTNESS_WARM2;
+            s.warm2_sum += objects[i].first;
+            s.warm2++;
+        } else {
+            hotness[key] = HOTNESS_WARM1;
+            s.warm1_sum += objects[i].first;
+            s.warm1++;
+        }
+    }
+}
+
+/* brings table loadbal from its current entries to {hotness}: deletes first (to make room), then modifies and adds.
+ * The local view is only changed for commands the data plane accepted, so a rejected command is sent again in the
+ * next interval */
+bool apply_delta(const std::unordered_map<uint32_t, uint8_t> &hotness, interval_stats &s)
+{
+    std::vector<std::string> commands;
+    std::vector<uint32_t> keys;  // slb_hash of every command
+    for (auto &it : loadbal) {
+        if (!hotness.count(it.first)) {
+            commands.push_back("table_delete loadbal " + std::to_string(it.second.handle));
+            keys.push_back(it.first);
+            s.deletes++;
+        }
+    }
+    size_t first_modify = commands.size();
+    for (auto &it : hotness) {
+        auto entry = loadbal.find(it.first);
+        if (entry != loadbal.end() && entry->second.hotness != it.second) {
+            commands.push_back("table_modify loadbal " + std::string(loadbal_actions[it.second]) + " " + std::to_string(entry->second.handle));
+            keys.push_back(it.first);
+            s.modifies++;
+        }
+    }
+    size_t first_add = commands.size();
+    for (auto &it : hotness) {
+        if (!loadbal.count(it.first)) {
+            commands.push_back("table_add loadbal " + std::string(loadbal_actions[it.second]) + " " + std::to_string(it.first) + " =>");
+            keys.push_back(it.first);
+            s.adds++;
+        }
+    }
+
+    std::vector<std::string> responses;
+    if (!control_run(control, commands, responses)) {
+        return false;
+    }
+    for (size_t i = 0; i < commands.size(); i++) {
+        if (responses[i].compare(0, 6, "Error:") == 0) {
+            s.errors++;
+            if (s.errors == 1) {
+                std::cout << commands[i] << ": " << responses[i] << std::endl;
+            }
+            continue;
+        }
+        uint32_t key = keys[i];
+        if (i < first_modify) {
+            loadbal.erase(key);
+        } else if (i < first_add) {
+            loadbal[key].hotness = hotness.at(key);
+        } else {
+            size_t pos = responses[i].rfind(' ');
+            loadbal[key] = {(uint32_t)std::stoul(responses[i].substr(pos + 1)), hotness.at(key)};
+        }
+    }
+    return true;
+}
+
+/* removes all entries of table loadbal and forgets the popularity */
+bool reset_loadbal()
+{
+    std::string response;
+    loadbal.clear();
+    topk_clear(popularity);
+    return control_command(control, "table_clear loadbal", response) && control_command(control, "register_reset counterReg", response);
+}
+
+bool run_interval(int interval, double period_ms, interval_stats &s)
+{
+    memset(&s, 0, sizeof(s));
+    auto start = std::chrono::steady_clock::now();
+    if (!read_counters(&s.requests)) {
+        return false;
+    }
+    auto read_end = std::chrono::steady_clock::now();
+    s.read_ms = elapsed_ms(start, read_end);
+
+    if (s.requests == 0 && had_requests) {
+        std::cout << "Interval " << interval << ": no requests, reset table loadbal" << std::endl;
+        had_requests = false;
+        return reset_loadbal();
+    }
+    had_requests = had_requests || s.requests > 0;
+
+    update_popularity();
+    std::unordered_map<uint32_t, uint8_t> hotness;
+    classify(hotness, s);
+    auto classify_end = std::chrono::steady_clock::now();
+    s.classify_ms = elapsed_ms(read_end, classify_end);
+
+    if (!apply_delta(hotness, s)) {
+        return false;
+    }
+    s.update_ms = elapsed_ms(classify_end, std::chrono::steady_clock::now());
+
+    std::cout << "Interval " << interval << ": " << period_ms << "ms - " << s.requests << " requests - read " << s.read_ms << "ms, classify " << s.classify_ms << "ms, update " << s.update_ms << "ms"
+              << " - table ops: " << s.adds << " add, " << s.modifies << " modify, " << s.deletes << " delete" << (s.errors > 0 ? " (" + std::to_string(s.errors) + " failed)" : "")
+              << " - HOT " << s.hot << " - WARM1 " << s.warm1 << " (" << s.warm1_sum << ") - WARM2 " << s.warm2 << " (" << s.warm2_sum << ")" << std::endl;
+    return true;
+}
+
+bool parse_cmdline(int argc, char const *argv[])
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        std::string name = arg.substr(0, arg.find('='));
+        std::string value = arg.find('=') != std::string::npos ? arg.substr(arg.find('=') + 1) : "";
+
+        if (name == "--control") {
+            control_port = std::stoi(value);
+        } else if (name == "--interval") {
+            interval_ms = std::stoi(value);
+        } else if (name == "--hot") {
+            n_hot = std::stoi(value);
+        } else if (name == "--top-hot") {
+            n_top_hot = std::stoi(value);
+        } else if (name == "--capacity") {
+            popularity_capacity = std::stoi(value);
+        } else if (name == "--intervals") {
+            max_intervals = std::stoi(value);
+        } else {
+            std::cout << "Usage: ./lethe_controller [options]" << std::endl;
+            std::cout << "Options: --control=<port> TCP port of the control API of the data plane on 127.0.0.1 (default " << CONTROL_PORT << ")" << std::endl;
+            std::cout << "         --interval=<ms> update interval (default " << INTERVAL_MS << ")" << std::endl;
+            std::cout << "         --hot=<n> number of WARM/HOT objects (default " << N_HOT << ")" << std::endl;
+            std::cout << "         --top-hot=<n> number of HOT objects, the most popular of the WARM/HOT objects (default " << N_TOP_HOT << ")" << std::endl;
+            std::cout << "         --capacity=<n> number of objects whose popularity is tracked (default " << POPULARITY_CAPACITY << ")" << std::endl;
+            std::cout << "         --intervals=<n> stop after n intervals (default 0: until SIGINT)" << std::endl;
+            return false;
+        }
+    }
+    if (interval_ms < 1) {
+        std::cout << "Interval must be at least 1ms" << std::endl;
+        return false;
+    }
+    if (n_hot < 0 || n_hot > LOADBAL_TABLE_SIZE || n_top_hot < 0 || n_top_hot > n_hot) {
+        std::cout << "Number of WARM/HOT objects must be between 0 and " << LOADBAL_TABLE_SIZE << " and at least the number of HOT objects" << std::endl;
+        return false;
+    }
+    if (popularity_capacity < n_hot) {
+        std::cout << "Popularity capacity must be at least the number of WARM/HOT objects" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void handle_signal(int signal)
+{
+    if (signal == SIGUSR1) {
+        reset_requested.store(true);
+    } else {
+        stop_requested.store(true);
+    }
+}
+
+int main(int argc, char const *argv[])
+{
+    std::cout << "Lethe controller" << std::endl;
+
+    if (!parse_cmdline(argc, argv)) {
+        return 1;
+    }
+    if (!control_connect(control, control_port)) {
+        std::cout << "Can't connect to the control API 127.0.0.1:" << control_port << ": " << strerror(errno) << std::endl;
+        return 1;
+    }
+    topk_init(popularity, popularity_capacity);
+    if (!reset_loadbal()) {
+        std::cout << "Can't reset the data plane" << std::endl;
+        return 1;
+    }
+    std::cout << "Interval: " << interval_ms << "ms - WARM/HOT objects: " << n_hot << " - HOT objects: " << n_top_hot << " - Popularity capacity: " << popularity_capacity << std::endl;
+
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+    signal(SIGUSR1, handle_signal);
+
+    // intervals on a fixed schedule, the processing time doesn't shift it
+    auto next = std::chrono::steady_clock::now() + std::chrono::milliseconds(interval_ms);
+    auto last = std::chrono::steady_clock::now();
+    int intervals = 0;
+    double sum_processing_ms = 0, max_processing_ms = 0;
+    uint64_t sum_ops = 0, max_ops = 0;
+    while (!stop_requested.load() && (max_intervals == 0 || intervals < max_intervals)) {
+        std::this_thread::sleep_until(next);
+        next += std::chrono::milliseconds(interval_ms);
+        auto now = std::chrono::steady_clock::now();
+        if (now > next) {
+            // an interval took longer than the interval time: skip the missed intervals
+            next = now + std::chrono::milliseconds(interval_ms);
+        }
+
+        if (reset_requested.exchange(false)) {
+            std::cout << "Reset register counterReg and table loadbal" << std::endl;
+            if (!reset_loadbal()) {
+                break;
+            }
+        }
+
+        interval_stats s;
+        if (!run_interval(++intervals, elapsed_ms(last, now), s)) {
+            std::cout << "Lost the connection to the data plane" << std::endl;
+            break;
+        }
+        last = now;
+        double processing_ms = s.read_ms + s.classify_ms + s.update_ms;
+        uint64_t ops = s.adds + s.modifies + s.deletes;
+        sum_processing_ms += processing_ms;
+        max_processing_ms = std::max(max_processing_ms, processing_ms);
+        sum_ops += ops;
+        max_ops = std::max(max_ops, ops);
+    }
+
+    if (intervals > 0) {
+        std::cout << "Intervals: " << intervals << " - processing time avg. " << sum_processing_ms / intervals << "ms, max. " << max_processing_ms << "ms - table ops avg. " << (double)sum_ops / intervals << ", max. " << max_ops << std::endl;
+    }
+    close(control.fd);
+    return 0;
+}
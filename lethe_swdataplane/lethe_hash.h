@@ -0,0 +1,66 @@
+#pragma once
+
+// Hash functions of the Lethe data plane, bit-compatible with the BMV2 hash algorithms used by p4src/mcdslb.p4
+//
+// crc32 is HashAlgorithm.crc32 (CRC-32/ISO-HDLC as in zlib), used for slb_hash = crc32(key) mod REGISTER_SIZE.
+// crc16 is HashAlgorithm.crc16 (CRC-16/ARC), used for the ecmp hash of HOT objects over the request id.
+
+#include <cstddef>
+#include <cstdint>
+
+/* lookup table of the reflected CRC-32 polynomial 0xEDB88320 */
+inline const uint32_t *crc32_table()
+{
+    static const struct table
+    {
+        uint32_t entries[256];
+        table()
+        {
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t crc = i;
+                for (int bit = 0; bit < 8; bit++) {
+                    crc = (crc >> 1) ^ (crc & 1 ? 0xEDB88320 : 0);
+                }
+                entries[i] = crc;
+            }
+        }
+    } t;
+    return t.entries;
+}
+
+inline uint32_t crc32(const void *data, size_t len)
+{
+    const uint32_t *table = crc32_table();
+    const uint8_t *p = (const uint8_t *)data;
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
+/* CRC-16/ARC (reflected polynomial 0xA001, initial value 0) */
+inline uint16_t crc16(const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    uint16_t crc = 0;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= p[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (crc & 1 ? 0xA001 : 0);
+        }
+    }
+    return crc;
+}
+
+/* slb_hash of a key: the index of its counterReg entry and the match key of table loadbal */
+inline uint32_t slb_hash(const char *key, size_t key_len, uint32_t register_size)
+{
+    return crc32(key, key_len) % register_size;
+}
+
+/* ecmp hash of a HOT object: the request id (bytes 0-1 of the frame header, network byte order) mod {num_servers} */
+inline uint32_t ecmp_hash_hot(const char *frame_header, uint32_t num_servers)
+{
+    return crc16(frame_header, 2) % num_servers;
+}
@@ -0,0 +1,809 @@
+/* Lethe Memcached stand-in server "lethe_mcserver"
+ * Multi-threaded Memcached UDP server with the protocol of Memcached patched with memcached_lethe.patch, to run the
+ * caches and the database of the client - data plane - cache - database path on one Linux box at rates a stock
+ * Memcached build doesn't reach:
+ * - bytes 6-7 of the frame header (letheinfo) of a request are returned in every datagram of its response
+ * - the responses to get/gat end with "END <key>\r\n" (the last key of the request) instead of "END\r\n", also after a
+ *   hit, so the data plane can redirect cache misses to the database
+ * Commands (text protocol, one or more per datagram): get, gat, set, delete, flush_all, version. Requests of more than
+ * one datagram are dropped like in Memcached.
+ *
+ * Implementation:
+ * - Worker threads with one SO_REUSEPORT socket on the listen address each "worker_task", datagrams are received with
+ *   recvmmsg and sent with sendmmsg
+ * - Items are stored in a preallocated slab hash table with expiration times and LRU eviction, split into shards with
+ *   a lock each (slab_store.h)
+ * - Service time (--service-time): every worker is a single-server queue. A request is processed when it arrives, but
+ *   its response is held back in the response queue of the worker "queue_response" until the worker would have
+ *   served it after the requests before it. The capacity of the server is threads / service time and the response
+ *   times include the queueing delay, without busy-waiting, so slow database tiers and caches can share the cores
+ * - TCP (Memcached port 11211) for the TCP fill phase of mcloadgen_static, one thread per connection "tcp_task",
+ *   without service time
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <csignal>
+#include <cstring>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/prctl.h>
+#include <sys/timerfd.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include "pipelinevariables.h"
+#include "mcservervariables.h"
+#include "slab_store.h"
+
+// Memcached UDP frame header: request id, sequence number, number of datagrams, letheinfo
+#define FRAME_HEADER_LEN 8
+
+// maximum number of tokens of a command line (memcached MAX_TOKENS), the keys of get/gat are not limited
+#define MAX_TOKENS 24
+
+// exptimes above this are unix times, below relative times in seconds (memcached REALTIME_MAXDELTA)
+#define REALTIME_MAXDELTA (60 * 60 * 24 * 30)
+
+// epoll data of the sockets of a worker
+#define EPOLL_SOCKET 0
+#define EPOLL_TIMER 1
+
+std::string listen_address = "127.0.0.2";
+int udp_port = MEMCACHED_UDP_PORT;
+int tcp_port = MEMCACHED_TCP_PORT;
+int num_worker_threads = NUM_WORKER_THREADS;
+size_t memory_mb = STORE_MEMORY_MB;
+int64_t service_time_ns = SERVICE_TIME_US * 1000;
+
+std::atomic<bool> stop_requested(false);
+
+slab_store store;
+
+struct server_stats
+{
+    std::atomic<uint64_t> datagrams;
+    std::atomic<uint64_t> multi_datagram;  // requests of more than one datagram (dropped)
+    std::atomic<uint64_t> queue_full;      // requests dropped because the response queue was full
+    std::atomic<uint64_t> get_hits;
+    std::atomic<uint64_t> get_misses;
+    std::atomic<uint64_t> gat_hits;
+    std::atomic<uint64_t> gat_misses;
+    std::atomic<uint64_t> sets;
+    std::atomic<uint64_t> set_failed;      // too large or out of memory
+    std::atomic<uint64_t> delete_hits;
+    std::atomic<uint64_t> delete_misses;
+    std::atomic<uint64_t> errors;          // ERROR and CLIENT_ERROR responses, incomplete commands
+    std::atomic<uint64_t> truncated;       // responses with values left out
+    std::atomic<uint64_t> send_errors;
+    std::atomic<uint64_t> tcp_connections;
+};
+
+struct worker
+{
+    int id;
+    int fd;
+    int timer_fd;
+    int epoll_fd;
+    std::thread thread;
+
+    // receive batch
+    mmsghdr rx_msgs[IO_BATCH_SIZE];
+    iovec rx_iov[IO_BATCH_SIZE];
+    sockaddr_in rx_addr[IO_BATCH_SIZE];
+    char *rx_bufs;
+
+    // response of the current request
+    char *response_buf;
+
+    // response queue: ring of datagrams that are sent when they are due
+    mmsghdr queue_msgs[RESPONSE_QUEUE_SIZE];
+    iovec queue_iov[RESPONSE_QUEUE_SIZE];
+    sockaddr_in queue_addr[RESPONSE_QUEUE_SIZE];
+    int64_t queue_due_ns[RESPONSE_QUEUE_SIZE];
+    char *queue_bufs;
+    unsigned queue_head;
+    unsigned queue_len;
+    int64_t busy_until_ns;   // the worker has served all queued requests at this time
+    int64_t timer_due_ns;    // time the timer is armed for, 0: disarmed
+
+    server_stats stats;
+};
+
+std::vector<worker *> workers;
+
+// stats of the TCP connections, one per connection
+std::mutex tcp_stats_lock;
+std::vector<server_stats *> tcp_stats;
+
+/* increments a counter of the thread's own stats (single writer) */
+inline void count(std::atomic<uint64_t> &counter, uint64_t n = 1)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+inline int64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* time of the expiration times of the items, always > 0 */
+inline int64_t coarse_now_s()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return ts.tv_sec + 1;
+}
+
+/* expiration time of an item with exptime {exptime} of a command: 0 never, up to REALTIME_MAXDELTA seconds from
+ * now, otherwise a unix time. Negative exptimes and unix times in the past expire immediately */
+inline int64_t item_exptime(int64_t exptime, int64_t now_s)
+{
+    if (exptime == 0) {
+        return 0;
+    }
+    if (exptime > REALTIME_MAXDELTA) {
+        exptime -= time(nullptr);
+    }
+    return exptime > 0 ? now_s + exptime : 1;
+}
+
+/*
+ * Text protocol
+ */
+
+struct token
+{
+    const char *s;
+    size_t len;
+};
+
+/* the next token of {line} from position {pos} on, false at the end of the line */
+inline bool next_token(const char *line, size_t len, size_t *pos, token *t)
+{
+    size_t i = *pos;
+    while (i < len && line[i] == ' ') {
+        i++;
+    }
+    size_t start = i;
+    while (i < len && line[i] != ' ') {
+        i++;
+    }
+    *pos = i;
+    *t = {line + start, i - start};
+    return i > start;
+}
+
+inline bool token_is(const token &t, const char *s)
+{
+    return t.len == strlen(s) && memcmp(t.s, s, t.len) == 0;
+}
+
+/* parses the decimal number {t}, optionally negative */
+inline bool parse_int(const token &t, int64_t *value)
+{
+    size_t i = t.len > 0 && t.s[0] == '-' ? 1 : 0;
+    if (i == t.len || t.len - i > 18) {
+        return false;
+    }
+    int64_t v = 0;
+    for (size_t j = i; j < t.len; j++) {
+        if (t.s[j] < '0' || t.s[j] > '9') {
+            return false;
+        }
+        v = v * 10 + (t.s[j] - '0');
+    }
+    *value = i == 1 ? -v : v;
+    return true;
+}
+
+// responses of the commands are appended to a response buffer
+struct response
+{
+    char *data;
+    size_t len;
+    size_t size;
+    int fd;          // TCP: the buffer is written to the connection when it is full. UDP (-1): values that don't fit are left out
+    bool truncated;
+};
+
+bool write_all(int fd, const char *data, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+/* true if {n} more bytes fit into response {r} */
+inline bool response_room(response &r, size_t n)
+{
+    if (r.len + n > r.size && r.fd >= 0 && n <= r.size && write_all(r.fd, r.data, r.len)) {
+        r.len = 0;
+    }
+    return r.len + n <= r.size;
+}
+
+/* appends {n} bytes to response {r}, which must have room for them (response_room), except for the short status
+ * lines, for which a response always has room (see process_commands) */
+inline void response_append(response &r, const char *s, size_t n)
+{
+    memcpy(r.data + r.len, s, n);
+    r.len += n;
+}
+
+inline void response_append(response &r, const char *s)
+{
+    response_append(r, s, strlen(s));
+}
+
+inline void response_append_number(response &r, uint64_t v)
+{
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = '0' + v % 10;
+        v /= 10;
+    } while (v != 0);
+    while (n > 0) {
+        r.data[r.len++] = digits[--n];
+    }
+}
+
+// room for the status line of a command and the "END <key>" line of a get/gat
+#define STATUS_LINE_SIZE (KEY_SIZE_MAX + 64)
+
+/* get/gat "<get|gat> [exptime] <key>*": "VALUE <key> <flags> <bytes>\r\n<data>\r\n" per item found, then
+ * "END <last key>\r\n" (memcached_lethe.patch) */
+void process_get(const char *line, size_t len, size_t pos, bool touch, response &r, server_stats &stats, int64_t now_s)
+{
+    int64_t exptime = 0;
+    token t;
+    if (touch && !(next_token(line, len, &pos, &t) && parse_int(t, &exptime))) {
+        response_append(r, "CLIENT_ERROR invalid exptime argument\r\n");
+        count(stats.errors);
+        return;
+    }
+    int64_t exptime_s = item_exptime(exptime, now_s);
+    token key = {nullptr, 0};
+    while (next_token(line, len, &pos, &t)) {
+        key = t;
+        if (key.len > KEY_SIZE_MAX) {
+            response_append(r, "CLIENT_ERROR bad command line format\r\n");
+            count(stats.errors);
+            return;
+        }
+        bool hit = store_get(store, key.s, key.len, now_s, touch, exptime_s, [&](store_item *it) {
+            if (!response_room(r, 6 + it->nkey + 24 + it->nbytes + 2 + STATUS_LINE_SIZE)) {
+                r.truncated = true;
+                return;
+            }
+            response_append(r, "VALUE ", 6);
+            response_append(r, item_key(it), it->nkey);
+            response_append(r, " ", 1);
+            response_append_number(r, it->flags);
+            response_append(r, " ", 1);
+            response_append_number(r, it->nbytes);
+            response_append(r, "\r\n", 2);
+            response_append(r, item_data(it), it->nbytes);
+            response_append(r, "\r\n", 2);
+        });
+        count(touch ? (hit ? stats.gat_hits : stats.gat_misses) : (hit ? stats.get_hits : stats.get_misses));
+    }
+    if (key.len == 0) {
+        response_append(r, "ERROR\r\n");
+        count(stats.errors);
+        return;
+    }
+    response_append(r, "END ", 4);
+    response_append(r, key.s, key.len);
+    response_append(r, "\r\n", 2);
+}
+
+/* processes the commands in {buf} and appends their responses to {r}. Returns the number of bytes used: a command
+ * whose line or data isn't complete is left for the next read (TCP), or dropped if {complete} (UDP, the datagram is
+ * the whole request) */
+size_t process_commands(const char *buf, size_t len, bool complete, response &r, server_stats &stats, int64_t now_s)
+{
+    size_t used = 0;
+    while (used < len) {
+        const char *line = buf + used;
+        const char *eol = (const char *)memchr(line, '\n', len - used);
+        if (eol == nullptr || !response_room(r, STATUS_LINE_SIZE)) {
+            if (complete) {
+                count(stats.errors);
+                used = len;
+            }
+            break;
+        }
+        size_t line_len = eol - line;
+        if (line_len > 0 && line[line_len - 1] == '\r') {
+            line_len--;
+        }
+        size_t next = eol + 1 - buf;
+
+        token tokens[MAX_TOKENS];
+        int n = 0;
+        size_t pos = 0;
+        while (n < MAX_TOKENS && next_token(line, line_len, &pos, &tokens[n])) {
+            n++;
+        }
+        bool noreply = n > 1 && token_is(tokens[n - 1], "noreply");
+        size_t response_start = r.len;
+
+        if (n == 0) {
+            // empty line
+        } else if (token_is(tokens[0], "get") || token_is(tokens[0], "gat")) {
+            size_t keys = tokens[0].s + tokens[0].len - line;
+            process_get(line, line_len, keys, tokens[0].s[1] == 'a', r, stats, now_s);
+        } else if (token_is(tokens[0], "set")) {
+            // "set <key> <flags> <exptime> <bytes> [noreply]\r\n<data>\r\n"
+            int64_t flags, exptime, nbytes;
+            if ((n != 5 && n != 6) || tokens[1].len > KEY_SIZE_MAX || !parse_int(tokens[2], &flags) || !parse_int(tokens[3], &exptime) || !parse_int(tokens[4], &nbytes) || flags < 0 || flags > UINT32_MAX || nbytes < 0) {
+                response_append(r, "CLIENT_ERROR bad command line format\r\n");
+                count(stats.errors);
+                if (complete) {
+                    used = len;
+                    break;
+                }
+                used = next;
+                continue;
+            }
+            if (len - next < (size_t)nbytes + 2) {
+                if (complete) {
+                    response_append(r, "CLIENT_ERROR bad data chunk\r\n");
+                    count(stats.errors);
+                    used = len;
+                }
+                break;
+            }
+            const char *data = buf + next;
+            next += nbytes + 2;
+            if (data[nbytes] != '\r' || data[nbytes + 1] != '\n') {
+                response_append(r, "CLIENT_ERROR bad data chunk\r\n");
+                count(stats.errors);
+            } else {
+                int result = store_set(store, tokens[1].s, tokens[1].len, flags, item_exptime(exptime, now_s), data, nbytes, now_s);
+                if (result == STORE_STORED) {
+                    response_append(r, "STORED\r\n");
+                    count(stats.sets);
+                } else {
+                    response_append(r, result == STORE_TOO_LARGE ? "SERVER_ERROR object too large for cache\r\n" : "SERVER_ERROR out of memory storing object\r\n");
+                    count(stats.set_failed);
+                }
+            }
+        } else if (token_is(tokens[0], "delete")) {
+            // "delete <key> [0] [noreply]"
+            if (n < 2 || n > 4 || tokens[1].len > KEY_SIZE_MAX || n - noreply > 3 || (n - noreply == 3 && !token_is(tokens[2], "0"))) {
+                response_append(r, "CLIENT_ERROR bad command line format.  Usage: delete <key> [noreply]\r\n");
+                count(stats.errors);
+            } else if (store_delete(store, tokens[1].s, tokens[1].len, now_s)) {
+                response_append(r, "DELETED\r\n");
+                count(stats.delete_hits);
+            } else {
+                response_append(r, "NOT_FOUND\r\n");
+                count(stats.delete_misses);
+            }
+        } else if (token_is(tokens[0], "flush_all")) {
+            store_flush(store);
+            response_append(r, "OK\r\n");
+        } else if (token_is(tokens[0], "version")) {
+            response_append(r, "VERSION 1.6.18-lethe\r\n");
+        } else {
+            response_append(r, "ERROR\r\n");
+            count(stats.errors);
+        }
+        if (noreply) {
+            r.len = response_start;
+        }
+        used = next;
+    }
+    return used;
+}
+
+/*
+ * UDP workers
+ */
+
+/* sends the datagrams of the response queue that are due at {now} */
+void send_due(worker *w, int64_t now)
+{
+    while (w->queue_len > 0 && w->queue_due_ns[w->queue_head] <= now) {
+        unsigned run = 1;
+        while (run < w->queue_len && w->queue_head + run < RESPONSE_QUEUE_SIZE && w->queue_due_ns[w->queue_head + run] <= now) {
+            run++;
+        }
+        int n = sendmmsg(w->fd, &w->queue_msgs[w->queue_head], run, MSG_DONTWAIT);
+        if (n <= 0) {
+            // the socket buffer is full, drop the datagrams (like a full NIC queue)
+            count(w->stats.send_errors, run);
+            n = run;
+        }
+        w->queue_head = (w->queue_head + n) % RESPONSE_QUEUE_SIZE;
+        w->queue_len -= n;
+    }
+}
+
+/* arms the timer of worker {w} for the first datagram of the response queue that isn't due yet */
+void arm_timer(worker *w)
+{
+    int64_t due = w->queue_len > 0 ? w->queue_due_ns[w->queue_head] : 0;
+    if (due == w->timer_due_ns) {
+        return;
+    }
+    itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.it_value.tv_sec = due / 1000000000;
+    spec.it_value.tv_nsec = due % 1000000000;
+    timerfd_settime(w->timer_fd, TFD_TIMER_ABSTIME, &spec, nullptr);
+    w->timer_due_ns = due;
+}
+
+/* adds response {r} to request {request} of the client at {client} to the response queue, as datagrams of at most
+ * UDP_PAYLOAD_SIZE bytes with the request id and the letheinfo of the request */
+void queue_response(worker *w, const sockaddr_in &client, const char *request, const response &r, int64_t due)
+{
+    const size_t payload = UDP_PAYLOAD_SIZE - FRAME_HEADER_LEN;
+    unsigned total = (r.len + payload - 1) / payload;
+    if (w->queue_len + total > RESPONSE_QUEUE_SIZE) {
+        count(w->stats.queue_full);
+        return;
+    }
+    for (unsigned seq = 0; seq < total; seq++) {
+        unsigned slot = (w->queue_head + w->queue_len++) % RESPONSE_QUEUE_SIZE;
+        char *d = w->queue_bufs + (size_t)slot * UDP_PAYLOAD_SIZE;
+        size_t len = std::min(payload, r.len - seq * payload);
+        d[0] = request[0];
+        d[1] = request[1];
+        d[2] = seq >> 8;
+        d[3] = seq & 0xFF;
+        d[4] = total >> 8;
+        d[5] = total & 0xFF;
+        d[6] = request[6];
+        d[7] = request[7];
+        memcpy(d + FRAME_HEADER_LEN, r.data + seq * payload, len);
+        w->queue_iov[slot].iov_len = FRAME_HEADER_LEN + len;
+        w->queue_addr[slot] = client;
+        w->queue_due_ns[slot] = due;
+    }
+}
+
+/* a request datagram {d} of the client at {client}, which arrived at {now} */
+void request_datagram(worker *w, const sockaddr_in &client, const char *d, size_t len, int64_t now, int64_t now_s)
+{
+    count(w->stats.datagrams);
+    if (d[4] != 0 || d[5] != 1) {
+        count(w->stats.multi_datagram);
+        return;
+    }
+    if (w->queue_len >= RESPONSE_QUEUE_SIZE) {
+        count(w->stats.queue_full);
+        return;
+    }
+    response r = {w->response_buf, 0, RESPONSE_SIZE_MAX, -1, false};
+    process_commands(d + FRAME_HEADER_LEN, len - FRAME_HEADER_LEN, true, r, w->stats, now_s);
+    if (r.truncated) {
+        count(w->stats.truncated);
+    }
+    int64_t due = now;
+    if (service_time_ns > 0) {
+        due = std::max(now, w->busy_until_ns) + service_time_ns;
+        w->busy_until_ns = due;
+    }
+    if (r.len > 0) {
+        queue_response(w, client, d, r, due);
+    }
+}
+
+/* receives one batch of requests and processes it */
+void receive_batch(worker *w)
+{
+    for (int i = 0; i < IO_BATCH_SIZE; i++) {
+        w->rx_iov[i].iov_base = w->rx_bufs + (size_t)i * DATAGRAM_SIZE;
+        w->rx_iov[i].iov_len = DATAGRAM_SIZE;
+        w->rx_msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+    }
+    int n = recvmmsg(w->fd, w->rx_msgs, IO_BATCH_SIZE, MSG_DONTWAIT, nullptr);
+    if (n <= 0) {
+        return;
+    }
+    int64_t now = now_ns();
+    int64_t now_s = coarse_now_s();
+    for (int i = 0; i < n; i++) {
+        size_t len = w->rx_msgs[i].msg_len;
+        if ((w->rx_msgs[i].msg_hdr.msg_flags & MSG_TRUNC) || len < FRAME_HEADER_LEN) {
+            count(w->stats.datagrams);
+            count(w->stats.errors);
+            continue;
+        }
+        request_datagram(w, w->rx_addr[i], (char *)w->rx_iov[i].iov_base, len, now, now_s);
+    }
+}
+
+void worker_task(worker *w)
+{
+    // wake up at the due time of a response, not up to 50us later (default timer slack)
+    prctl(PR_SET_TIMERSLACK, 1);
+    epoll_event events[2];
+    while (!stop_requested.load(std::memory_order_relaxed)) {
+        int n = epoll_wait(w->epoll_fd, events, 2, 100);
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.u64 == EPOLL_SOCKET) {
+                receive_batch(w);
+            } else {
+                uint64_t expirations;
+                if (read(w->timer_fd, &expirations, sizeof(expirations)) > 0) {
+                    w->timer_due_ns = 0;
+                }
+            }
+        }
+        send_due(w, now_ns());
+        arm_timer(w);
+    }
+}
+
+/* opens the socket of worker {id}. Returns false if the listen address can't be bound */
+bool setup_worker(worker *w, int id)
+{
+    w->id = id;
+    w->rx_bufs = new char[(size_t)IO_BATCH_SIZE * DATAGRAM_SIZE];
+    w->response_buf = new char[RESPONSE_SIZE_MAX];
+    w->queue_bufs = new char[(size_t)RESPONSE_QUEUE_SIZE * UDP_PAYLOAD_SIZE];
+    w->queue_head = 0;
+    w->queue_len = 0;
+    w->busy_until_ns = 0;
+    w->timer_due_ns = 0;
+    for (int i = 0; i < IO_BATCH_SIZE; i++) {
+        memset(&w->rx_msgs[i], 0, sizeof(mmsghdr));
+        w->rx_msgs[i].msg_hdr.msg_name = &w->rx_addr[i];
+        w->rx_msgs[i].msg_hdr.msg_iov = &w->rx_iov[i];
+        w->rx_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    for (int i = 0; i < RESPONSE_QUEUE_SIZE; i++) {
+        memset(&w->queue_msgs[i], 0, sizeof(mmsghdr));
+        w->queue_iov[i].iov_base = w->queue_bufs + (size_t)i * UDP_PAYLOAD_SIZE;
+        w->queue_msgs[i].msg_hdr.msg_name = &w->queue_addr[i];
+        w->queue_msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        w->queue_msgs[i].msg_hdr.msg_iov = &w->queue_iov[i];
+        w->queue_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(udp_port);
+    inet_pton(AF_INET, listen_address.c_str(), &addr.sin_addr);
+    int one = 1;
+    int buffer_size = 4 * 1024 * 1024;
+    w->fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    setsockopt(w->fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+    setsockopt(w->fd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+    setsockopt(w->fd, SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+    if (bind(w->fd, (sockaddr *)&addr, sizeof(addr)) < 0) {
+        std::cout << "Can't bind UDP " << listen_address << ":" << udp_port << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    w->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+
+    w->epoll_fd = epoll_create1(0);
+    epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.u64 = EPOLL_SOCKET;
+    epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, w->fd, &ev);
+    ev.data.u64 = EPOLL_TIMER;
+    epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, w->timer_fd, &ev);
+    return true;
+}
+
+/*
+ * TCP
+ */
+
+/* one TCP connection: commands are processed as soon as they are complete, responses are written per read */
+void tcp_connection_task(int fd, server_stats *stats)
+{
+    char *in = new char[RESPONSE_SIZE_MAX];
+    char *out = new char[RESPONSE_SIZE_MAX];
+    size_t in_len = 0;
+    while (!stop_requested.load(std::memory_order_relaxed)) {
+        ssize_t n = read(fd, in + in_len, RESPONSE_SIZE_MAX - in_len);
+        if (n <= 0) {
+            break;
+        }
+        in_len += n;
+        response r = {out, 0, RESPONSE_SIZE_MAX, fd, false};
+        size_t used = process_commands(in, in_len, false, r, *stats, coarse_now_s());
+        if (r.len > 0 && !write_all(fd, r.data, r.len)) {
+            break;
+        }
+        memmove(in, in + used, in_len - used);
+        in_len -= used;
+        if (in_len == RESPONSE_SIZE_MAX) {
+            // a command larger than the buffer
+            count(stats->errors);
+            break;
+        }
+    }
+    close(fd);
+    delete[] in;
+    delete[] out;
+}
+
+/* accepts TCP connections on the listen address until the server is stopped */
+void tcp_task(int listen_fd)
+{
+    pollfd p = {listen_fd, POLLIN, 0};
+    while (!stop_requested.load()) {
+        if (poll(&p, 1, 100) <= 0) {
+            continue;
+        }
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            continue;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        server_stats *stats = new server_stats();
+        count(stats->tcp_connections);
+        {
+            std::lock_guard<std::mutex> guard(tcp_stats_lock);
+            tcp_stats.push_back(stats);
+        }
+        std::thread(tcp_connection_task, fd, stats).detach();
+    }
+}
+
+int open_tcp_socket()
+{
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(tcp_port);
+    inet_pton(AF_INET, listen_address.c_str(), &addr.sin_addr);
+    int one = 1;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(fd, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 16) < 0) {
+        std::cout << "Can't listen on TCP " << listen_address << ":" << tcp_port << ": " << strerror(errno) << std::endl;
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* sum of a counter of all workers and TCP connections */
+uint64_t sum_stats(std::atomic<uint64_t> server_stats::*counter)
+{
+    uint64_t sum = 0;
+    for (worker *w : workers) {
+        sum += (w->stats.*counter).load(std::memory_order_relaxed);
+    }
+    std::lock_guard<std::mutex> guard(tcp_stats_lock);
+    for (server_stats *s : tcp_stats) {
+        sum += (s->*counter).load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+void print_stats()
+{
+    store_stats s = store_sum_stats(store);
+    std::cout << "UDP datagrams: " << sum_stats(&server_stats::datagrams) << " - dropped: " << sum_stats(&server_stats::multi_datagram) << " of more than one datagram, " << sum_stats(&server_stats::queue_full) << " response queue full - send errors: " << sum_stats(&server_stats::send_errors) << " - TCP connections: " << sum_stats(&server_stats::tcp_connections) << std::endl;
+    std::cout << "GET hits/misses: " << sum_stats(&server_stats::get_hits) << "/" << sum_stats(&server_stats::get_misses) << " - GAT hits/misses: " << sum_stats(&server_stats::gat_hits) << "/" << sum_stats(&server_stats::gat_misses) << " - SET: " << sum_stats(&server_stats::sets) << " (failed: " << sum_stats(&server_stats::set_failed) << ") - DELETE hits/misses: " << sum_stats(&server_stats::delete_hits) << "/" << sum_stats(&server_stats::delete_misses) << std::endl;
+    std::cout << "errors: " << sum_stats(&server_stats::errors) << " - truncated responses: " << sum_stats(&server_stats::truncated) << std::endl;
+    std::cout << "items: " << s.items << " - evictions: " << s.evictions << " - expired: " << s.expired << " - out of memory: " << s.out_of_memory << " - pages used: " << s.pages_used << "/" << s.pages << std::endl;
+}
+
+bool parse_cmdline(int argc, char const *argv[])
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        std::string name = arg.substr(0, arg.find('='));
+        std::string value = arg.find('=') != std::string::npos ? arg.substr(arg.find('=') + 1) : "";
+
+        if (name == "--listen") {
+            struct in_addr a;
+            listen_address = value;
+            if (inet_pton(AF_INET, value.c_str(), &a) != 1) {
+                std::cout << "Invalid listen address " << value << std::endl;
+                return false;
+            }
+        } else if (name == "--udp-port") {
+            udp_port = std::stoi(value);
+        } else if (name == "--tcp-port") {
+            tcp_port = std::stoi(value);
+        } else if (name == "--threads") {
+            num_worker_threads = std::stoi(value);
+        } else if (name == "--memory") {
+            memory_mb = std::stoul(value);
+        } else if (name == "--service-time") {
+            service_time_ns = (int64_t)(std::stod(value) * 1000);
+        } else {
+            std::cout << "Usage: ./lethe_mcserver [options]" << std::endl;
+            std::cout << "Options: --listen=<ip> address of the server (default 127.0.0.2)" << std::endl;
+            std::cout << "         --udp-port=<port> UDP port (default " << MEMCACHED_UDP_PORT << ")" << std::endl;
+            std::cout << "         --tcp-port=<port> TCP port, 0: no TCP (default " << MEMCACHED_TCP_PORT << ")" << std::endl;
+            std::cout << "         --threads=<n> number of worker threads (default " << NUM_WORKER_THREADS << ")" << std::endl;
+            std::cout << "         --memory=<MB> memory for items (default " << STORE_MEMORY_MB << ")" << std::endl;
+            std::cout << "         --service-time=<us> service time per request and worker thread, e.g. for a slow database (default " << SERVICE_TIME_US << ")" << std::endl;
+            return false;
+        }
+    }
+    if (num_worker_threads < 1 || num_worker_threads > 256) {
+        std::cout << "Number of worker threads must be between 1 and 256" << std::endl;
+        return false;
+    }
+    if (udp_port < 1 || udp_port > 65535 || tcp_port < 0 || tcp_port > 65535) {
+        std::cout << "Invalid port" << std::endl;
+        return false;
+    }
+    if (service_time_ns < 0) {
+        std::cout << "Service time must not be negative" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void handle_signal(int)
+{
+    stop_requested.store(true);
+}
+
+int main(int argc, char const *argv[])
+{
+    std::cout << "Lethe Memcached server" << std::endl;
+
+    if (!parse_cmdline(argc, argv)) {
+        return 1;
+    }
+
+    store_init(store, memory_mb * 1024 * 1024);
+    for (int i = 0; i < num_worker_threads; i++) {
+        worker *w = new worker();
+        if (!setup_worker(w, i)) {
+            return 1;
+        }
+        workers.push_back(w);
+    }
+    int tcp_fd = -1;
+    if (tcp_port != 0) {
+        tcp_fd = open_tcp_socket();
+        if (tcp_fd < 0) {
+            return 1;
+        }
+    }
+
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+    for (worker *w : workers) {
+        w->thread = std::thread(worker_task, w);
+    }
+    std::cout << "Listening on " << listen_address << " UDP " << udp_port << (tcp_port != 0 ? " TCP " + std::to_string(tcp_port) : "") << " - Worker threads: " << num_worker_threads << " - Memory: " << memory_mb << "MB in " << store.num_classes << " slab classes of " << SLAB_CHUNK_MIN << "-" << ITEM_SIZE_MAX << " bytes - Service time: " << service_time_ns / 1000.0 << "us" << std::endl;
+
+    // without TCP, poll() ignores the fd -1 and tcp_task only waits for the stop
+    tcp_task(tcp_fd);
+    if (tcp_fd >= 0) {
+        close(tcp_fd);
+    }
+    for (worker *w : workers) {
+        w->thread.join();
+    }
+
+    print_stats();
+    return 0;
+}
@@ -0,0 +1,1247 @@
+/* Lethe software data plane "lethe_swdataplane"
+ * Multi-threaded UDP proxy with the pipeline of the Lethe P4 load balancer (lethe_loadbalancer/p4src/mcdslb.p4), to
+ * benchmark the Lethe algorithm on one Linux box at rates the BMV2 software switch can't reach. The clients send
+ * their Memcached UDP requests to the data plane (instead of the dummy database address 10.0.0.4) and receive all
+ * responses from it.
+ *
+ * Pipeline:
+ * - Client -> server "client_datagram": slb_hash = crc32(key) mod REGISTER_SIZE
+ *   - GET: counterReg[slb_hash]++, table loadbal sets the hotness (HOT/WARM1/WARM2/COLD, stored in letheinfo) and the
+ *     ecmp hash (HOT: crc16(request id) mod NUM_SERVERS, WARM1: 0, WARM2: 1, COLD: none), table ecmp selects the
+ *     cache. GETs that go to a cache are rewritten to "gat <exptime> <key>", all others go to the database
+ *   - SET: to the database, and as "delete <key>" to all caches (multicast group 1)
+ *   - anything else: to the database
+ * - Server -> client "server_datagram":
+ *   - database VALUE: table phot on the hotness, letheinfo += 16. To the client and as "set <key> <flags> <exptime>
+ *     <bytes>" to the caches of the hotness (multicast groups 2-4)
+ *   - cache VALUE: letheinfo |= cache id << 5 (last 3 bits of the cache's IPv4 address), to the client
+ *   - cache miss "END <key>": letheinfo |= cache id << 5, rewritten to "get <key>" and sent to the database, which
+ *     answers the client
+ *   - cache DELETED/NOT_FOUND (responses to the invalidations): dropped
+ *   - anything else: to the client
+ *
+ * Implementation:
+ * - Worker threads with one SO_REUSEPORT socket on the listen address each "worker_task". The kernel hashes every
+ *   client address to one worker, which opens an upstream socket for the client (flow) to send its requests to the
+ *   servers, so the responses arrive at the same worker and go back to the right client "get_flow". The SETs that
+ *   store database responses in the caches are sent from one more socket per worker, whose responses are dropped
+ * - Datagrams are received with recvmmsg and sent with sendmmsg "flush_output"
+ * - counterReg is kept per worker and summed when it is read, the tables are arrays of atomics indexed by the match
+ *   key: the data plane never locks
+ * - Control API: TCP text socket on 127.0.0.1 with commands like the BMV2 CLI (table_add, table_modify,
+ *   table_delete, table_clear, table_dump, register_read, register_reset, ...) "control_task", "run_command".
+ *   The tables are initialized from a commands file like s1-commands.txt
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <unordered_map>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <csignal>
+#include <cstring>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include "pipelinevariables.h"
+#include "lethe_hash.h"
+
+// hotness stored in letheinfo (same values as mcdslb.p4)
+#define HOTNESS_COLD 0
+#define HOTNESS_WARM1 1
+#define HOTNESS_HOT 2
+#define HOTNESS_WARM2 3
+
+// letheinfo: response from the database, cache id in bits 5-7
+#define LETHEINFO_DB 16
+#define LETHEINFO_CACHE_ID_SHIFT 5
+
+// Memcached UDP frame header: request id, sequence number, number of datagrams, letheinfo
+#define FRAME_HEADER_LEN 8
+
+// ecmp hash of COLD objects, has no ecmp entry (set_server_cold)
+#define ECMP_HASH_NONE 16383
+
+// loadbal entry that doesn't exist (the default action applies)
+#define LOADBAL_NO_ENTRY 0xFF
+
+// outputs per batch: every datagram is sent to at most the client/database and each cache
+#define OUTPUT_BATCH_SIZE (IO_BATCH_SIZE * (NUM_SERVERS + 1))
+
+std::string listen_address = "127.0.0.1";
+int listen_port = MEMCACHED_UDP_PORT;
+std::string db_address = "127.0.0.4";
+int db_port = MEMCACHED_UDP_PORT;
+int num_worker_threads = NUM_WORKER_THREADS;
+int control_port = CONTROL_PORT;
+std::string commands_file = "swdataplane-commands.txt";
+int cache_exptime = CACHE_EXPTIME;
+
+std::atomic<bool> stop_requested(false);
+
+/* a server is stored as one 64-bit word so table entries can be read and written atomically: bit 48 = valid,
+ * bits 16-47 = IPv4 address, bits 0-15 = port (host byte order) */
+inline uint64_t pack_server(uint32_t ip, uint16_t port)
+{
+    return 1ULL << 48 | (uint64_t)ip << 16 | port;
+}
+
+inline sockaddr_in server_sockaddr(uint64_t server)
+{
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl((uint32_t)(server >> 16));
+    addr.sin_port = htons(server & 0xFFFF);
+    return addr;
+}
+
+inline std::string server_string(uint64_t server)
+{
+    struct in_addr a;
+    a.s_addr = htonl((uint32_t)(server >> 16));
+    return std::string(inet_ntoa(a)) + " " + std::to_string(server & 0xFFFF);
+}
+
+uint64_t db_server;
+
+/*
+ * Tables and registers of the data plane, read by the workers without locks
+ */
+
+// table loadbal: hotness per slb_hash (LOADBAL_NO_ENTRY: default action)
+std::atomic<uint8_t> loadbal_hotness[REGISTER_SIZE];
+std::atomic<uint8_t> loadbal_default(HOTNESS_COLD);
+
+// table ecmp: server per ecmp hash (0: no entry)
+std::atomic<uint64_t> ecmp_servers[ECMP_TABLE_SIZE];
+
+// table phot: hotness of the caches that store a database response, per low byte of letheinfo (the ternary entries
+// are resolved for all 256 values whenever phot changes)
+std::atomic<uint8_t> phot_hotness[256];
+
+/*
+ * Workers
+ */
+
+// client address with an upstream socket
+struct flow
+{
+    sockaddr_in client;
+    int fd;
+    int64_t last_active_s;
+};
+
+// epoll data of the sockets that are not a flow
+#define EPOLL_LISTEN 0
+#define EPOLL_FANOUT 1
+
+struct worker_stats
+{
+    std::atomic<uint64_t> client_datagrams;
+    std::atomic<uint64_t> gets[4];           // by hotness
+    std::atomic<uint64_t> gets_to_cache;
+    std::atomic<uint64_t> sets;
+    std::atomic<uint64_t> other_requests;
+    std::atomic<uint64_t> invalidations;      // DELETEs to the caches
+    std::atomic<uint64_t> server_datagrams;
+    std::atomic<uint64_t> db_values;
+    std::atomic<uint64_t> cache_values;
+    std::atomic<uint64_t> miss_redirects;     // cache misses sent to the database
+    std::atomic<uint64_t> fanout_sets;        // SETs of database responses to the caches
+    std::atomic<uint64_t> fanout_skipped;     // database responses of more than one datagram, not stored in the caches
+    std::atomic<uint64_t> fanout_responses;   // responses of the caches to those SETs (dropped)
+    std::atomic<uint64_t> dropped;            // DELETED/NOT_FOUND of the caches
+    std::atomic<uint64_t> invalid;            // truncated or too short datagrams
+    std::atomic<uint64_t> send_errors;
+    std::atomic<uint64_t> flows;
+};
+
+struct worker
+{
+    int id;
+    int listen_fd;
+    int fanout_fd;
+    int epoll_fd;
+    std::thread thread;
+    std::unordered_map<uint64_t, flow *> flows;  // by client address
+    int64_t now_s;
+
+    // register counterReg of this worker
+    std::atomic<uint16_t> *counter_reg;
+
+    // receive batch
+    mmsghdr rx_msgs[IO_BATCH_SIZE];
+    iovec rx_iov[IO_BATCH_SIZE];
+    sockaddr_in rx_addr[IO_BATCH_SIZE];
+    char *rx_bufs;
+
+    // send batch: datagram i is in tx_bufs slot i or in a receive buffer (forwarded unchanged)
+    mmsghdr tx_msgs[OUTPUT_BATCH_SIZE];
+    iovec tx_iov[OUTPUT_BATCH_SIZE];
+    sockaddr_in tx_addr[OUTPUT_BATCH_SIZE];
+    int tx_fd[OUTPUT_BATCH_SIZE];
+    char *tx_bufs;
+    unsigned tx_len;
+
+    worker_stats stats;
+};
+
+std::vector<worker *> workers;
+
+/* increments a counter of the worker's own stats (single writer) */
+inline void count(std::atomic<uint64_t> &counter, uint64_t n = 1)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+inline int64_t coarse_now_s()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return ts.tv_sec;
+}
+
+inline uint16_t get_letheinfo(const char *d)
+{
+    return (uint8_t)d[6] << 8 | (uint8_t)d[7];
+}
+
+inline void set_letheinfo(char *d, uint16_t letheinfo)
+{
+    d[6] = letheinfo >> 8;
+    d[7] = letheinfo & 0xFF;
+}
+
+/* first letter of the command, upper case (as the command checks of mcdslb.p4) */
+inline char command_letter(const char *d)
+{
+    return d[FRAME_HEADER_LEN] & 0xDF;
+}
+
+/* true if datagram {d} starts with the 3-letter command {command} followed by a space (any case) */
+inline bool is_command(const char *d, size_t len, const char *command)
+{
+    return len > FRAME_HEADER_LEN + 3 && strncasecmp(d + FRAME_HEADER_LEN, command, 3) == 0 && d[FRAME_HEADER_LEN + 3] == ' ';
+}
+
+/* the token after the command "<command> <key>..." of datagram {d}, false if there is none */
+inline bool parse_key(const char *d, size_t len, size_t *key_start, size_t *key_len)
+{
+    size_t i = FRAME_HEADER_LEN;
+    while (i < len && d[i] != ' ' && d[i] != '\r') {
+        i++;
+    }
+    if (i >= len || d[i] != ' ') {
+        return false;
+    }
+    size_t start = ++i;
+    while (i < len && d[i] != ' ' && d[i] != '\r' && d[i] != '\n') {
+        i++;
+    }
+    *key_start = start;
+    *key_len = i - start;
+    return i > start;
+}
+
+/* slot of the next datagram of the send batch, to build a datagram in */
+inline char *output_buffer(worker *w)
+{
+    return w->tx_bufs + (size_t)w->tx_len * DATAGRAM_SIZE;
+}
+
+/* sends the send batch, one sendmmsg per run of datagrams from the same socket. Datagrams that don't fit into the
+ * socket buffer are dropped (like a full switch queue) */
+void flush_output(worker *w)
+{
+    unsigned i = 0;
+    while (i < w->tx_len) {
+        unsigned run = 1;
+        while (i + run < w->tx_len && w->tx_fd[i + run] == w->tx_fd[i]) {
+            run++;
+        }
+        unsigned sent = 0;
+        while (sent < run) {
+            int n = sendmmsg(w->tx_fd[i], &w->tx_msgs[i + sent], run - sent, MSG_DONTWAIT);
+            if (n <= 0) {
+                count(w->stats.send_errors, run - sent);
+                break;
+            }
+            sent += n;
+        }
+        i += run;
+    }
+    w->tx_len = 0;
+}
+
+/* adds datagram {data} (an output_buffer or a received datagram) to the send batch. There is room for the outputs
+ * of a datagram, see receive_batch */
+inline void queue_output(worker *w, int fd, const sockaddr_in &to, char *data, size_t len)
+{
+    unsigned i = w->tx_len++;
+    w->tx_fd[i] = fd;
+    w->tx_addr[i] = to;
+    w->tx_iov[i].iov_base = data;
+    w->tx_iov[i].iov_len = len;
+}
+
+/* upstream socket of the client at {client}, opened on its first datagram */
+flow *get_flow(worker *w, const sockaddr_in &client)
+{
+    uint64_t key = (uint64_t)client.sin_addr.s_addr << 16 | client.sin_port;
+    auto it = w->flows.find(key);
+    if (it != w->flows.end()) {
+        return it->second;
+    }
+
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    if (fd < 0) {
+        return nullptr;
+    }
+    int buffer_size = 4 * 1024 * 1024;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+
+    flow *f = new flow();
+    f->client = client;
+    f->fd = fd;
+    f->last_active_s = w->now_s;
+    epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = f;
+    epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+    w->flows[key] = f;
+    count(w->stats.flows);
+    return f;
+}
+
+/* closes the upstream sockets of clients that were idle for FLOW_IDLE_TIMEOUT_S */
+void expire_flows(worker *w)
+{
+    for (auto it = w->flows.begin(); it != w->flows.end();) {
+        flow *f = it->second;
+        if (w->now_s - f->last_active_s > FLOW_IDLE_TIMEOUT_S) {
+            epoll_ctl(w->epoll_fd, EPOLL_CTL_DEL, f->fd, nullptr);
+            close(f->fd);
+            delete f;
+            it = w->flows.erase(it);
+            count(w->stats.flows, (uint64_t)-1);
+        } else {
+            ++it;
+        }
+    }
+}
+
+/* the caches of multicast groups 1-4: ecmp entries 0..NUM_SERVERS-1 of {hotness} (HOT: all, WARM1: 0, WARM2: 1),
+ * returns their number */
+inline int hotness_caches(uint8_t hotness, uint64_t servers[NUM_SERVERS])
+{
+    int n = 0;
+    for (int i = 0; i < NUM_SERVERS; i++) {
+        if ((hotness == HOTNESS_WARM1 && i != 0) || (hotness == HOTNESS_WARM2 && i != 1)) {
+            continue;
+        }
+        uint64_t server = ecmp_servers[i].load(std::memory_order_relaxed);
+        bool duplicate = false;
+        for (int j = 0; j < n; j++) {
+            duplicate = duplicate || servers[j] == server;
+        }
+        if (server != 0 && !duplicate) {
+            servers[n++] = server;
+        }
+    }
+    return n;
+}
+
+/* Part A of MyIngress: a request of a client */
+void client_datagram(worker *w, flow *f, char *d, size_t len)
+{
+    count(w->stats.client_datagrams);
+    size_t key_start, key_len;
+    bool has_key = parse_key(d, len, &key_start, &key_len);
+
+    // GET request
+    if (has_key && is_command(d, len, "get")) {
+        uint32_t hash = slb_hash(d + key_start, key_len, REGISTER_SIZE);
+        w->counter_reg[hash].fetch_add(1, std::memory_order_relaxed);
+
+        uint8_t hotness = loadbal_hotness[hash].load(std::memory_order_relaxed);
+        if (hotness == LOADBAL_NO_ENTRY) {
+            hotness = loadbal_default.load(std::memory_order_relaxed);
+        }
+        uint32_t ecmp_hash = ECMP_HASH_NONE;
+        if (hotness == HOTNESS_HOT) {
+            ecmp_hash = ecmp_hash_hot(d, NUM_SERVERS);
+        } else if (hotness == HOTNESS_WARM1) {
+            ecmp_hash = 0;
+        } else if (hotness == HOTNESS_WARM2) {
+            ecmp_hash = 1;
+        }
+        set_letheinfo(d, hotness);
+        count(w->stats.gets[hotness & 3]);
+
+        uint64_t server = ecmp_hash < ECMP_TABLE_SIZE ? ecmp_servers[ecmp_hash].load(std::memory_order_relaxed) : 0;
+        sockaddr_in to = server_sockaddr(server != 0 ? server : db_server);
+        if (server != 0) {
+            count(w->stats.gets_to_cache);
+        }
+
+        // GET to GAT with the expiration time, if not COLD: "get <key>..." -> "gat <exptime> <key>..."
+        if (hotness != HOTNESS_COLD && len + 16 <= DATAGRAM_SIZE) {
+            char *b = output_buffer(w);
+            memcpy(b, d, FRAME_HEADER_LEN);
+            int n = FRAME_HEADER_LEN + sprintf(b + FRAME_HEADER_LEN, "gat %d ", cache_exptime);
+            memcpy(b + n, d + key_start, len - key_start);
+            queue_output(w, f->fd, to, b, n + len - key_start);
+        } else {
+            queue_output(w, f->fd, to, d, len);
+        }
+    }
+    // SET request: to the database and as DELETE to all caches
+    else if (has_key && is_command(d, len, "set")) {
+        count(w->stats.sets);
+        queue_output(w, f->fd, server_sockaddr(db_server), d, len);
+
+        uint64_t caches[NUM_SERVERS];
+        int num_caches = hotness_caches(HOTNESS_HOT, caches);
+        for (int i = 0; i < num_caches; i++) {
+            char *b = output_buffer(w);
+            memcpy(b, d, FRAME_HEADER_LEN);
+            memcpy(b + FRAME_HEADER_LEN, "delete ", 7);
+            memcpy(b + FRAME_HEADER_LEN + 7, d + key_start, key_len);
+            memcpy(b + FRAME_HEADER_LEN + 7 + key_len, "\r\n", 2);
+            queue_output(w, f->fd, server_sockaddr(caches[i]), b, FRAME_HEADER_LEN + 7 + key_len + 2);
+            count(w->stats.invalidations);
+        }
+    } else {
+        count(w->stats.other_requests);
+        queue_output(w, f->fd, server_sockaddr(db_server), d, len);
+    }
+}
+
+/* builds "set <key> <flags> <exptime> <bytes>\r\n<data>\r\n" from the first item of the VALUE response {d} into
+ * {b}, returns its length or 0 if the response can't be parsed */
+size_t value_to_set(const char *d, size_t len, char *b)
+{
+    // "VALUE <key> <flags> <bytes>[ <cas>]\r\n"
+    const char *line_end = (const char *)memmem(d + FRAME_HEADER_LEN, len - FRAME_HEADER_LEN, "\r\n", 2);
+    if (line_end == nullptr) {
+        return 0;
+    }
+    std::string line(d + FRAME_HEADER_LEN, line_end);
+    std::istringstream tokens(line);
+    std::string command, key, flags;
+    size_t bytes;
+    if (!(tokens >> command >> key >> flags >> bytes)) {
+        return 0;
+    }
+    size_t data_start = line_end + 2 - d;
+    if (data_start + bytes + 2 > len) {
+        return 0;
+    }
+    int n = FRAME_HEADER_LEN + snprintf(b + FRAME_HEADER_LEN, DATAGRAM_SIZE - FRAME_HEADER_LEN, "set %s %s %d %zu\r\n", key.c_str(), flags.c_str(), cache_exptime, bytes);
+    if (n + bytes + 2 > DATAGRAM_SIZE) {
+        return 0;
+    }
+    memcpy(b, d, FRAME_HEADER_LEN);
+    memcpy(b + n, d + data_start, bytes + 2);
+    return n + bytes + 2;
+}
+
+/* Part B of MyIngress: a response of a server to the client of flow {f} */
+void server_datagram(worker *w, flow *f, const sockaddr_in &from, char *d, size_t len)
+{
+    count(w->stats.server_datagrams);
+    uint16_t sequence = (uint8_t)d[2] << 8 | (uint8_t)d[3];
+    uint16_t num_datagrams = (uint8_t)d[4] << 8 | (uint8_t)d[5];
+    uint16_t letheinfo = get_letheinfo(d);
+    uint32_t from_ip = ntohl(from.sin_addr.s_addr);
+    char command = command_letter(d);
+
+    // further datagrams of a response start with data, not with a command
+    if (sequence != 0) {
+        queue_output(w, w->listen_fd, f->client, d, len);
+        return;
+    }
+
+    // response of the database
+    if (pack_server(from_ip, ntohs(from.sin_port)) == db_server) {
+        if (command == 'V') {
+            count(w->stats.db_values);
+            uint8_t hotness = phot_hotness[letheinfo & 0xFF].load(std::memory_order_relaxed);
+            set_letheinfo(d, letheinfo + LETHEINFO_DB);
+
+            // store the object in the caches of its hotness (the VALUE response becomes a SET)
+            uint64_t caches[NUM_SERVERS];
+            int num_caches = hotness != HOTNESS_COLD ? hotness_caches(hotness, caches) : 0;
+            if (num_caches > 0 && num_datagrams != 1) {
+                count(w->stats.fanout_skipped);
+            } else if (num_caches > 0) {
+                char *b = output_buffer(w);
+                size_t set_len = value_to_set(d, len, b);
+                for (int i = 0; set_len > 0 && i < num_caches; i++) {
+                    if (i > 0) {
+                        memcpy(output_buffer(w), b, set_len);
+                    }
+                    queue_output(w, w->fanout_fd, server_sockaddr(caches[i]), output_buffer(w), set_len);
+                    count(w->stats.fanout_sets);
+                }
+            }
+        }
+        queue_output(w, w->listen_fd, f->client, d, len);
+        return;
+    }
+
+    // response of a cache
+    uint16_t cache_id = (from_ip & 7) << LETHEINFO_CACHE_ID_SHIFT;
+    size_t key_start, key_len;
+    if (command == 'V') {
+        count(w->stats.cache_values);
+        set_letheinfo(d, letheinfo | cache_id);
+        queue_output(w, w->listen_fd, f->client, d, len);
+    } else if (command == 'E' && parse_key(d, len, &key_start, &key_len)) {
+        // miss "END <key>": fetch the object from the database for the client
+        count(w->stats.miss_redirects);
+        set_letheinfo(d, letheinfo | cache_id);
+        memcpy(d + FRAME_HEADER_LEN, "get", 3);
+        queue_output(w, f->fd, server_sockaddr(db_server), d, len);
+    } else if (command == 'D' || command == 'N') {
+        count(w->stats.dropped);
+    } else {
+        queue_output(w, w->listen_fd, f->client, d, len);
+    }
+}
+
+/* receives one batch from socket {fd} (a flow, the listen or the fanout socket) and processes it */
+void receive_batch(worker *w, int fd, uint64_t epoll_data)
+{
+    for (int i = 0; i < IO_BATCH_SIZE; i++) {
+        w->rx_iov[i].iov_base = w->rx_bufs + (size_t)i * DATAGRAM_SIZE;
+        w->rx_iov[i].iov_len = DATAGRAM_SIZE;
+        w->rx_msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+    }
+    int n = recvmmsg(fd, w->rx_msgs, IO_BATCH_SIZE, MSG_DONTWAIT, nullptr);
+    if (n <= 0) {
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        if (w->tx_len + NUM_SERVERS + 1 > OUTPUT_BATCH_SIZE) {
+            flush_output(w);
+        }
+        char *d = (char *)w->rx_iov[i].iov_base;
+        size_t len = w->rx_msgs[i].msg_len;
+        if (epoll_data == EPOLL_FANOUT) {
+            count(w->stats.fanout_responses);
+            continue;
+        }
+        if ((w->rx_msgs[i].msg_hdr.msg_flags & MSG_TRUNC) || len <= FRAME_HEADER_LEN) {
+            count(w->stats.invalid);
+            continue;
+        }
+        if (epoll_data == EPOLL_LISTEN) {
+            flow *f = get_flow(w, w->rx_addr[i]);
+            if (f == nullptr) {
+                count(w->stats.send_errors);
+                continue;
+            }
+            f->last_active_s = w->now_s;
+            client_datagram(w, f, d, len);
+        } else {
+            server_datagram(w, (flow *)epoll_data, w->rx_addr[i], d, len);
+        }
+    }
+    flush_output(w);
+}
+
+void worker_task(worker *w)
+{
+    epoll_event events[64];
+    int64_t last_expiry_s = coarse_now_s();
+    while (!stop_requested.load(std::memory_order_relaxed)) {
+        int n = epoll_wait(w->epoll_fd, events, 64, 100);
+        w->now_s = coarse_now_s();
+        for (int i = 0; i < n; i++) {
+            uint64_t data = events[i].data.u64;
+            int fd = data == EPOLL_LISTEN ? w->listen_fd : data == EPOLL_FANOUT ? w->fanout_fd : ((flow *)data)->fd;
+            receive_batch(w, fd, data);
+        }
+        if (w->now_s != last_expiry_s) {
+            expire_flows(w);
+            last_expiry_s = w->now_s;
+        }
+    }
+}
+
+/* opens the sockets of worker {id}. Returns false if the listen address can't be bound */
+bool setup_worker(worker *w, int id)
+{
+    w->id = id;
+    w->now_s = coarse_now_s();
+    w->counter_reg = new std::atomic<uint16_t>[REGISTER_SIZE]();
+    w->rx_bufs = new char[(size_t)IO_BATCH_SIZE * DATAGRAM_SIZE];
+    w->tx_bufs = new char[(size_t)OUTPUT_BATCH_SIZE * DATAGRAM_SIZE];
+    w->tx_len = 0;
+    for (int i = 0; i < IO_BATCH_SIZE; i++) {
+        memset(&w->rx_msgs[i], 0, sizeof(mmsghdr));
+        w->rx_msgs[i].msg_hdr.msg_name = &w->rx_addr[i];
+        w->rx_msgs[i].msg_hdr.msg_iov = &w->rx_iov[i];
+        w->rx_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    for (int i = 0; i < OUTPUT_BATCH_SIZE; i++) {
+        memset(&w->tx_msgs[i], 0, sizeof(mmsghdr));
+        w->tx_msgs[i].msg_hdr.msg_name = &w->tx_addr[i];
+        w->tx_msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        w->tx_msgs[i].msg_hdr.msg_iov = &w->tx_iov[i];
+        w->tx_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(listen_port);
+    inet_pton(AF_INET, listen_address.c_str(), &addr.sin_addr);
+    int one = 1;
+    int buffer_size = 4 * 1024 * 1024;
+    w->listen_fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    setsockopt(w->listen_fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+    setsockopt(w->listen_fd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+    setsockopt(w->listen_fd, SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+    if (bind(w->listen_fd, (sockaddr *)&addr, sizeof(addr)) < 0) {
+        std::cout << "Can't bind " << listen_address << ":" << listen_port << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    w->fanout_fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    setsockopt(w->fanout_fd, SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+
+    w->epoll_fd = epoll_create1(0);
+    epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.u64 = EPOLL_LISTEN;
+    epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, w->listen_fd, &ev);
+    ev.data.u64 = EPOLL_FANOUT;
+    epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, w->fanout_fd, &ev);
+    return true;
+}
+
+/*
+ * Control plane: table entries with handles (as in BMV2), applied to the arrays of the data plane
+ */
+
+#define MATCH_EXACT 0
+#define MATCH_TERNARY 1
+
+struct table_entry
+{
+    uint32_t key;
+    uint32_t mask;      // ternary
+    int priority;       // ternary: the entry with the lowest priority value matches
+    std::string action;
+    uint64_t server;    // parameter of set_server
+};
+
+struct control_table
+{
+    std::string name;
+    int match;
+    uint32_t key_range;   // exact match keys are below key_range, ternary keys and masks at most key_range - 1
+    size_t size;
+    std::vector<std::string> actions;
+    std::string default_action;
+    std::map<uint32_t, table_entry> entries;       // by handle
+    std::unordered_map<uint32_t, uint32_t> handles;  // exact match: handle by key
+    uint32_t next_handle;
+};
+
+control_table loadbal_table = {"loadbal", MATCH_EXACT, REGISTER_SIZE, LOADBAL_TABLE_SIZE, {"set_server_cold", "set_server_warm1", "set_server_hot", "set_server_warm2"}, "set_server_cold", {}, {}, 0};
+control_table ecmp_table = {"ecmp", MATCH_EXACT, ECMP_TABLE_SIZE, ECMP_TABLE_SIZE, {"set_server", "NoAction"}, "NoAction", {}, {}, 0};
+control_table phot_table = {"phot", MATCH_TERNARY, 256, PHOT_TABLE_SIZE, {"phot_cold", "phot_warm1", "phot_hot", "phot_warm2"}, "phot_cold", {}, {}, 0};
+
+std::mutex control_mutex;
+
+/* hotness of the loadbal/phot actions, which list them in the order of the hotness values */
+inline uint8_t action_hotness(const control_table &t, const std::string &action)
+{
+    return std::find(t.actions.begin(), t.actions.end(), action) - t.actions.begin();
+}
+
+/* resolves the ternary entries of phot for every value of the low byte of letheinfo */
+void apply_phot()
+{
+    uint8_t default_hotness = action_hotness(phot_table, phot_table.default_action);
+    for (uint32_t v = 0; v < 256; v++) {
+        const table_entry *best = nullptr;
+        for (auto &it : phot_table.entries) {
+            const table_entry &e = it.second;
+            if ((v & e.mask) == (e.key & e.mask) && (best == nullptr || e.priority < best->priority)) {
+                best = &e;
+            }
+        }
+        phot_hotness[v].store(best != nullptr ? action_hotness(phot_table, best->action) : default_hotness, std::memory_order_relaxed);
+    }
+}
+
+/* writes entry {e} of table {t} (nullptr: delete the entry with key {key}) to the data plane */
+void apply_entry(control_table &t, uint32_t key, const table_entry *e)
+{
+    if (&t == &loadbal_table) {
+        loadbal_hotness[key].store(e != nullptr ? action_hotness(t, e->action) : LOADBAL_NO_ENTRY, std::memory_order_relaxed);
+    } else if (&t == &ecmp_table) {
+        ecmp_servers[key].store(e != nullptr && e->action == "set_server" ? e->server : 0, std::memory_order_relaxed);
+    } else {
+        apply_phot();
+    }
+}
+
+void apply_default(control_table &t)
+{
+    if (&t == &loadbal_table) {
+        loadbal_default.store(action_hotness(t, t.default_action), std::memory_order_relaxed);
+    } else if (&t == &phot_table) {
+        apply_phot();
+    }
+}
+
+control_table *find_table(const std::string &name)
+{
+    if (name == "loadbal") {
+        return &loadbal_table;
+    } else if (name == "ecmp") {
+        return &ecmp_table;
+    } else if (name == "phot") {
+        return &phot_table;
+    }
+    return nullptr;
+}
+
+/* parses a number (decimal or 0x hexadecimal) */
+bool parse_number(const std::string &s, uint64_t *value)
+{
+    if (s.empty()) {
+        return false;
+    }
+    char *end;
+    *value = strtoull(s.c_str(), &end, 0);
+    return *end == '\0';
+}
+
+/* parses action {action} and its parameters {params} into {e}, returns an error message or "" */
+std::string parse_action(const control_table &t, const std::string &action, const std::vector<std::string> &params, table_entry &e)
+{
+    if (std::find(t.actions.begin(), t.actions.end(), action) == t.actions.end()) {
+        return "Error: table " + t.name + " has no action " + action;
+    }
+    e.action = action;
+    e.server = 0;
+    if (action == "set_server") {
+        // set_server <ip> [port]
+        struct in_addr a;
+        uint64_t port = MEMCACHED_UDP_PORT;
+        if (params.empty() || inet_pton(AF_INET, params[0].c_str(), &a) != 1 || (params.size() > 1 && (!parse_number(params[1], &port) || port > 65535))) {
+            return "Error: set_server needs the parameters <ip> [port]";
+        }
+        e.server = pack_server(ntohl(a.s_addr), port);
+    }
+    return "";
+}
+
+/* parses the match key "<key>" or "<key>&&&<mask>" of an entry of table {t} into {e} */
+std::string parse_match(const control_table &t, const std::string &match, table_entry &e)
+{
+    uint64_t key, mask = t.key_range - 1;
+    size_t sep = match.find("&&&");
+    if (!parse_number(match.substr(0, sep), &key) || (sep != std::string::npos && (t.match != MATCH_TERNARY || !parse_number(match.substr(sep + 3), &mask)))) {
+        return "Error: invalid match key " + match;
+    }
+    if (key >= t.key_range || mask >= t.key_range) {
+        return "Error: match key " + match + " out of range (below " + std::to_string(t.key_range) + ")";
+    }
+    e.key = key;
+    e.mask = t.match == MATCH_TERNARY ? mask : 0;
+    return "";
+}
+
+std::string entry_string(const control_table &t, uint32_t handle, const table_entry &e)
+{
+    std::string s = std::to_string(handle) + ": " + std::to_string(e.key);
+    if (t.match == MATCH_TERNARY) {
+        s += "&&&" + std::to_string(e.mask);
+    }
+    s += " => " + e.action;
+    if (e.server != 0) {
+        s += " " + server_string(e.server);
+    }
+    if (t.match == MATCH_TERNARY) {
+        s += " priority " + std::to_string(e.priority);
+    }
+    return s;
+}
+
+/* sum of the counterReg entry {index} of all workers, read and reset to 0 if {reset} */
+inline uint16_t read_counter(uint32_t index, bool reset)
+{
+    uint16_t sum = 0;
+    for (worker *w : workers) {
+        sum += reset ? w->counter_reg[index].exchange(0, std::memory_order_relaxed) : w->counter_reg[index].load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+/* sum of a counter of all workers */
+uint64_t sum_stats(std::atomic<uint64_t> worker_stats::*counter)
+{
+    uint64_t sum = 0;
+    for (worker *w : workers) {
+        sum += (w->stats.*counter).load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+std::string stats_string()
+{
+    std::ostringstream out;
+    out << "client datagrams: " << sum_stats(&worker_stats::client_datagrams) << "\n";
+    out << "GET COLD/WARM1/HOT/WARM2: ";
+    for (int hotness = 0; hotness < 4; hotness++) {
+        uint64_t sum = 0;
+        for (worker *w : workers) {
+            sum += w->stats.gets[hotness].load(std::memory_order_relaxed);
+        }
+        out << sum << (hotness < 3 ? "/" : "");
+    }
+    out << " - to caches: " << sum_stats(&worker_stats::gets_to_cache) << "\n";
+    out << "SET: " << sum_stats(&worker_stats::sets) << " - DELETE to caches: " << sum_stats(&worker_stats::invalidations) << " - other requests: " << sum_stats(&worker_stats::other_requests) << "\n";
+    out << "server datagrams: " << sum_stats(&worker_stats::server_datagrams) << " - VALUE from database: " << sum_stats(&worker_stats::db_values) << " - VALUE from caches: " << sum_stats(&worker_stats::cache_values) << "\n";
+    out << "cache misses to database: " << sum_stats(&worker_stats::miss_redirects) << " - SET to caches: " << sum_stats(&worker_stats::fanout_sets) << " (responses: " << sum_stats(&worker_stats::fanout_responses) << ", not stored, more than one datagram: " << sum_stats(&worker_stats::fanout_skipped) << ")\n";
+    out << "dropped DELETED/NOT_FOUND: " << sum_stats(&worker_stats::dropped) << " - invalid datagrams: " << sum_stats(&worker_stats::invalid) << " - send errors: " << sum_stats(&worker_stats::send_errors) << "\n";
+    out << "flows: " << sum_stats(&worker_stats::flows);
+    return out.str();
+}
+
+const char *control_help =
+    "table_set_default <table> <action> [params]\n"
+    "table_add <table> <action> <key>[&&&<mask>] => [params] [priority]\n"
+    "table_modify <table> <action> <handle> [=>] [params]\n"
+    "table_modify_match <table> <action> <key> [=>] [params]\n"
+    "table_delete <table> <handle>\n"
+    "table_delete_match <table> <key>\n"
+    "table_clear <table>\n"
+    "table_num_entries <table>\n"
+    "table_dump <table>\n"
+    "register_read counterReg [index]\n"
+    "register_read_reset counterReg\n"
+    "register_write counterReg <index> <value>\n"
+    "register_reset counterReg\n"
+    "stats\n"
+    "tables: loadbal (exact slb_hash: set_server_cold|set_server_warm1|set_server_hot|set_server_warm2), ecmp (exact: set_server <ip> [port]|NoAction), phot (ternary letheinfo: phot_cold|phot_warm1|phot_hot|phot_warm2)";
+
+/* runs one command of the control API, returns its output (errors start with "Error:") */
+std::string run_command(const std::string &line)
+{
+    std::istringstream in(line);
+    std::vector<std::string> args;
+    std::string arg;
+    while (in >> arg) {
+        args.push_back(arg);
+    }
+    if (args.empty()) {
+        return "";
+    }
+    std::lock_guard<std::mutex> lock(control_mutex);
+    const std::string &command = args[0];
+
+    if (command == "help") {
+        return control_help;
+    }
+    if (command == "stats") {
+        return stats_string();
+    }
+
+    if (command.compare(0, 9, "register_") == 0) {
+        if (args.size() < 2 || args[1] != "counterReg") {
+            return "Error: unknown register (counterReg)";
+        }
+        uint64_t index, value;
+        if (command == "register_read" && args.size() == 3) {
+            if (!parse_number(args[2], &index) || index >= REGISTER_SIZE) {
+                return "Error: invalid index " + args[2];
+            }
+            return "counterReg[" + std::to_string(index) + "]= " + std::to_string(read_counter(index, false));
+        } else if (command == "register_read" || command == "register_read_reset") {
+            std::string out = "counterReg= ";
+            out.reserve(REGISTER_SIZE * 3);
+            for (uint32_t i = 0; i < REGISTER_SIZE; i++) {
+                if (i > 0) {
+                    out += ", ";
+                }
+                out += std::to_string(read_counter(i, command == "register_read_reset"));
+            }
+            return out;
+        } else if (command == "register_write" && args.size() == 4) {
+            if (!parse_number(args[2], &index) || index >= REGISTER_SIZE || !parse_number(args[3], &value)) {
+                return "Error: invalid index or value";
+            }
+            for (worker *w : workers) {
+                w->counter_reg[index].store(w == workers[0] ? value : 0, std::memory_order_relaxed);
+            }
+            return "";
+        } else if (command == "register_reset") {
+            for (worker *w : workers) {
+                for (uint32_t i = 0; i < REGISTER_SIZE; i++) {
+                    w->counter_reg[i].store(0, std::memory_order_relaxed);
+                }
+            }
+            return "";
+        }
+        return "Error: invalid command, see help";
+    }
+
+    if (command.compare(0, 6, "table_") != 0) {
+        return "Error: unknown command " + command + ", see help";
+    }
+    control_table *t = args.size() >= 2 ? find_table(args[1]) : nullptr;
+    if (t == nullptr) {
+        return "Error: unknown table" + (args.size() >= 2 ? " " + args[1] : "") + " (loadbal, ecmp or phot)";
+    }
+
+    // action parameters: everything after the match key/handle, without "=>"
+    std::vector<std::string> params;
+    for (size_t i = 4; i < args.size(); i++) {
+        if (args[i] != "=>") {
+            params.push_back(args[i]);
+        }
+    }
+
+    if (command == "table_set_default" && args.size() >= 3) {
+        table_entry e;
+        std::vector<std::string> default_params(args.begin() + 3, args.end());
+        std::string error = parse_action(*t, args[2], default_params, e);
+        if (!error.empty()) {
+            return error;
+        }
+        if (e.server != 0) {
+            return "Error: default actions with parameters aren't supported";
+        }
+        t->default_action = args[2];
+        apply_default(*t);
+        return "";
+    } else if (command == "table_add" && args.size() >= 4) {
+        table_entry e;
+        e.priority = 0;
+        if (t->match == MATCH_TERNARY) {
+            // the priority is the last parameter
+            uint64_t priority;
+            if (params.empty() || !parse_number(params.back(), &priority)) {
+                return "Error: ternary entries need a priority";
+            }
+            e.priority = priority;
+            params.pop_back();
+        }
+        std::string error = parse_match(*t, args[3], e);
+        if (error.empty()) {
+            error = parse_action(*t, args[2], params, e);
+        }
+        if (!error.empty()) {
+            return error;
+        }
+        if (t->match == MATCH_EXACT && t->handles.count(e.key)) {
+            return "Error: duplicate entry, key " + std::to_string(e.key) + " has handle " + std::to_string(t->handles[e.key]);
+        }
+        if (t->entries.size() >= t->size) {
+            return "Error: table " + t->name + " is full (" + std::to_string(t->size) + " entries)";
+        }
+        uint32_t handle = t->next_handle++;
+        t->entries[handle] = e;
+        if (t->match == MATCH_EXACT) {
+            t->handles[e.key] = handle;
+        }
+        apply_entry(*t, e.key, &e);
+        return "Entry has been added with handle " + std::to_string(handle);
+    } else if ((command == "table_modify" || command == "table_modify_match") && args.size() >= 4) {
+        uint64_t handle;
+        if (command == "table_modify_match") {
+            table_entry m;
+            std::string error = parse_match(*t, args[3], m);
+            if (!error.empty()) {
+                return error;
+            }
+            if (t->match != MATCH_EXACT || !t->handles.count(m.key)) {
+                return "Error: no entry with key " + args[3];
+            }
+            handle = t->handles[m.key];
+        } else if (!parse_number(args[3], &handle) || !t->entries.count(handle)) {
+            return "Error: invalid handle " + args[3];
+        }
+        table_entry &e = t->entries[handle];
+        table_entry modified = e;
+        std::string error = parse_action(*t, args[2], params, modified);
+        if (!error.empty()) {
+            return error;
+        }
+        e = modified;
+        apply_entry(*t, e.key, &e);
+        return "";
+    } else if ((command == "table_delete" || command == "table_delete_match") && args.size() == 3) {
+        uint64_t handle;
+        if (command == "table_delete_match") {
+            table_entry m;
+            std::string error = parse_match(*t, args[2], m);
+            if (!error.empty()) {
+                return error;
+            }
+            if (t->match != MATCH_EXACT || !t->handles.count(m.key)) {
+                return "Error: no entry with key " + args[2];
+            }
+            handle = t->handles[m.key];
+        } else if (!parse_number(args[2], &handle) || !t->entries.count(handle)) {
+            return "Error: invalid handle " + args[2];
+        }
+        uint32_t key = t->entries[handle].key;
+        t->entries.erase(handle);
+        t->handles.erase(key);
+        apply_entry(*t, key, nullptr);
+        return "";
+    } else if (command == "table_clear" && args.size() == 2) {
+        std::map<uint32_t, table_entry> entries;
+        entries.swap(t->entries);
+        t->handles.clear();
+        for (auto &it : entries) {
+            apply_entry(*t, it.second.key, nullptr);
+        }
+        return "";
+    } else if (command == "table_num_entries" && args.size() == 2) {
+        return std::to_string(t->entries.size());
+    } else if (command == "table_dump" && args.size() == 2) {
+        std::string out;
+        for (auto &it : t->entries) {
+            out += entry_string(*t, it.first, it.second) + "\n";
+        }
+        return out + "default: " + t->default_action;
+    }
+    return "Error: invalid command, see help";
+}
+
+/* runs the commands of file {file_name} ("//" and "#" start comments), returns false if it can't be read or a command fails */
+bool run_commands_file(const std::string &file_name)
+{
+    std::ifstream f(file_name);
+    if (!f) {
+        std::cout << "Can't read the commands file " << file_name << std::endl;
+        return false;
+    }
+    std::string line;
+    int line_no = 0;
+    while (std::getline(f, line)) {
+        line_no++;
+        size_t comment = std::min(line.find("//"), line.find('#'));
+        std::string output = run_command(line.substr(0, comment));
+        if (output.compare(0, 6, "Error:") == 0) {
+            std::cout << file_name << ":" << line_no << ": " << output << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+/* control API: accepts TCP connections on 127.0.0.1:{control_port} and runs one command per line. Every response is
+ * terminated by an empty line */
+void control_task(int listen_fd)
+{
+    std::vector<pollfd> fds = {{listen_fd, POLLIN, 0}};
+    std::vector<std::string> buffers = {""};
+    while (!stop_requested.load(std::memory_order_relaxed)) {
+        if (poll(fds.data(), fds.size(), 100) <= 0) {
+            continue;
+        }
+        for (size_t i = fds.size(); i-- > 1;) {
+            if (fds[i].revents == 0) {
+                continue;
+            }
+            char buf[4096];
+            ssize_t n = read(fds[i].fd, buf, sizeof(buf));
+            if (n <= 0) {
+                close(fds[i].fd);
+                fds.erase(fds.begin() + i);
+                buffers.erase(buffers.begin() + i);
+                continue;
+            }
+            buffers[i].append(buf, n);
+
+            // the responses to all complete lines are sent together (pipelined commands)
+            std::string output;
+            size_t start = 0, end;
+            while ((end = buffers[i].find('\n', start)) != std::string::npos) {
+                std::string line = buffers[i].substr(start, end - start);
+                start = end + 1;
+                if (!line.empty() && line.back() == '\r') {
+                    line.pop_back();
+                }
+                std::string response = run_command(line);
+                output += response.empty() ? "\n" : response + "\n\n";
+            }
+            buffers[i].erase(0, start);
+            for (size_t written = 0; written < output.size();) {
+                ssize_t w = send(fds[i].fd, output.data() + written, output.size() - written, MSG_NOSIGNAL);
+                if (w <= 0) {
+                    break;
+                }
+                written += w;
+            }
+        }
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(listen_fd, nullptr, nullptr);
+            if (fd >= 0) {
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                fds.push_back({fd, POLLIN, 0});
+                buffers.push_back("");
+            }
+        }
+    }
+    for (size_t i = 1; i < fds.size(); i++) {
+        close(fds[i].fd);
+    }
+}
+
+int open_control_socket()
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(control_port);
+    if (bind(fd, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 16) < 0) {
+        std::cout << "Can't open the control port 127.0.0.1:" << control_port << ": " << strerror(errno) << std::endl;
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* parses "<ip>[:<port>]" */
+bool parse_address(const std::string &value, std::string *ip, int *port)
+{
+    struct in_addr a;
+    *ip = value.substr(0, value.find(':'));
+    if (value.find(':') != std::string::npos) {
+        *port = std::stoi(value.substr(value.find(':') + 1));
+    }
+    return inet_pton(AF_INET, ip->c_str(), &a) == 1 && *port > 0 && *port < 65536;
+}
+
+bool parse_cmdline(int argc, char const *argv[])
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        std::string name = arg.substr(0, arg.find('='));
+        std::string value = arg.find('=') != std::string::npos ? arg.substr(arg.find('=') + 1) : "";
+
+        if (name == "--listen") {
+            if (!parse_address(value, &listen_address, &listen_port)) {
+                std::cout << "Invalid listen address " << value << std::endl;
+                return false;
+            }
+        } else if (name == "--db") {
+            if (!parse_address(value, &db_address, &db_port)) {
+                std::cout << "Invalid database address " << value << std::endl;
+                return false;
+            }
+        } else if (name == "--threads") {
+            num_worker_threads = std::stoi(value);
+        } else if (name == "--control") {
+            control_port = std::stoi(value);
+        } else if (name == "--commands") {
+            commands_file = value;
+        } else if (name == "--exptime") {
+            cache_exptime = std::stoi(value);
+        } else {
+            std::cout << "Usage: ./lethe_swdataplane [options]" << std::endl;
+            std::cout << "Options: --listen=<ip>[:port] address of the data plane the clients send to (default 127.0.0.1:" << MEMCACHED_UDP_PORT << ")" << std::endl;
+            std::cout << "         --db=<ip>[:port] address of the database server (default 127.0.0.4:" << MEMCACHED_UDP_PORT << ")" << std::endl;
+            std::cout << "         --threads=<n> number of worker threads (default " << NUM_WORKER_THREADS << ")" << std::endl;
+            std::cout << "         --control=<port> TCP port of the control API on 127.0.0.1 (default " << CONTROL_PORT << ")" << std::endl;
+            std::cout << "         --commands=<file> control API commands run at startup, e.g. the ecmp and phot entries (default swdataplane-commands.txt, empty: none)" << std::endl;
+            std::cout << "         --exptime=<s> expiration time of the GATs and SETs to the caches (default " << CACHE_EXPTIME << ")" << std::endl;
+            return false;
+        }
+    }
+    if (num_worker_threads < 1 || num_worker_threads > 256) {
+        std::cout << "Number of worker threads must be between 1 and 256" << std::endl;
+        return false;
+    }
+    if (cache_exptime < 0) {
+        std::cout << "Expiration time must not be negative" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void handle_signal(int)
+{
+    stop_requested.store(true);
+}
+
+int main(int argc, char const *argv[])
+{
+    std::cout << "Lethe software data plane" << std::endl;
+
+    if (!parse_cmdline(argc, argv)) {
+        return 1;
+    }
+
+    struct in_addr a;
+    inet_pton(AF_INET, db_address.c_str(), &a);
+    db_server = pack_server(ntohl(a.s_addr), db_port);
+    for (uint32_t i = 0; i < REGISTER_SIZE; i++) {
+        loadbal_hotness[i].store(LOADBAL_NO_ENTRY);
+    }
+    apply_phot();
+
+    for (int i = 0; i < num_worker_threads; i++) {
+        worker *w = new worker();
+        if (!setup_worker(w, i)) {
+            return 1;
+        }
+        workers.push_back(w);
+    }
+    if (!commands_file.empty() && !run_commands_file(commands_file)) {
+        return 1;
+    }
+    int control_fd = open_control_socket();
+    if (control_fd < 0) {
+        return 1;
+    }
+
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+    for (worker *w : workers) {
+        w->thread = std::thread(worker_task, w);
+    }
+    std::cout << "Listening on " << listen_address << ":" << listen_port << " - Database: " << db_address << ":" << db_port << " - Worker threads: " << num_worker_threads << " - Control API: 127.0.0.1:" << control_port << std::endl;
+    for (uint32_t i = 0; i < NUM_SERVERS; i++) {
+        uint64_t server = ecmp_servers[i].load();
+        std::cout << "Cache " << i << ": " << (server != 0 ? server_string(server) : "none (ecmp entry missing)") << std::endl;
+    }
+
+    control_task(control_fd);
+    for (worker *w : workers) {
+        w->thread.join();
+    }
+    close(control_fd);
+
+    std::cout << stats_string() << std::endl;
+    return 0;
+}
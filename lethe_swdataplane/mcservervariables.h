@@ -0,0 +1,40 @@
+#pragma once
+
+// Variables of the Lethe Memcached stand-in server (lethe_mcserver.cpp, slab_store.h). MEMCACHED_UDP_PORT,
+// NUM_WORKER_THREADS, IO_BATCH_SIZE and DATAGRAM_SIZE are shared with the data plane (pipelinevariables.h)
+
+// Default TCP port (memcached -p), used by the TCP fill phase of mcloadgen_static (--fill=tcp)
+#define MEMCACHED_TCP_PORT 11211
+
+// Default memory for items in megabytes (memcached -m), allocated at startup
+#define STORE_MEMORY_MB 64
+
+// Shards of the item store, each with its own lock, hash table, pages and slab classes (power of two, at most 256)
+#define STORE_SHARDS 16
+
+// Size of a slab page in bytes. Pages are assigned to a slab class on demand and stay with it
+#define SLAB_PAGE_SIZE 65536
+
+// Chunk size of the smallest slab class in bytes and growth factor of the chunk sizes (memcached -n and -f)
+#define SLAB_CHUNK_MIN 96
+#define SLAB_GROWTH_FACTOR 1.25
+
+// Largest item (item header, key and value) in bytes, the chunk size of the largest slab class (at most SLAB_PAGE_SIZE)
+#define ITEM_SIZE_MAX 16384
+
+// Maximum key length (memcached KEY_MAX_LENGTH)
+#define KEY_SIZE_MAX 250
+
+// Bytes per response datagram including the frame header (memcached UDP_MAX_PAYLOAD_SIZE)
+#define UDP_PAYLOAD_SIZE 1400
+
+// Maximum response to one request datagram in bytes (values that don't fit are left out of a multi-get), and the
+// buffer of a TCP connection
+#define RESPONSE_SIZE_MAX 65536
+
+// Response datagrams a worker holds back for the service time (see --service-time). Requests that arrive while the
+// queue is full are dropped, like in a full socket buffer
+#define RESPONSE_QUEUE_SIZE 4096
+
+// Default service time per request in microseconds (see --service-time), 0: respond immediately
+#define SERVICE_TIME_US 0
@@ -0,0 +1,35 @@
+#pragma once
+
+// Variables of the Lethe software data plane (lethe_swdataplane.cpp). The first block are the constants of p4src/mcdslb.p4
+
+// Number of Memcached cache servers: HOT objects are spread over ecmp entries 0..NUM_SERVERS-1 by crc16(request id)
+#define NUM_SERVERS 2
+
+// Entries of the counterReg register, slb_hash = crc32(key) mod REGISTER_SIZE
+#define REGISTER_SIZE 65536
+
+// Maximum number of entries of the tables loadbal, ecmp and phot
+#define LOADBAL_TABLE_SIZE 1200
+#define ECMP_TABLE_SIZE 256
+#define PHOT_TABLE_SIZE 4
+
+// Default expiration time in seconds of the GATs to the caches and of the SETs that store database responses in the caches
+#define CACHE_EXPTIME 5
+
+// UDP port of the Memcached servers and default port of the data plane
+#define MEMCACHED_UDP_PORT 11212
+
+// Default number of worker threads. Each worker has its own socket on the listen address (SO_REUSEPORT)
+#define NUM_WORKER_THREADS 1
+
+// Datagrams per recvmmsg
+#define IO_BATCH_SIZE 64
+
+// Buffer per datagram in bytes. Memcached sends at most 1400 bytes per datagram, larger datagrams are dropped
+#define DATAGRAM_SIZE 2048
+
+// Upstream sockets of clients that sent nothing for this many seconds are closed
+#define FLOW_IDLE_TIMEOUT_S 60
+
+// Default TCP port of the control API on 127.0.0.1 (the Thrift port of simple_switch)
+#define CONTROL_PORT 9090
@@ -0,0 +1,135 @@
+#pragma once
+
+// Exponentially decayed space-saving top-K for the Lethe controller (lethe_controller.cpp)
+//
+// Keeps the popularity of at most {capacity} keys (slb_hash values). Every interval, all popularities are multiplied
+// by a decay factor (topk_decay) and the requests of the interval are added (topk_add). If the structure is full, a
+// new key replaces the key with the lowest popularity and starts with its popularity (space-saving): the popularity
+// of a key is overestimated by at most the popularity of the key it replaced, keys that stay in the structure are
+// counted exactly.
+// The decay is lazy: the entries store popularity * scale and a decay only raises the scale, so it costs O(1)
+// instead of a pass over all keys. The entries are rescaled before the scale gets too large.
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// the entries are rescaled when the scale exceeds this
+#define TOPK_MAX_SCALE 1e100
+
+struct topk_entry
+{
+    uint32_t key;
+    double weight;  // popularity * scale
+};
+
+struct popularity_topk
+{
+    std::vector<topk_entry> heap;                     // min-heap by weight
+    std::unordered_map<uint32_t, uint32_t> position;  // heap index by key
+    size_t capacity;
+    double scale;
+};
+
+inline void topk_init(popularity_topk &t, size_t capacity)
+{
+    t.heap.clear();
+    t.heap.reserve(capacity);
+    t.position.clear();
+    t.position.reserve(capacity * 2);
+    t.capacity = capacity;
+    t.scale = 1.0;
+}
+
+inline void topk_clear(popularity_topk &t)
+{
+    topk_init(t, t.capacity);
+}
+
+inline double topk_popularity(const popularity_topk &t, const topk_entry &e)
+{
+    return e.weight / t.scale;
+}
+
+inline void topk_swap(popularity_topk &t, size_t a, size_t b)
+{
+    std::swap(t.heap[a], t.heap[b]);
+    t.position[t.heap[a].key] = a;
+    t.position[t.heap[b].key] = b;
+}
+
+inline void topk_sift_up(popularity_topk &t, size_t i)
+{
+    while (i > 0 && t.heap[(i - 1) / 2].weight > t.heap[i].weight) {
+        topk_swap(t, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+inline void topk_sift_down(popularity_topk &t, size_t i)
+{
+    for (;;) {
+        size_t smallest = i;
+        size_t left = 2 * i + 1;
+        size_t right = left + 1;
+        if (left < t.heap.size() && t.heap[left].weight < t.heap[smallest].weight) {
+            smallest = left;
+        }
+        if (right < t.heap.size() && t.heap[right].weight < t.heap[smallest].weight) {
+            smallest = right;
+        }
+        if (smallest == i) {
+            return;
+        }
+        topk_swap(t, i, smallest);
+        i = smallest;
+    }
+}
+
+/* adds {popularity} to key {key}. A new key replaces the least popular key if the structure is full */
+inline void topk_add(popularity_topk &t, uint32_t key, double popularity)
+{
+    double weight = popularity * t.scale;
+    auto it = t.position.find(key);
+    if (it != t.position.end()) {
+        t.heap[it->second].weight += weight;
+        topk_sift_down(t, it->second);
+    } else if (t.heap.size() < t.capacity) {
+        t.heap.push_back({key, weight});
+        t.position[key] = t.heap.size() - 1;
+        topk_sift_up(t, t.heap.size() - 1);
+    } else if (t.capacity > 0) {
+        t.position.erase(t.heap[0].key);
+        t.heap[0].key = key;
+        t.heap[0].weight += weight;
+        t.position[key] = 0;
+        topk_sift_down(t, 0);
+    }
+}
+
+/* multiplies all popularities by {factor} (0 < factor <= 1) */
+inline void topk_decay(popularity_topk &t, double factor)
+{
+    t.scale /= factor;
+    if (t.scale > TOPK_MAX_SCALE) {
+        for (topk_entry &e : t.heap) {
+            e.weight /= t.scale;
+        }
+        t.scale = 1.0;
+    }
+}
+
+/* removes the keys with a popularity below {min_popularity} */
+inline void topk_prune(popularity_topk &t, double min_popularity)
+{
+    while (!t.heap.empty() && topk_popularity(t, t.heap[0]) < min_popularity) {
+        t.position.erase(t.heap[0].key);
+        t.heap[0] = t.heap.back();
+        t.heap.pop_back();
+        if (!t.heap.empty()) {
+            t.position[t.heap[0].key] = 0;
+            topk_sift_down(t, 0);
+        }
+    }
+}
@@ -0,0 +1,330 @@
+#pragma once
+
+// Item store of the Lethe Memcached stand-in server (lethe_mcserver.cpp)
+//
+// Hash table of items in memory that is allocated at startup, split into STORE_SHARDS shards with a lock each. Like
+// in Memcached, the memory of a shard is cut into pages of SLAB_PAGE_SIZE bytes, which are assigned on demand to slab
+// classes of growing chunk sizes; an item takes one chunk of the smallest class it fits into. Every class has a free
+// list and an LRU list: if a class has no free chunk and there is no page left, its least recently used item is
+// replaced (eviction). Items expire at their exptime and are removed when they are accessed or reach the tail of the
+// LRU. There is no slab rebalancing: a page stays with the class it was first assigned to.
+
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include "mcservervariables.h"
+
+#define SLAB_CLASSES_MAX 64
+
+// results of store_set
+#define STORE_STORED 0
+#define STORE_TOO_LARGE 1
+#define STORE_NO_MEMORY 2
+
+struct store_item
+{
+    store_item *hash_next;  // next item of the bucket, or of the free list
+    store_item *lru_prev;
+    store_item *lru_next;
+    int64_t exptime_s;      // monotonic seconds, 0: never
+    uint64_t hash;
+    uint32_t flags;
+    uint32_t nbytes;        // length of the value
+    uint8_t nkey;
+    uint8_t slab_class;
+    // followed by the key and the value
+};
+
+struct slab_class
+{
+    uint32_t chunk_size;
+    store_item *free_list;
+    store_item *lru_head;  // most recently used
+    store_item *lru_tail;
+    char *page_next;       // unused chunks of the newest page of the class
+    uint32_t page_chunks_left;
+};
+
+struct store_stats
+{
+    uint64_t items;
+    uint64_t evictions;
+    uint64_t expired;        // expired items removed
+    uint64_t out_of_memory;  // SETs without a free chunk and without an item to evict
+    uint64_t pages_used;
+    uint64_t pages;
+};
+
+struct alignas(64) store_shard
+{
+    std::mutex lock;
+    store_item **buckets;
+    uint64_t bucket_mask;
+    char *pages;
+    size_t num_pages;
+    size_t pages_used;
+    slab_class classes[SLAB_CLASSES_MAX];
+    store_stats stats;
+};
+
+struct slab_store
+{
+    store_shard shards[STORE_SHARDS];
+    int num_classes;
+};
+
+inline char *item_key(store_item *it)
+{
+    return (char *)(it + 1);
+}
+
+inline char *item_data(store_item *it)
+{
+    return item_key(it) + it->nkey;
+}
+
+inline bool item_expired(const store_item *it, int64_t now_s)
+{
+    return it->exptime_s != 0 && it->exptime_s <= now_s;
+}
+
+/* 64-bit FNV-1a. The shard is selected by the upper byte, the bucket by the lower bits */
+inline uint64_t store_hash(const char *key, size_t nkey)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < nkey; i++) {
+        h = (h ^ (uint8_t)key[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+inline store_shard &store_shard_of(slab_store &s, uint64_t hash)
+{
+    return s.shards[(hash >> 56) & (STORE_SHARDS - 1)];
+}
+
+/* sets up the slab classes and allocates {memory} bytes for the items (at least one page per shard) */
+inline void store_init(slab_store &s, size_t memory)
+{
+    uint32_t chunk_sizes[SLAB_CLASSES_MAX];
+    int n = 0;
+    double size = SLAB_CHUNK_MIN;
+    while (n < SLAB_CLASSES_MAX - 1 && size < ITEM_SIZE_MAX) {
+        chunk_sizes[n++] = ((uint32_t)size + 7) & ~7u;
+        size *= SLAB_GROWTH_FACTOR;
+    }
+    chunk_sizes[n++] = ITEM_SIZE_MAX;
+    s.num_classes = n;
+
+    for (store_shard &sh : s.shards) {
+        sh.num_pages = memory / STORE_SHARDS / SLAB_PAGE_SIZE;
+        if (sh.num_pages == 0) {
+            sh.num_pages = 1;
+        }
+        sh.pages_used = 0;
+        // touch the pages, so the kernel allocates them now and not while serving requests
+        sh.pages = new char[sh.num_pages * SLAB_PAGE_SIZE];
+        memset(sh.pages, 0, sh.num_pages * SLAB_PAGE_SIZE);
+
+        uint64_t buckets = 1;
+        while (buckets < sh.num_pages * SLAB_PAGE_SIZE / SLAB_CHUNK_MIN) {
+            buckets <<= 1;
+        }
+        sh.buckets = new store_item *[buckets]();
+        sh.bucket_mask = buckets - 1;
+
+        for (int i = 0; i < n; i++) {
+            sh.classes[i] = {chunk_sizes[i], nullptr, nullptr, nullptr, nullptr, 0};
+        }
+        sh.stats = {0, 0, 0, 0, 0, sh.num_pages};
+    }
+}
+
+/* smallest slab class of an item of {size} bytes, -1 if it is too large */
+inline int store_class(const slab_store &s, size_t size)
+{
+    for (int i = 0; i < s.num_classes; i++) {
+        if (size <= s.shards[0].classes[i].chunk_size) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+inline void lru_unlink(slab_class &c, store_item *it)
+{
+    (it->lru_prev != nullptr ? it->lru_prev->lru_next : c.lru_head) = it->lru_next;
+    (it->lru_next != nullptr ? it->lru_next->lru_prev : c.lru_tail) = it->lru_prev;
+}
+
+inline void lru_push(slab_class &c, store_item *it)
+{
+    it->lru_prev = nullptr;
+    it->lru_next = c.lru_head;
+    (c.lru_head != nullptr ? c.lru_head->lru_prev : c.lru_tail) = it;
+    c.lru_head = it;
+}
+
+/* removes item {it} from its bucket and its LRU and puts its chunk on the free list */
+inline void store_free(store_shard &sh, store_item *it)
+{
+    store_item **p = &sh.buckets[it->hash & sh.bucket_mask];
+    while (*p != it) {
+        p = &(*p)->hash_next;
+    }
+    *p = it->hash_next;
+    slab_class &c = sh.classes[it->slab_class];
+    lru_unlink(c, it);
+    it->hash_next = c.free_list;
+    c.free_list = it;
+    sh.stats.items--;
+}
+
+/* item with key {key}, nullptr if there is none. An expired item is freed */
+inline store_item *store_find(store_shard &sh, uint64_t hash, const char *key, size_t nkey, int64_t now_s)
+{
+    store_item *it = sh.buckets[hash & sh.bucket_mask];
+    while (it != nullptr && (it->hash != hash || it->nkey != nkey || memcmp(item_key(it), key, nkey) != 0)) {
+        it = it->hash_next;
+    }
+    if (it != nullptr && item_expired(it, now_s)) {
+        store_free(sh, it);
+        sh.stats.expired++;
+        return nullptr;
+    }
+    return it;
+}
+
+/* chunk of slab class {cls}: a free chunk, a chunk of a new page or the chunk of the least recently used item of
+ * the class. nullptr if the class has none of them */
+inline store_item *store_alloc(store_shard &sh, int cls, int64_t now_s)
+{
+    slab_class &c = sh.classes[cls];
+    if (c.free_list == nullptr && c.page_chunks_left == 0 && sh.pages_used < sh.num_pages) {
+        c.page_next = sh.pages + sh.pages_used * SLAB_PAGE_SIZE;
+        c.page_chunks_left = SLAB_PAGE_SIZE / c.chunk_size;
+        sh.pages_used++;
+        sh.stats.pages_used++;
+    }
+    if (c.free_list == nullptr && c.page_chunks_left > 0) {
+        store_item *it = (store_item *)c.page_next;
+        c.page_next += c.chunk_size;
+        c.page_chunks_left--;
+        return it;
+    }
+    if (c.free_list == nullptr && c.lru_tail != nullptr) {
+        if (item_expired(c.lru_tail, now_s)) {
+            sh.stats.expired++;
+        } else {
+            sh.stats.evictions++;
+        }
+        store_free(sh, c.lru_tail);
+    }
+    store_item *it = c.free_list;
+    if (it != nullptr) {
+        c.free_list = it->hash_next;
+    }
+    return it;
+}
+
+/* calls {f}(item) with the item of key {key} while the shard is locked, false if there is none. If {touch}, the
+ * exptime of the item is set to {exptime_s} (gat) */
+template <typename F>
+inline bool store_get(slab_store &s, const char *key, size_t nkey, int64_t now_s, bool touch, int64_t exptime_s, F f)
+{
+    uint64_t hash = store_hash(key, nkey);
+    store_shard &sh = store_shard_of(s, hash);
+    std::lock_guard<std::mutex> guard(sh.lock);
+    store_item *it = store_find(sh, hash, key, nkey, now_s);
+    if (it == nullptr) {
+        return false;
+    }
+    if (touch) {
+        it->exptime_s = exptime_s;
+    }
+    slab_class &c = sh.classes[it->slab_class];
+    if (c.lru_head != it) {
+        lru_unlink(c, it);
+        lru_push(c, it);
+    }
+    f(it);
+    return true;
+}
+
+/* stores value {data} under key {key}, returns STORE_STORED, STORE_TOO_LARGE or STORE_NO_MEMORY. Like in
+ * Memcached, the old item is removed even if the new one can't be stored */
+inline int store_set(slab_store &s, const char *key, size_t nkey, uint32_t flags, int64_t exptime_s, const char *data, size_t nbytes, int64_t now_s)
+{
+    uint64_t hash = store_hash(key, nkey);
+    store_shard &sh = store_shard_of(s, hash);
+    int cls = store_class(s, sizeof(store_item) + nkey + nbytes);
+    std::lock_guard<std::mutex> guard(sh.lock);
+    store_item *old = store_find(sh, hash, key, nkey, now_s);
+    if (old != nullptr) {
+        store_free(sh, old);
+    }
+    if (cls < 0) {
+        return STORE_TOO_LARGE;
+    }
+    store_item *it = store_alloc(sh, cls, now_s);
+    if (it == nullptr) {
+        sh.stats.out_of_memory++;
+        return STORE_NO_MEMORY;
+    }
+    it->exptime_s = exptime_s;
+    it->hash = hash;
+    it->flags = flags;
+    it->nbytes = nbytes;
+    it->nkey = nkey;
+    it->slab_class = cls;
+    memcpy(item_key(it), key, nkey);
+    memcpy(item_data(it), data, nbytes);
+    it->hash_next = sh.buckets[hash & sh.bucket_mask];
+    sh.buckets[hash & sh.bucket_mask] = it;
+    lru_push(sh.classes[cls], it);
+    sh.stats.items++;
+    return STORE_STORED;
+}
+
+/* removes the item with key {key}, false if there is none */
+inline bool store_delete(slab_store &s, const char *key, size_t nkey, int64_t now_s)
+{
+    uint64_t hash = store_hash(key, nkey);
+    store_shard &sh = store_shard_of(s, hash);
+    std::lock_guard<std::mutex> guard(sh.lock);
+    store_item *it = store_find(sh, hash, key, nkey, now_s);
+    if (it == nullptr) {
+        return false;
+    }
+    store_free(sh, it);
+    return true;
+}
+
+/* removes all items (flush_all) */
+inline void store_flush(slab_store &s)
+{
+    for (store_shard &sh : s.shards) {
+        std::lock_guard<std::mutex> guard(sh.lock);
+        for (int i = 0; i < s.num_classes; i++) {
+            while (sh.classes[i].lru_head != nullptr) {
+                store_free(sh, sh.classes[i].lru_head);
+            }
+        }
+    }
+}
+
+/* stats summed over all shards */
+inline store_stats store_sum_stats(slab_store &s)
+{
+    store_stats sum = {0, 0, 0, 0, 0, 0};
+    for (store_shard &sh : s.shards) {
+        std::lock_guard<std::mutex> guard(sh.lock);
+        sum.items += sh.stats.items;
+        sum.evictions += sh.stats.evictions;
+        sum.expired += sh.stats.expired;
+        sum.out_of_memory += sh.stats.out_of_memory;
+        sum.pages_used += sh.stats.pages_used;
+        sum.pages += sh.stats.pages;
+    }
+    return sum;
+}
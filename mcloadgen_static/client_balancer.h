@@ -0,0 +1,104 @@
+#pragma once
+
+// Client-side load balancing of the Memcached load generator (mcloadgen_static.cpp, --lb), the baseline Lethe is
+// compared with: the load generator spreads the GETs over the caches itself and fetches cache misses from the database
+// (look-aside), instead of sending everything to the Lethe data plane.
+// - ketama: consistent hashing of the key onto a ring with KETAMA_POINTS points per cache (like libketama, with
+//   FNV-1a instead of MD5), every key has one home cache
+// - p2c: power of two choices, of two random caches the one with fewer requests without response
+// - hotkey: ketama, but the most popular keys of a local top-K are replicated on all caches and their requests are
+//   spread over the caches round-robin by request id, like the HOT objects of Lethe. Every client (sender thread) has
+//   its own top-K, decayed like the popularity of the Lethe controller (popularity_topk.h)
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../lethe_swdataplane/popularity_topk.h"
+
+// at most 8 caches: the cache id of letheinfo has 3 bits
+#define LB_MAX_CACHES 8
+
+// points of a cache on the ketama ring
+#define KETAMA_POINTS 160
+
+/* 32-bit FNV-1a hash of [{p}, {p} + {len}) */
+inline uint32_t fnv1a_hash(const char *p, size_t len)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (uint8_t)p[i]) * 16777619u;
+    }
+    return h;
+}
+
+/* ketama ring: the points of all caches sorted by their hash, a key belongs to the first point at or after its hash */
+struct ketama_ring
+{
+    std::vector<std::pair<uint32_t, uint8_t>> points;  // hash, cache
+};
+
+/* builds the ring of the caches {names} (e.g. "10.0.0.2:11212"), point i of a cache is the hash of "<name>-<i>" */
+inline void ketama_build(ketama_ring &ring, const std::vector<std::string> &names)
+{
+    ring.points.clear();
+    for (size_t cache = 0; cache < names.size(); cache++) {
+        for (int i = 0; i < KETAMA_POINTS; i++) {
+            std::string point = names[cache] + "-" + std::to_string(i);
+            ring.points.emplace_back(fnv1a_hash(point.data(), point.size()), (uint8_t)cache);
+        }
+    }
+    std::sort(ring.points.begin(), ring.points.end());
+}
+
+/* cache of the key [{key}, {key} + {len}) */
+inline int ketama_lookup(const ketama_ring &ring, const char *key, size_t len)
+{
+    uint32_t h = fnv1a_hash(key, len);
+    auto it = std::lower_bound(ring.points.begin(), ring.points.end(), std::make_pair(h, (uint8_t)0));
+    return it == ring.points.end() ? ring.points[0].second : it->second;
+}
+
+/* hot keys of a client: a decayed top-K of the requested objects, of which the {num_hot} most popular are hot */
+struct hotkey_tracker
+{
+    popularity_topk topk;
+    std::vector<uint8_t> is_hot;    // by object
+    std::vector<uint32_t> hot;      // the hot objects
+    size_t num_hot;
+};
+
+inline void hotkey_init(hotkey_tracker &t, size_t num_objects, size_t capacity, size_t num_hot)
+{
+    topk_init(t.topk, capacity);
+    t.is_hot.assign(num_objects, 0);
+    t.hot.clear();
+    t.num_hot = num_hot;
+}
+
+/* counts a request of {object} */
+inline void hotkey_record(hotkey_tracker &t, uint32_t object)
+{
+    topk_add(t.topk, object, 1.0);
+}
+
+/* end of an interval: the {num_hot} most popular objects of the top-K become the hot objects, then all popularities
+ * are multiplied by {decay} */
+inline void hotkey_update(hotkey_tracker &t, double decay)
+{
+    for (uint32_t object : t.hot) {
+        t.is_hot[object] = 0;
+    }
+    std::vector<topk_entry> entries = t.topk.heap;
+    size_t n = std::min(t.num_hot, entries.size());
+    std::partial_sort(entries.begin(), entries.begin() + n, entries.end(), [](const topk_entry &a, const topk_entry &b) {
+        return a.weight > b.weight;
+    });
+    t.hot.clear();
+    for (size_t i = 0; i < n; i++) {
+        t.hot.push_back(entries[i].key);
+        t.is_hot[entries[i].key] = 1;
+    }
+    topk_decay(t.topk, decay);
+}
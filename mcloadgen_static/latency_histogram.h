@@ -0,0 +1,147 @@
+#pragma once
+
+// Latency histogram for the Memcached load generator (mcloadgen_static.cpp)
+//
+// HDR-style log-linear histogram of 32-bit values (microseconds): values below 2^HIST_SUB_BUCKET_BITS are
+// counted exactly, larger values in buckets of 2^HIST_SUB_BUCKET_BITS/2 linear sub-buckets per power of
+// two, so every recorded value is known to within 1/2^(HIST_SUB_BUCKET_BITS-1) of its size. Recording is
+// a few instructions and never allocates. A histogram is written by one thread only (no locks); the histograms
+// of all threads are merged after the test. The writer uses relaxed atomic stores (plain stores on x86), so
+// another thread can take a consistent-enough copy of a histogram while it is written (hist_merge_live).
+
+#include <cstdint>
+#include <cstring>
+
+#define HIST_SUB_BUCKET_BITS 8
+#define HIST_SUB_BUCKETS (1 << HIST_SUB_BUCKET_BITS)
+#define HIST_HALF_SUB_BUCKETS (HIST_SUB_BUCKETS / 2)
+#define HIST_NUM_BUCKETS ((32 - HIST_SUB_BUCKET_BITS + 2) * HIST_HALF_SUB_BUCKETS)
+
+struct latency_histogram
+{
+    uint64_t count;
+    uint64_t sum;
+    uint32_t min;
+    uint32_t max;
+    uint32_t buckets[HIST_NUM_BUCKETS];
+};
+
+inline void hist_reset(latency_histogram &h)
+{
+    memset(&h, 0, sizeof(h));
+    h.min = UINT32_MAX;
+}
+
+/* bucket of {value} */
+inline int hist_bucket(uint32_t value)
+{
+    if (value < HIST_SUB_BUCKETS) {
+        return value;
+    }
+    int shift = (31 - __builtin_clz(value)) - (HIST_SUB_BUCKET_BITS - 1);
+    return shift * HIST_HALF_SUB_BUCKETS + (value >> shift);
+}
+
+/* highest value counted in {bucket} */
+inline uint32_t hist_bucket_max(int bucket)
+{
+    if (bucket < HIST_SUB_BUCKETS) {
+        return bucket;
+    }
+    int shift = bucket / HIST_HALF_SUB_BUCKETS - 1;
+    uint64_t sub_bucket = bucket % HIST_HALF_SUB_BUCKETS + HIST_HALF_SUB_BUCKETS;
+    return (uint32_t)(((sub_bucket + 1) << shift) - 1);
+}
+
+inline void hist_record(latency_histogram &h, uint32_t value)
+{
+    uint32_t &bucket = h.buckets[hist_bucket(value)];
+    __atomic_store_n(&bucket, bucket + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&h.count, h.count + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&h.sum, h.sum + value, __ATOMIC_RELAXED);
+    if (value < h.min) {
+        __atomic_store_n(&h.min, value, __ATOMIC_RELAXED);
+    }
+    if (value > h.max) {
+        __atomic_store_n(&h.max, value, __ATOMIC_RELAXED);
+    }
+}
+
+/* adds all values of {src} to {dst} */
+inline void hist_merge(latency_histogram &dst, const latency_histogram &src)
+{
+    for (int i = 0; i < HIST_NUM_BUCKETS; i++) {
+        dst.buckets[i] += src.buckets[i];
+    }
+    dst.count += src.count;
+    dst.sum += src.sum;
+    if (src.min < dst.min) {
+        dst.min = src.min;
+    }
+    if (src.max > dst.max) {
+        dst.max = src.max;
+    }
+}
+
+/* hist_merge of a histogram that is written at the same time by another thread (e.g. for live telemetry).
+ * The counts of the buckets and the total count may differ by the values recorded during the copy */
+inline void hist_merge_live(latency_histogram &dst, const latency_histogram &src)
+{
+    for (int i = 0; i < HIST_NUM_BUCKETS; i++) {
+        dst.buckets[i] += __atomic_load_n(&src.buckets[i], __ATOMIC_RELAXED);
+    }
+    dst.count += __atomic_load_n(&src.count, __ATOMIC_RELAXED);
+    dst.sum += __atomic_load_n(&src.sum, __ATOMIC_RELAXED);
+    uint32_t min = __atomic_load_n(&src.min, __ATOMIC_RELAXED);
+    uint32_t max = __atomic_load_n(&src.max, __ATOMIC_RELAXED);
+    if (min < dst.min) {
+        dst.min = min;
+    }
+    if (max > dst.max) {
+        dst.max = max;
+    }
+}
+
+/* values recorded in {now} but not yet in {before}, an earlier copy of the same histogram. Minimum and maximum
+ * are those of the buckets with values */
+inline void hist_delta(latency_histogram &dst, const latency_histogram &now, const latency_histogram &before)
+{
+    hist_reset(dst);
+    for (int i = 0; i < HIST_NUM_BUCKETS; i++) {
+        dst.buckets[i] = now.buckets[i] >= before.buckets[i] ? now.buckets[i] - before.buckets[i] : 0;
+        if (dst.buckets[i] != 0) {
+            dst.count += dst.buckets[i];
+            dst.max = hist_bucket_max(i);
+            if (dst.min == UINT32_MAX) {
+                dst.min = i == 0 ? 0 : hist_bucket_max(i - 1) + 1;
+            }
+        }
+    }
+    dst.sum = now.sum >= before.sum ? now.sum - before.sum : 0;
+}
+
+/* value below which {percentile} percent of the recorded values are (highest value of its bucket, at most max) */
+inline uint32_t hist_percentile(const latency_histogram &h, double percentile)
+{
+    if (h.count == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(percentile / 100.0 * h.count + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_NUM_BUCKETS; i++) {
+        seen += h.buckets[i];
+        if (seen >= rank) {
+            uint32_t value = hist_bucket_max(i);
+            return value < h.max ? value : h.max;
+        }
+    }
+    return h.max;
+}
+
+inline uint64_t hist_mean(const latency_histogram &h)
+{
+    return h.count ? h.sum / h.count : 0;
+}
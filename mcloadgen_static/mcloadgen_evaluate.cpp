@@ -0,0 +1,227 @@
+/* Evaluation of a mcloadgen_static binary result log (test/mclgs_results<Run ID>.bin, see result_log.h)
+ * Computes the same per-second aggregates and averages as mcloadgen_evaluate.py in one pass over the
+ * memory-mapped log and appends the averages as a row to a results csv file.
+ *
+ * Usage: mcloadgen_evaluate <result log> <results csv> [--csv=<raw csv>]
+ *   --csv  additionally appends every record to <raw csv> (columns of the mcloadgen_static csv file)
+ */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "result_log.h"
+
+/* results of one second of the test */
+struct results_object
+{
+    uint32_t num_requests = 0;
+    uint64_t sum_response_time_us = 0;
+    uint32_t num_hits = 0;
+    uint32_t num_cold = 0;
+    uint32_t num_warm1 = 0;
+    uint32_t num_warm2 = 0;
+    uint32_t num_hot = 0;
+    uint32_t num_db_response = 0;
+    uint32_t num_cache_2 = 0;       // total no. requests sent to cache 2
+    uint32_t num_cache_3 = 0;       // total no. requests sent to cache 3
+    uint32_t num_cache_2_miss = 0;  // no. requests sent to cache 2, but responded by database
+    uint32_t num_cache_3_miss = 0;  // no. requests sent to cache 3, but responded by database
+    uint32_t num_db_cold = 0;
+    uint32_t num_db_noncold = 0;
+    uint32_t min_response_time_us = 100000000;
+    uint32_t max_response_time_us = 0;
+};
+
+/* maps the result log {filename} into memory. Returns the records and their number or nullptr if the file isn't a result log */
+const result_log_record *map_result_log(const char *filename, size_t *num_records)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        std::cout << "Can't open " << filename << std::endl;
+        return nullptr;
+    }
+    struct stat st;
+    fstat(fd, &st);
+    if ((size_t)st.st_size < sizeof(result_log_header)) {
+        std::cout << filename << " is not a result log" << std::endl;
+        close(fd);
+        return nullptr;
+    }
+
+    void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        std::cout << "Can't map " << filename << std::endl;
+        return nullptr;
+    }
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+    const result_log_header *header = (const result_log_header *)data;
+    if (memcmp(header->magic, RESULT_LOG_MAGIC, 8) != 0 || header->version != RESULT_LOG_VERSION || header->record_size != sizeof(result_log_record)) {
+        std::cout << filename << " is not a result log of version " << RESULT_LOG_VERSION << std::endl;
+        return nullptr;
+    }
+
+    // the number of records in the header is 0 if the test didn't finish, use what was written
+    *num_records = (st.st_size - sizeof(result_log_header)) / sizeof(result_log_record);
+    if (header->num_records != 0 && header->num_records < *num_records) {
+        *num_records = header->num_records;
+    }
+    return (const result_log_record *)((const char *)data + sizeof(result_log_header));
+}
+
+/* parses the results and returns one results_object per second of the test (index = second) */
+std::vector<results_object> parse_results(const result_log_record *records, size_t num_records)
+{
+    std::vector<results_object> results_per_second;
+
+    for (size_t i = 0; i < num_records; i++) {
+        const result_log_record &rec = records[i];
+        int hotness = rec.letheinfo & 0b00000111;
+        bool db_response = (rec.letheinfo >> 4) & 1;
+        int cache_id = (rec.letheinfo >> 5) & 0b00000111;
+
+        size_t second = rec.timestamp_us < 0 ? 0 : rec.timestamp_us / 1000000;
+        if (second >= results_per_second.size()) {
+            results_per_second.resize(second + 1);
+        }
+        results_object &r = results_per_second[second];
+        r.num_requests += 1;
+        r.sum_response_time_us += rec.response_time_us;
+        r.num_hits += (rec.flags & RESULT_FLAG_HIT) ? 1 : 0;
+        if (hotness == 0) r.num_cold += 1;
+        else if (hotness == 1) r.num_warm1 += 1;
+        else if (hotness == 2) r.num_hot += 1;
+        else if (hotness == 3) r.num_warm2 += 1;
+        r.num_db_response += db_response ? 1 : 0;
+        if (cache_id == 2) r.num_cache_2 += 1;
+        else if (cache_id == 3) r.num_cache_3 += 1;
+        if (db_response && cache_id == 2) r.num_cache_2_miss += 1;
+        else if (db_response && cache_id == 3) r.num_cache_3_miss += 1;
+        if (db_response && hotness == 0) r.num_db_cold += 1;
+        if (db_response && hotness != 0) r.num_db_noncold += 1;
+        r.min_response_time_us = std::min(r.min_response_time_us, rec.response_time_us);
+        r.max_response_time_us = std::max(r.max_response_time_us, rec.response_time_us);
+    }
+
+    return results_per_second;
+}
+
+/* appends all records to {filename} in the format of the mcloadgen_static csv file (without header) */
+void write_raw_csv(const char *filename, const result_log_record *records, size_t num_records)
+{
+    FILE *f = fopen(filename, "a");
+    if (f == nullptr) {
+        std::cout << "Can't open " << filename << std::endl;
+        return;
+    }
+    for (size_t i = 0; i < num_records; i++) {
+        const result_log_record &rec = records[i];
+        fprintf(f, "%ld,%u,%u,%d,%d,%d,%d,%u,\n", rec.timestamp_us, rec.request_id, rec.response_time_us, rec.flags & RESULT_FLAG_HIT,
+            rec.letheinfo & 0b00000111, (rec.letheinfo >> 4) & 1, (rec.letheinfo >> 5) & 0b00000111, rec.intended_response_time_us);
+    }
+    fclose(f);
+}
+
+int main(int argc, char const *argv[])
+{
+    if (argc < 3) {
+        std::cout << "Error. Syntax: " << argv[0] << " <result log, e.g. test/mclgs_results0.bin> <results csv> [--csv=<raw csv>]" << std::endl;
+        return 1;
+    }
+
+    size_t num_records = 0;
+    const result_log_record *records = map_result_log(argv[1], &num_records);
+    if (records == nullptr) {
+        return 1;
+    }
+
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--csv=", 0) == 0) {
+            write_raw_csv(arg.substr(6).c_str(), records, num_records);
+        } else {
+            std::cout << "Unknown option " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<results_object> results = parse_results(records, num_records);
+
+    // to eliminate first two update intervals from the results as they will only have results from database
+    uint64_t sum_response_time = 0;
+    uint64_t sum_requests = 0, sum_cold = 0, sum_warm1 = 0, sum_warm2 = 0, sum_hot = 0, sum_db_response = 0, sum_cache2 = 0, sum_cache3 = 0;
+    uint64_t cache2_num_misses = 0, cache3_num_misses = 0;
+    int num_seconds = 0;
+
+    std::cout << "Req.\tCold\tWarm1\tWarm2\tHot\tDB\tCache2\tCache3\tC2Miss\tC3Miss\tTrsMin\tTrsMax" << std::endl;
+    for (size_t second = 2; second < results.size(); second++) {
+        const results_object &r = results[second];
+        if (r.num_requests == 0) {
+            continue;  // no responses in this second
+        }
+        std::cout << r.num_requests << "\t" << r.num_cold << "\t" << r.num_warm1 << "\t" << r.num_warm2 << "\t" << r.num_hot << "\t"
+            << r.num_db_response << "\t" << r.num_cache_2 << "\t" << r.num_cache_3 << "\t" << r.num_cache_2_miss << "\t"
+            << r.num_cache_3_miss << "\t" << r.min_response_time_us << "\t" << r.max_response_time_us << std::endl;
+
+        sum_response_time += r.sum_response_time_us;
+        sum_requests += r.num_requests;
+        sum_cold += r.num_cold;
+        sum_warm1 += r.num_warm1;
+        sum_warm2 += r.num_warm2;
+        sum_hot += r.num_hot;
+        sum_db_response += r.num_db_response;
+        sum_cache2 += r.num_cache_2;
+        sum_cache3 += r.num_cache_3;
+        cache2_num_misses += r.num_cache_2_miss;
+        cache3_num_misses += r.num_cache_3_miss;
+        num_seconds++;
+    }
+
+    if (num_seconds == 0) {
+        std::cout << "No responses after the first two seconds" << std::endl;
+        return 1;
+    }
+
+    double avg_response_time = (double)sum_response_time / sum_requests;
+    double avg_num_requests = (double)sum_requests / num_seconds;
+    double avg_num_cold = (double)sum_cold / num_seconds;
+    double avg_num_warm1 = (double)sum_warm1 / num_seconds;
+    double avg_num_warm2 = (double)sum_warm2 / num_seconds;
+    double avg_num_hot = (double)sum_hot / num_seconds;
+    double avg_num_db_response = (double)sum_db_response / num_seconds;
+    double avg_num_cache2 = (double)sum_cache2 / num_seconds;
+    double avg_num_cache3 = (double)sum_cache3 / num_seconds;
+    double ratio_rate_cache2 = avg_num_cache2 / avg_num_requests;
+    double ratio_rate_cache3 = avg_num_cache3 / avg_num_requests;
+    double cache2_hit_rate = sum_cache2 ? (double)(sum_cache2 - cache2_num_misses) / sum_cache2 : 0;
+    double cache3_hit_rate = sum_cache3 ? (double)(sum_cache3 - cache3_num_misses) / sum_cache3 : 0;
+
+    std::cout << "Average Num Requests =  " << avg_num_requests << std::endl;
+    std::cout << "Average Num Cold =  " << avg_num_cold << std::endl;
+    std::cout << "Average Num Warm1 =  " << avg_num_warm1 << std::endl;
+    std::cout << "Average Num Warm2 =  " << avg_num_warm2 << std::endl;
+    std::cout << "Average Num Hot =  " << avg_num_hot << std::endl;
+    std::cout << "Average Num Cache 2 =  " << avg_num_cache2 << std::endl;
+    std::cout << "R2 =  " << ratio_rate_cache2 << std::endl;
+    std::cout << "R3 =  " << ratio_rate_cache3 << std::endl;
+    std::cout << "Hitrate Cache 2 =  " << cache2_hit_rate << std::endl;
+    std::cout << "Hitrate Cache 3 =  " << cache3_hit_rate << std::endl;
+    std::cout << "Average Response Time (us) =  " << avg_response_time << std::endl;
+
+    // same columns as mcloadgen_evaluate.py
+    std::ofstream f(argv[2], std::ios::app);
+    f.precision(17);
+    f << avg_response_time << "," << avg_num_requests << "," << avg_num_cold << "," << avg_num_warm1 << "," << avg_num_warm2 << ","
+        << avg_num_hot << "," << avg_num_db_response << "," << avg_num_cache2 << "," << avg_num_cache3 << "," << ratio_rate_cache2 << ","
+        << ratio_rate_cache3 << "," << cache2_hit_rate << "," << cache3_hit_rate << "\r\n";
+    f.close();
+
+    return 0;
+}
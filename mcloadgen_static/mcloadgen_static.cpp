@@ -1,9 +1,11 @@
 /* Very fast Memcached load generator "mcloadgen_static"
  * Algorithm:
- * - Generate random objects (key, value, inter-request time)
+ * - Generate random objects (key, value, inter-request time) from a seed, in parallel "generate_objects"
  * - Store all objects in the cache
  * - Schedule and send the requests for the object "schedule_task"
- * - Receive responses in a separate thread and calculate the response time and hits/misses "receive_memc_response_task"
+ * - Receive responses in a separate thread and calculate the response time and hits/misses "receive_memc_response_task".
+ *   Responses of more than one datagram are reassembled and every response is validated "process_datagram"
+ * - Optionally run multiple sender threads, each with its own socket and receive thread "run_sender_workers"
  * 
  * Characteristics:
  * - Static objects (generated when program is started)
@@ -11,6 +13,27 @@
  * - Expiration time will not be extended on get (not "gat")
  * - GET requests via UDP
  * - Fills cache with objects and random data (over UDP)
+ * - Requests are encoded once at startup "build_request_arena" and sent without copying (gather I/O)
+ * - Optionally batched I/O with sendmmsg/recvmmsg "queue_get_request", "receive_memc_response_batch_task"
+ * - Open-loop request pacing with constant or Poisson inter-arrival times "open_loop_task". Response times are
+ *   measured from the actual and from the intended time of request (coordinated omission correction)
+ * - Optionally closed loop with virtual clients that wait for their responses "closed_loop_task", or a ramp of
+ *   increasing request rates until a p99 SLO or loss threshold is broken "run_ramp"
+ * - Response times are recorded in per-thread latency histograms per hotness, cache and DB/cache response
+ *   "record_latency". Optionally every response is streamed to a binary result log while the test runs
+ *   (result_log.h, evaluated by mcloadgen_evaluate) or kept in memory and written to a CSV file
+ * - Optionally live telemetry: a snapshot of the counters and histograms of all threads is written in Prometheus
+ *   text format every interval "telemetry_task"
+ * - Optionally a calibrated TSC clock for the userspace timestamps (tsc_clock.h) and kernel/NIC transmit and receive
+ *   timestamps (SO_TIMESTAMPING) to measure the response time without the load generator "receive_memc_response_timestamping_task"
+ * - Optionally an io_uring backend (uring.h): one thread per socket submits the requests and receives the responses
+ *   with a multishot receive into a provided buffer ring "uring_process_completions"
+ * - Optionally raw Ethernet/IPv4/UDP frames with precomputed checksums through the AF_PACKET rings of one interface
+ *   (packet_ring.h), sent and received by the sender thread "packet_queue_get_request", "packet_process_frames"
+ * - Optionally popularity phases: the Zipf ranks are mapped to other objects every interval, and the time until the
+ *   new hot objects come back HOT/WARM is measured "shifted_object", "record_shift_response", "print_shift_results"
+ * - Optionally replay of a memory-mapped request trace (CSV or binary, trace_replay.h) at the trace's inter-arrival
+ *   times: its keys become the objects, mapped to fixed-length keys "load_trace", "trace_task"
  *
  * David Munstein @ NCS, October 2022
  */
@@ -22,13 +45,33 @@
 #include <thread>
 #include <map>
 #include <mutex>
+#include <condition_variable>
+#include <atomic>
 #include <string>
+#include <algorithm>
+#include <deque>
+#include <unordered_map>
+#include <string_view>
 #include <boost/array.hpp>
 #include <boost/asio.hpp>
 #include <boost/thread.hpp>
 //#include <libmemcached/memcached.h>
 #include <math.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <time.h>
 #include "testvariables.h"
+#include "request_table.h"
+#include "zipf.h"
+#include "latency_histogram.h"
+#include "result_log.h"
+#include "tsc_clock.h"
+#include "uring.h"
+#include "packet_ring.h"
+#include "trace_replay.h"
+#include "client_balancer.h"
+#include <linux/net_tstamp.h>
+#include <linux/errqueue.h>
 
 // using namespace std;
 using namespace boost::asio;
@@ -39,11 +82,52 @@ int total_request_limit;
 int run_id; //This is to determine which run of the experiment it is? Used to diferentaite the output files
 
 const int key_length = KEY_LENGTH;
-const int value_size_min = VALUE_SIZE_MIN;
-const int value_size_max = VALUE_SIZE_MAX;
+int value_size_min = VALUE_SIZE_MIN;
+int value_size_max = VALUE_SIZE_MAX;
 const int percent_hot = 1; // The 5% of object with lowest inter-requets time are considered HOT
-const int test_duration_seconds = TEST_DURATION_SECONDS;
+int test_duration_seconds = TEST_DURATION_SECONDS;  // duration of a step in ramp mode
 int distribution_type = 0;
+int num_sender_threads = NUM_SENDER_THREADS;
+int batch_size = IO_BATCH_SIZE;                 // requests per sendmmsg and responses per recvmmsg (1 = no batching)
+int batch_timeout_us = IO_BATCH_TIMEOUT_US;     // a batch is sent at the latest this long after its first request was queued
+int arrival_process = ARRIVAL_PROCESS;          // inter-arrival times of distribution 1 and 2: 0=constant 1=Poisson (exponential)
+int fill_mode = FILL_MODE;                      // transport of the fill phase: 0=UDP (windowed) 1=TCP (pipelined, noreply)
+bool fill_verify = true;                        // verify that all objects are present after the fill phase
+uint64_t object_seed = 0;                       // seed of the objects, values and request sequences (--seed, random if not given)
+bool zipf_scramble = false;                     // map Zipf ranks to objects with a random permutation instead of rank k -> object k-1
+int record_mode = 0;                            // record of every response: 0=none 1=binary result log (streamed) 2=CSV file
+int num_clients = 0;                            // closed loop: number of virtual clients of all sender threads (0 = open loop)
+int max_outstanding = 0;                        // closed loop: maximum number of requests without response of all sender threads (0 = one per client)
+int think_time_us = 0;                          // closed loop: time a virtual client waits after a response before its next request
+int ramp_start_rps = 0;                         // ramp mode: request rate of the first step (0 = no ramp)
+int ramp_step_rps = 0;                          // ramp mode: increase of the request rate per step
+int ramp_step_seconds = RAMP_STEP_SECONDS;      // ramp mode: duration of a step
+int slo_p99_us = RAMP_SLO_P99_US;               // ramp mode: a step is sustainable if the p99 response time (from the intended time) is at most this
+double max_loss_percent = RAMP_MAX_LOSS_PERCENT;  // ramp mode: ... and at most this percentage of the requests is lost
+std::string telemetry_file;                     // live telemetry in Prometheus text format, rewritten every telemetry_interval_ms (empty = off)
+int telemetry_interval_ms = TELEMETRY_INTERVAL_MS;
+int clock_source = CLOCK_SOURCE;                // clock of the userspace timestamps: 0=std::chrono 1=calibrated TSC
+int timestamping_mode = 0;                      // kernel timestamps of requests and responses (SO_TIMESTAMPING): 0=off 1=software 2=hardware
+int io_backend = IO_BACKEND;                    // network I/O of the sender threads: 0=blocking sockets (boost::asio, sendmmsg/recvmmsg) 1=io_uring 2=raw frames (AF_PACKET)
+std::string packet_interface;                   // raw-frame mode: interface of the packet sockets
+std::string packet_dst_mac;                     // raw-frame mode: destination MAC address (empty = from the neighbour table)
+std::string trace_filename;                     // distribution 3: request trace to replay (CSV or binary, see trace_replay.h)
+double trace_speed = 1.0;                       // distribution 3: replay speed, the inter-arrival times of the trace are divided by it
+int trace_columns[3] = {0, 1, -1};              // distribution 3: CSV columns of the timestamp, the key and the value size (-1 = none)
+std::string trace_save_filename;                // distribution 3: write the replayed requests of a CSV trace as binary trace (empty = off)
+int shift_mode = 0;                             // popularity shifts of distribution 1: 0=none 1=rotate 2=shuffle
+double shift_interval_seconds = SHIFT_INTERVAL_SECONDS;  // popularity shifts: duration of a popularity phase
+int shift_size = 0;                             // popularity shifts, rotate: objects the ranks move per shift (0 = shift_track)
+double churn_rate = 0;                          // popularity shifts, rotate: objects per second the ranks move (sets shift_size, 0 = off)
+int shift_track = SHIFT_TRACK_RANKS;            // popularity shifts: most popular ranks whose reclassification is measured
+int set_percent = 0;                            // mixed workload: percentage of SET requests (--mix, the rest are GETs and DELETEs)
+int delete_percent = 0;                         // mixed workload: percentage of DELETE requests
+int object_exptime = 0;                         // exptime of the SETs of the fill phase and the mixed workload in seconds (0 = never)
+int lb_strategy = 0;                            // client-side load balancing over lb_caches (--lb): 0=off (one server, e.g. the Lethe data plane) 1=ketama 2=p2c 3=hotkey
+std::vector<ip::udp::endpoint> lb_caches;       // client-side balancing: the caches, the server of the command line is the database
+int lb_hot_keys = LB_HOT_KEYS;                  // hotkey: number of replicated keys per client
+int lb_topk_capacity = LB_TOPK_CAPACITY;        // hotkey: keys tracked by the top-K of a client
+int lb_interval_ms = LB_INTERVAL_MS;            // hotkey: interval of the hot key updates
 
 // Values for randomly generating inter-request times: irt = 1 / exp_random()
 const double exp_dist_mean = IRT_EXP_DIST_MEAN;
@@ -52,20 +136,20 @@ const double exp_dist_lambda = 1 / exp_dist_mean;
 // Available characters used for generating the key and value
 const char key_chars[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz+=";
 
-// Memcached server configuration (UDP and TCP port, e.g. 11212 and 11211)
+// Memcached server configuration (UDP and TCP port, e.g. 11212 and 11211, the UDP port can be given with the server)
 std::string memc_host;
 const int memc_tport = 11211;
-const int memc_uport = 11212;
+int memc_uport = 11212;
 char memc_config[32];
 
 /* RUNTIME VARIABLES*/
 
-// Memcached request id, will be incremented for each request (overflow to 0 after 65536 requests)
-uint16_t request_id = 0;
+// Start of the measurement phase, response timestamps are relative to it
+std::chrono::time_point<std::chrono::high_resolution_clock> test_start_time;
+int64_t test_start_ns;  // test_start_time in nanoseconds (see now_ns)
 
-// Maps the time of request (timepoint) to a request id (uint16_t)
-std::map<uint16_t, std::chrono::time_point<std::chrono::high_resolution_clock>> request_times;
-std::mutex rtm;
+// Receive threads stop after the next datagram once this is false
+std::atomic<bool> receiving(true);
 
 /* struct for storing response information, used for evaluation */
 struct response_record
@@ -75,413 +159,3521 @@ struct response_record
     uint32_t response_time_us;
     uint16_t letheinfo_hdr;
     bool is_hit;
+    uint32_t intended_response_time_us;  // response time measured from the intended time of request
 };
 
-std::vector<response_record> response_list;
+std::vector<response_record> response_list;  // responses of all sender threads (merged after the test, only if record_mode == 2)
+result_log results_log;                      // binary result log (record_mode == 1)
 
-uint32_t num_requests = 0;      // counter for requests made
+/* responses of a bin of SHIFT_BIN_MS of intended time of request (popularity shifts) */
+struct shift_bin
+{
+    uint32_t count;
+    uint32_t db_responses;
+    uint64_t sum_us;         // response times from the intended time of request
+};
+
+/* response classes with their own latency histogram. A response is recorded in LAT_ALL, LAT_INTENDED (response
+ * time from the intended time of request), LAT_HIT or LAT_MISS, the class of its cache id and, if it is a hit,
+ * in the class of its hotness and one of LAT_CACHE, LAT_DB_COLD and LAT_DB_CACHE_MISS. In timestamping mode,
+ * the time between the kernel transmit and receive timestamps is recorded in LAT_KERNEL. In the mixed workload,
+ * the responses to SETs and DELETEs are only recorded in LAT_SET and LAT_DELETE, and LAT_STALE holds the age of
+ * the stale values that hits returned (see check_stale_read) */
+enum latency_class
+{
+    LAT_ALL,
+    LAT_INTENDED,
+    LAT_KERNEL,
+    LAT_HIT,
+    LAT_MISS,
+    LAT_HOT,
+    LAT_WARM1,
+    LAT_WARM2,
+    LAT_COLD,
+    LAT_CACHE,          // answered by a cache
+    LAT_DB_COLD,        // answered by the database, COLD object
+    LAT_DB_CACHE_MISS,  // answered by the database, WARM/HOT object (cache miss)
+    LAT_SET,            // mixed workload: responses to SETs
+    LAT_DELETE,         // mixed workload: responses to DELETEs
+    LAT_STALE,          // mixed workload: stale reads, time since the newer write was acknowledged (not a response time)
+    LAT_CACHE_ID,       // LAT_CACHE_ID + cache id (3 bits of letheinfo)
+    NUM_LATENCY_CLASSES = LAT_CACHE_ID + 8
+};
+
+const char *latency_class_names[NUM_LATENCY_CLASSES] = {
+    "all", "intended", "kernel", "hit", "miss", "hot", "warm1", "warm2", "cold", "cache", "db_cold", "db_cache_miss",
+    "set", "delete", "stale_age", "cache_id0", "cache_id1", "cache_id2", "cache_id3", "cache_id4", "cache_id5", "cache_id6", "cache_id7"
+};
+
+latency_histogram latency[NUM_LATENCY_CLASSES];  // latency histograms of all sender threads (merged after the test)
+
+uint32_t num_requests = 0;      // counter for requests made (merged after the test)
+double send_duration_seconds = 0;  // time from the start of the test until the last sender thread finished
+double target_request_rate = 0;    // request rate of the schedule (requests per second)
+int64_t sum_send_lag_ns = 0;       // how far requests were sent behind their intended time (merged after the test)
+int64_t max_send_lag_ns = 0;
+uint32_t num_batches = 0;          // sendmmsg batches (merged after the test)
+uint32_t num_late_responses = 0;    // responses received after REQUEST_TIMEOUT_MS or for an unknown/reused request id
+uint32_t num_expired_requests = 0;  // requests whose request id was reused before a response was received
+uint32_t num_invalid_responses = 0;     // truncated or malformed responses, or value length not the one of the object
+uint32_t num_incomplete_responses = 0;  // responses of which datagrams were missing after REQUEST_TIMEOUT_MS
+uint32_t num_multi_datagram_responses = 0;
+uint64_t num_value_bytes = 0;           // value bytes of all hits (goodput)
+uint32_t num_client_timeouts = 0;       // closed loop: requests a virtual client gave up waiting for after REQUEST_TIMEOUT_MS
+uint32_t num_tx_timestamps = 0;         // timestamping mode: transmit timestamps received from the socket error queue
+uint32_t num_sets = 0;                  // mixed workload: SET and DELETE requests sent
+uint32_t num_deletes = 0;
+uint32_t num_write_failures = 0;        // mixed workload: SETs and DELETEs answered with NOT_STORED or SERVER_ERROR
+uint32_t num_stale_cache_reads = 0;     // mixed workload: stale reads answered by a cache (all stale reads: latency[LAT_STALE])
+uint32_t lb_cache_requests[LB_MAX_CACHES] = {};  // client-side balancing: GETs sent to every cache
+uint32_t num_db_fetches = 0;            // client-side balancing: cache misses fetched from the database
+uint32_t num_lookaside_sets = 0;        // client-side balancing: values of the database written to the cache that missed them
+uint32_t num_invalidations = 0;         // client-side balancing: DELETEs to the caches after a write
+
+/* Memcached key-value objects (struct of arrays). The key of object i is object_key(i) in the request arena,
+ * it is generated from the object's id, so sorting the objects doesn't change their keys */
+struct object_store
+{
+    int count;
+    std::vector<uint32_t> id;        // index of the object at generation (determines its key)
+    std::vector<int> irt_ms;         // inter-request time in milliseconds
+    std::vector<int> value_len;      // length of the value
+};
+
+/* Request arena: the GET frame (frame header + "get <key>\r\n") of every object, encoded once at startup.
+ * Frames are stored in one contiguous, cache line aligned block with one cache line per object. The frame
+ * header of the arena is never modified: senders put the request id into their own 8-byte frame header
+ * and send it together with the rest of the frame from the arena (gather I/O), so frames can be sent
+ * by several threads and multiple times in a row without copying. */
+#define GET_FRAME_LEN (8 + 4 + KEY_LENGTH + 2)
+#define FRAME_STRIDE ((GET_FRAME_LEN + 63) / 64 * 64)
+
+char *request_arena = nullptr;
+
+// Random data used as values for SET requests, object i uses {value_len} bytes starting at value_pool_offset(i)
+#define VALUE_POOL_SIZE 65536
+char *value_pool = nullptr;
+
+/* GET frame of object {i} in the request arena */
+inline char *get_frame(int i)
+{
+    return request_arena + (size_t)i * FRAME_STRIDE;
+}
+
+/* key of object {i} (KEY_LENGTH bytes, not null-terminated) */
+inline const char *object_key(int i)
+{
+    return get_frame(i) + 12;
+}
+
+inline size_t value_pool_offset(int i)
+{
+    return ((uint64_t)i * 2654435761u) % VALUE_POOL_SIZE;
+}
+
+/* response of more than one datagram being reassembled */
+struct partial_response
+{
+    uint16_t total;                      // number of datagrams
+    uint16_t received;
+    int64_t first_ns;                    // receive time of the first datagram
+    std::vector<std::string> datagrams;  // payload by sequence number
+};
+
+/* kernel timestamps of a request id (timestamping mode). The transmit timestamp usually arrives before the response,
+ * but may arrive after it (e.g. from the NIC), so whichever comes first waits in the slot for the other */
+struct timestamp_slot
+{
+    int64_t tx_ns;              // kernel/NIC transmit timestamp of the request (0 = none)
+    int64_t rx_ns;              // kernel/NIC receive timestamp of the response (0 = none)
+    uint32_t response_time_us;  // userspace response time of the response
+};
+
+/* request of the io_uring backend between submission and completion: frame header and message of IORING_OP_SENDMSG */
+struct uring_send_slot
+{
+    char header[8];
+    struct iovec iov[2];     // frame header and frame from the request arena
+    struct msghdr msg;
+    uint16_t request_id;
+    uint32_t object;
+    int64_t request_ns;
+    int64_t intended_ns;
+};
+
+// user_data of the multishot receive, the user_data of a send is the index of its uring_send_slot
+#define URING_RECV_USER_DATA UINT64_MAX
+
+/* state of a single sender thread: every worker has its own socket (and thus its own source port and
+ * request id space), its own slice of the objects and its own receive thread. */
+struct sender_worker
+{
+    int id;
+    object_store *objects;   // all objects of the test
+    int count;               // number of objects in {objects}
+    int first_object;        // slice of the key space owned by this worker: [first_object, last_object)
+    int last_object;
+    int total_no_requests;   // request budget of this worker (distribution 1 and 2)
+    int num_clients;         // closed loop: virtual clients of this worker
+    int max_outstanding;     // closed loop: maximum number of requests without response of this worker
+    ip::udp::socket *socket;
+    ip::udp::endpoint *memc_remote;
+
+    // Memcached request id, will be incremented for each request (overflow to 0 after 65536 requests)
+    uint16_t request_id;
+    char frame_header[8];    // frame header of the next request (request id, sequence number, number of datagrams, letheinfo)
+    uint32_t num_requests;
+    int64_t sum_send_lag_ns;  // sum and maximum of (actual - intended time of request)
+    int64_t max_send_lag_ns;
+
+    // Maps the time of request and the requested object to a request id (uint16_t), see request_table.h
+    request_table *requests;
+    uint32_t num_late_responses;
+    uint32_t num_expired_requests;
+    completion_queue *completions;  // closed loop: request ids that got their response (receive thread -> sender thread)
+    uint32_t num_client_timeouts;
 
-/* struct for Memcached key-value objects */
-struct kv_object
+    // written by the receive thread only
+    std::unordered_map<uint16_t, partial_response> partial_responses;  // by request id
+    std::string reassembly_buffer;
+    uint64_t num_datagrams;
+    uint32_t num_invalid_responses;
+    uint32_t num_incomplete_responses;
+    uint32_t num_multi_datagram_responses;
+    uint64_t num_value_bytes;
+    int64_t kernel_rx_ns;                       // timestamping mode: kernel receive timestamp of the datagram being processed
+    std::vector<timestamp_slot> timestamps;     // timestamping mode: by request id
+    uint32_t num_tx_timestamps;
+
+    std::vector<response_record> response_list;  // only if record_mode == 2
+    result_log_chunk *log_chunk;                 // chunk of the binary result log being filled (record_mode == 1)
+    latency_histogram *latency;                  // NUM_LATENCY_CLASSES histograms, written by the receive thread only
+    uint32_t counter_ranks[ZIPF_PRINT_RANKS];  // number of requests of the most popular objects (Zipf distribution)
+    std::vector<int64_t> shift_classified_ns;   // popularity shifts: first HOT/WARM response of every new hot object (INT64_MAX = none)
+    std::vector<shift_bin> shift_bins;          // popularity shifts: responses by intended time of request
+    uint64_t mix_state;                         // mixed workload: random state of the choice between GET, SET and DELETE
+    uint32_t num_sets;                          // mixed workload: written by the sender thread
+    uint32_t num_deletes;
+    uint32_t num_write_failures;                // mixed workload: written by the receive thread
+    uint32_t num_stale_cache_reads;
+
+    // client-side balancing (lb_strategy != 0)
+    uint64_t lb_state;                                          // random state of p2c
+    std::atomic<int32_t> cache_outstanding[LB_MAX_CACHES];      // p2c: requests without response by cache
+    uint32_t cache_requests[LB_MAX_CACHES];                     // written by the sender thread
+    uint32_t num_invalidations;
+    hotkey_tracker *hotkeys;                                    // hotkey: top-K of this client, nullptr for the other strategies
+    int64_t hotkeys_update_ns;                                  // hotkey: time of the next update of the hot keys
+    uint32_t num_db_fetches;                                    // written by the receive thread
+    uint32_t num_lookaside_sets;
+
+    // batched sending (sendmmsg), used if batch_size > 1
+    std::vector<struct mmsghdr> batch_msgs;
+    std::vector<struct iovec> batch_iov;     // two per message: frame header and frame from the request arena
+    std::vector<char> batch_headers;         // frame header of each message (8 bytes each)
+    std::vector<uint32_t> batch_objects;     // requested object of each message
+    std::vector<int64_t> batch_intended;     // intended time of request of each message
+    int batch_len;                           // number of queued requests
+    int64_t batch_first_ns;                  // time the first request of the batch was queued
+    uint32_t num_batches;
+
+    // io_uring backend (io_backend == 1): the sender thread sends and receives on one ring, there is no receive thread
+    uring *ring;                              // nullptr if the blocking sockets are used
+    uring_buf_ring *recv_buffers;             // provided buffers of the multishot receive
+    struct msghdr recv_msg;                   // template of the multishot receive (no address, no control data)
+    std::vector<uring_send_slot> send_slots;
+    std::vector<uint32_t> free_send_slots;
+    std::vector<uint32_t> queued_send_slots;   // requests not submitted yet
+    int64_t send_end_ns;                      // time the last request was sent
+
+    // raw-frame mode (io_backend == 2): the sender thread sends and receives on the rings of a packet socket, there is
+    // no receive thread. The queued requests are kept in batch_headers/batch_objects/batch_intended until they are sent
+    packet_ring *packet;                      // nullptr if not in raw-frame mode
+    char packet_header[PACKET_HEADER_LEN];    // Ethernet, IPv4 and UDP header of every request
+    uint32_t packet_udp_sum;                  // one's complement sum of the UDP pseudo header and header (see packet_frame_sums)
+};
+
+/* raw-frame mode: addresses of the frames and the one's complement sum of the GET frame of every object without
+ * its request id, so the UDP checksum of a request is two additions (packet_udp_sum + sum + request id) */
+struct packet_addresses
 {
-    std::string key; // Memcached key
-    int irt_ms;      // inter-request time in milliseconds
-    int value_len;   // length of the value
-    std::chrono::time_point<std::chrono::high_resolution_clock> next_call;
+    uint8_t src_mac[6];
+    uint8_t dst_mac[6];
+    uint32_t src_ip;   // network byte order
+    uint32_t dst_ip;
 };
+packet_addresses packet_addrs;
+std::vector<uint32_t> packet_frame_sums;
+
+tsc_clock tsc;  // calibrated at startup if clock_source == 1
+
+/* std::chrono::high_resolution_clock in nanoseconds, the reference of the TSC clock */
+inline int64_t chrono_now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+}
+
+/* current time in nanoseconds (clock of the request_table timestamps), from the TSC if clock_source == 1 */
+inline int64_t now_ns()
+{
+    if (clock_source == 1) {
+        return tsc_to_ns(tsc, tsc_read());
+    }
+    return chrono_now_ns();
+}
+
+/* adds {n} to a counter of a worker that the telemetry thread reads while it is written. There is a single writer,
+ * so a relaxed atomic store (a plain store on x86) is enough and the hot path needs no locked instruction */
+template <class T, class N>
+inline void counter_add(T &counter, N n)
+{
+    __atomic_store_n(&counter, (T)(counter + n), __ATOMIC_RELAXED);
+}
+
+template <class T>
+inline T counter_read(const T &counter)
+{
+    return __atomic_load_n(&counter, __ATOMIC_RELAXED);
+}
+
+// Zipf sampler, shared by all sender threads (read-only)
+zipf_sampler zipf;
+
+/* splitmix64 finalizer: mixes {x} into a well distributed 64-bit value */
+inline uint64_t mix64(uint64_t x)
+{
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+/* splitmix64: next random number of {state}. Used instead of the standard library engines and distributions,
+ * whose results differ between implementations, so a seed generates the same objects and request sequences on every
+ * machine */
+inline uint64_t next_random(uint64_t &state)
+{
+    return mix64(state += 0x9E3779B97F4A7C15ull);
+}
+
+/* uniform random number in [0, 1) of {state} (53 bits) */
+inline double next_random_unit(uint64_t &state)
+{
+    return (next_random(state) >> 11) * 0x1.0p-53;
+}
+
+/* random number generator state of stream {stream} of {object} (independent of the order objects are generated in) */
+inline uint64_t object_random_state(uint64_t object, int stream)
+{
+    return mix64(object_seed ^ mix64(object << 2 | stream));
+}
+
+/* seed of a random number generator of the test (request sequences, Zipf rank scrambling), derived from object_seed */
+inline uint64_t derived_seed(const char *purpose, int n)
+{
+    uint64_t h = object_seed;
+    for (const char *c = purpose; *c; c++) {
+        h = mix64(h ^ (uint8_t)*c);
+    }
+    return mix64(h ^ (uint64_t)n);
+}
+
+/* writes {len} random characters from {key_chars} to {dst} (6 bits of random per character) */
+inline void fill_random_chars(char *dst, int len, uint64_t &state)
+{
+    for (int i = 0; i < len; i += 10) {
+        uint64_t r = next_random(state);
+        for (int j = i; j < std::min(i + 10, len); j++) {
+            dst[j] = key_chars[r & 63];
+            r >>= 6;
+        }
+    }
+}
+
+/* runs {fn}(begin, end) on one thread per CPU, each thread gets a contiguous part of [0, count) */
+template <class Function>
+void parallel_for(int count, Function fn)
+{
+    int num_threads = std::max(1u, std::thread::hardware_concurrency());
+    boost::thread_group threads;
+    for (int t = 0; t < num_threads; t++) {
+        int begin = (int)((int64_t)count * t / num_threads);
+        int end = (int)((int64_t)count * (t + 1) / num_threads);
+        threads.create_thread([&fn, begin, end] { fn(begin, end); });
+    }
+    threads.join_all();
+}
+
+/* sorts {v} with one thread per CPU: the parts of the threads are sorted and then merged pairwise */
+void parallel_sort(std::vector<uint64_t> &v)
+{
+    int num_parts = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<size_t> bounds;
+    for (int t = 0; t <= num_parts; t++) {
+        bounds.push_back(v.size() * t / num_parts);
+    }
+    parallel_for(num_parts, [&v, &bounds](int begin, int end) {
+        for (int t = begin; t < end; t++) {
+            std::sort(v.begin() + bounds[t], v.begin() + bounds[t + 1]);
+        }
+    });
+
+    while (bounds.size() > 2) {
+        int num_merges = (bounds.size() - 1) / 2;
+        boost::thread_group threads;
+        for (int m = 0; m < num_merges; m++) {
+            size_t first = bounds[2 * m], middle = bounds[2 * m + 1], last = bounds[2 * m + 2];
+            threads.create_thread([&v, first, middle, last] {
+                std::inplace_merge(v.begin() + first, v.begin() + middle, v.begin() + last);
+            });
+        }
+        threads.join_all();
+
+        std::vector<size_t> merged;
+        for (size_t i = 0; i < bounds.size(); i += 2) {
+            merged.push_back(bounds[i]);
+        }
+        if (merged.back() != bounds.back()) {
+            merged.push_back(bounds.back());
+        }
+        bounds = merged;
+    }
+}
+
+/* generate {count} random objects (inter-request time and value length) from object_seed and store them to {objects} */
+void generate_objects(object_store *objects, int count)
+{
+    objects->count = count;
+    objects->id.resize(count);
+    objects->irt_ms.resize(count);
+    objects->value_len.resize(count);
+
+    parallel_for(count, [objects](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            uint64_t state = object_random_state(i, 0);
+
+            // exponential distributed requests per second, by inversion
+            double u = next_random_unit(state);
+            double rps = -std::log1p(-u) / exp_dist_lambda;
+            double irt = 1 / rps * 1000;
+            objects->id[i] = i;
+            objects->irt_ms[i] = (int)std::min(irt, (double)INT32_MAX);
+            objects->value_len[i] = value_size_min + next_random(state) % (value_size_max - value_size_min + 1);
+        }
+    });
+}
+
+/* sort objects by irt ascending (objects with the same irt keep their order) */
+void sort_objects_irt_asc(object_store *objects)
+{
+    int count = objects->count;
+
+    // sort (irt, index) pairs, then reorder the arrays
+    std::vector<uint64_t> order(count);
+    for (int i = 0; i < count; i++) {
+        order[i] = (uint64_t)objects->irt_ms[i] << 32 | (uint32_t)i;
+    }
+    parallel_sort(order);
+
+    object_store sorted;
+    sorted.count = count;
+    sorted.id.resize(count);
+    sorted.irt_ms.resize(count);
+    sorted.value_len.resize(count);
+    parallel_for(count, [objects, &order, &sorted](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            uint32_t source = (uint32_t)order[i];
+            sorted.id[i] = objects->id[source];
+            sorted.irt_ms[i] = objects->irt_ms[source];
+            sorted.value_len[i] = objects->value_len[source];
+        }
+    });
+    std::swap(*objects, sorted);
+}
+
+/* trace replay (distribution 3): the memory-mapped trace, the object of every key of a CSV trace (the keys point into
+ * the mapping) and the requests to replay */
+trace_file trace;
+std::unordered_map<std::string_view, uint32_t> trace_objects;
+uint64_t trace_num_requests = 0;  // requests replayed: the first total_request_limit requests of the trace
+int64_t trace_first_ns = 0;       // timestamp of the first request
+int64_t trace_span_ns = 0;        // time from the first to the last replayed request (before trace_speed)
+
+/* opens the trace and reads the requests to replay once: their keys become the objects in the order of their first
+ * request, so object i gets the fixed-length key generated from id i like every other object. The value length of an
+ * object is the largest value size of its key in the trace (clamped to --value-size), or random if the trace has none.
+ * Optionally the requests are written to a binary trace (--trace-save) */
+bool load_trace(object_store *objects)
+{
+    if (!trace_open(trace, trace_filename.c_str())) {
+        std::cout << "Can't read trace " << trace_filename << std::endl;
+        return false;
+    }
+    memcpy(trace.columns, trace_columns, sizeof(trace_columns));
+
+    trace_writer writer;
+    bool save = !trace_save_filename.empty();
+    if (save && trace.binary) {
+        std::cout << trace_filename << " is a binary trace already, not saving it" << std::endl;
+        save = false;
+    } else if (save && !trace_writer_open(writer, trace_save_filename.c_str())) {
+        std::cout << "Can't create " << trace_save_filename << std::endl;
+        return false;
+    }
+
+    std::vector<uint32_t> value_sizes;  // largest value size of every object, 0 = unknown
+    if (trace.binary) {
+        value_sizes.assign(trace.header->num_keys, 0);
+    }
+    trace_cursor cursor = {0};
+    trace_request r;
+    int64_t last_ns = 0;
+    trace_num_requests = 0;
+    while (trace_num_requests < (uint64_t)total_request_limit && trace_next(trace, cursor, r)) {
+        uint32_t object = r.key_index;
+        if (!trace.binary) {
+            object = trace_objects.try_emplace(std::string_view(r.key, r.key_len), (uint32_t)trace_objects.size()).first->second;
+            if (object == value_sizes.size()) {
+                value_sizes.push_back(0);
+            }
+        } else if (object >= value_sizes.size()) {
+            std::cout << "Invalid key index " << object << " in request " << trace_num_requests << " of " << trace_filename << std::endl;
+            return false;
+        }
+        value_sizes[object] = std::max(value_sizes[object], r.value_size);
+        if (trace_num_requests == 0) {
+            trace_first_ns = r.timestamp_ns;
+            last_ns = r.timestamp_ns;
+        }
+        last_ns = std::max(last_ns, r.timestamp_ns);
+        if (save) {
+            trace_writer_add(writer, r.timestamp_ns, object, r.value_size);
+        }
+        trace_num_requests++;
+    }
+    trace_span_ns = last_ns - trace_first_ns;
 
-std::vector<int> zipf_popularities;
+    if (save) {
+        if (!trace_writer_close(writer, value_sizes.size())) {
+            std::cout << "Can't write " << trace_save_filename << std::endl;
+            return false;
+        }
+        std::cout << "Wrote " << trace_num_requests << " requests to " << trace_save_filename << std::endl;
+    }
+    if (trace_num_requests == 0 || value_sizes.size() > INT32_MAX) {
+        std::cout << trace_filename << " has no requests (or more than " << INT32_MAX << " keys)" << std::endl;
+        return false;
+    }
+
+    num_objects = (int)value_sizes.size();
+    generate_objects(objects, num_objects);
+    for (int i = 0; i < num_objects; i++) {
+        if (value_sizes[i] > 0) {
+            objects->value_len[i] = std::min(std::max((int)std::min(value_sizes[i], (uint32_t)INT32_MAX), value_size_min), value_size_max);
+        }
+    }
+
+    // the replay ends with the last request of the trace
+    test_duration_seconds = std::max(1, (int)std::ceil(trace_span_ns / trace_speed / 1e9));
+    return true;
+}
+
+/* generates the key of every object, encodes its GET frame into the request arena and generates the value pool */
+void build_request_arena(object_store *objects)
+{
+    int count = objects->count;
+    request_arena = (char *)aligned_alloc(64, (size_t)count * FRAME_STRIDE);
+    parallel_for(count, [objects](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            char *req = get_frame(i);
+
+            // Frame Header (request id is set by the sender)
+            req[0] = 0;
+            req[1] = 0;
+            req[2] = 0;
+            req[3] = 0;
+            req[4] = 0;
+            req[5] = 1;
+            req[6] = 0;
+            req[7] = 0;
+
+            // GET
+            memcpy(req + 8, "get ", 4);
+            uint64_t state = object_random_state(objects->id[i], 1);
+            fill_random_chars(req + 12, key_length, state);
+            memcpy(req + 12 + key_length, "\r\n", 2);
+        }
+    });
+
+    uint64_t state = derived_seed("values", 0);
+    value_pool = (char *)malloc(VALUE_POOL_SIZE + value_size_max);
+    fill_random_chars(value_pool, VALUE_POOL_SIZE + value_size_max, state);
+}
+
+/* sends a set request for object {object} with request id {request_id} to Memcached via UDP - doesn't wait for the response
+ * The key is taken from the request arena and the value from the value pool, nothing is copied or allocated.
+ * Returns false if the request couldn't be sent */
+bool do_udp_set_request(int object, int value_len, int flags, int exptime, uint16_t request_id, ip::udp::socket *socket, ip::udp::endpoint *receiver_endpoint)
+{
+    const char frame_header[8] = {(char)(request_id >> 8), (char)(request_id & 0xFF), 0, 0, 0, 1, 0, 0};
+
+    char params[48];  // " <flags> <exptime> <bytes>\r\n"
+    int params_len = snprintf(params, sizeof(params), " %d %d %d\r\n", flags, exptime, value_len);
+
+    std::array<const_buffer, 6> req = {
+        buffer(frame_header, 8),
+        buffer("set ", 4),
+        buffer(object_key(object), key_length),
+        buffer(params, params_len),
+        buffer(value_pool + value_pool_offset(object), value_len),
+        buffer("\r\n", 2)
+    };
+
+    boost::system::error_code err;
+
+    socket->send_to(req, *receiver_endpoint, 0, err);
+
+    if (err.value() != 0 && err != error::would_block) {
+        std::cout << "Error sending key " << std::string(object_key(object), key_length) << ". Code: " << err.value() << std::endl;
+    }
+    return err.value() == 0;
+}
+
+/* sends a get request for object {object} with request id {request_id} via UDP (fill verification, not measured) */
+bool do_udp_verify_request(int object, uint16_t request_id, ip::udp::socket *socket, ip::udp::endpoint *receiver_endpoint)
+{
+    const char frame_header[8] = {(char)(request_id >> 8), (char)(request_id & 0xFF), 0, 0, 0, 1, 0, 0};
+
+    std::array<const_buffer, 2> req = {
+        buffer(frame_header, 8),
+        buffer(get_frame(object) + 8, GET_FRAME_LEN - 8)
+    };
+
+    boost::system::error_code err;
+    socket->send_to(req, *receiver_endpoint, 0, err);
+    return err.value() == 0;
+}
+
+// Results of the fill phase
+double fill_duration_seconds = 0;  // writing and verifying
+double fill_write_seconds = 0;     // writing only
+uint64_t num_fill_sets = 0;        // SET requests, including the ones of repair passes
+uint64_t fill_bytes = 0;           // value bytes of the SET requests
+uint32_t num_fill_lost = 0;        // UDP requests of the fill phase without response (timed out)
+int num_objects_verified = -1;     // objects the verification found, -1 if not verified
+
+/* prints the progress of the fill phase ({done} of {total} requests of the current pass) every percent */
+inline void print_fill_progress(const char *phase, size_t done, size_t total, int &last_percent)
+{
+    int percent = (int)(done * 100 / std::max<size_t>(total, 1));
+    if (percent != last_percent) {
+        last_percent = percent;
+        std::cout << "\r" << phase << " objects " << percent << "%" << std::flush;
+    }
+}
 
-/* generate a random string with length {len} using characters from {key_chars} */
-std::string gen_random_string(const int len)
+/* UDP fill engine: sends a SET (or, to verify, a GET) for every object of {todo} with up to {window} requests without
+ * response. The window is adapted like the congestion window of TCP (AIMD): it grows by one per window of answered
+ * requests and is halved if a request times out (at most once per FILL_TIMEOUT_MS). Requests without response are
+ * not repeated here, the verification finds the missing objects. For GETs, present[object] is set for every object found */
+void udp_fill_requests(ip::udp::socket *socket, ip::udp::endpoint *endpoint, object_store *objects, const std::vector<uint32_t> &todo, bool is_set, std::vector<uint8_t> &present)
 {
-    std::string s;
-    s.reserve(len);
-    for (int i = 0; i < len; i++)
+    struct fill_slot
     {
-        s += key_chars[rand() % (sizeof(key_chars) - 1)];
+        uint32_t object;
+        int64_t sent_ns;
+        bool pending;
+    };
+    std::vector<fill_slot> slots(65536, fill_slot{0, 0, false});
+    std::deque<uint16_t> sent_ids;  // request ids in send order, to find requests without response
+    int outstanding = 0;            // requests without response
+    double window = FILL_WINDOW_START;
+    int64_t last_decrease_ns = 0;
+    uint16_t request_id = 0;
+    size_t next = 0;
+    int last_percent = -1;
+
+    const int recv_len = 8 + 6 + key_length;  // frame header + "VALUE " + key, "STORED" or "END <key>"
+    char recv_buf[recv_len];
+    int fd = socket->native_handle();
+    socket->non_blocking(true);
+
+    while (next < todo.size() || !sent_ids.empty()) {
+        // send while the window isn't full (request ids must not be reused while they may still be answered)
+        while (next < todo.size() && outstanding < (int)window && sent_ids.size() < 32768) {
+            uint32_t object = todo[next];
+            bool sent = is_set ? do_udp_set_request(object, objects->value_len[object], 0, object_exptime, request_id, socket, endpoint)
+                               : do_udp_verify_request(object, request_id, socket, endpoint);
+            if (!sent) {
+                break;  // socket buffer full, retry after receiving
+            }
+            slots[request_id] = fill_slot{object, now_ns(), true};
+            sent_ids.push_back(request_id);
+            request_id++;
+            outstanding++;
+            next++;
+            if (is_set) {
+                num_fill_sets++;
+                fill_bytes += objects->value_len[object];
+            }
+        }
+
+        // wait up to 1ms for responses, then receive all that arrived
+        struct pollfd pfd = {fd, POLLIN, 0};
+        poll(&pfd, 1, 1);
+        while (true) {
+            ssize_t len = recv(fd, recv_buf, recv_len, MSG_DONTWAIT);  // the rest of a longer datagram is discarded
+            if (len < 0) {
+                break;
+            }
+            if (len < 9 || recv_buf[2] != 0 || recv_buf[3] != 0) {
+                continue;  // only the first datagram of a response
+            }
+            fill_slot &slot = slots[((uint8_t)recv_buf[0] << 8) | (uint8_t)recv_buf[1]];
+            if (!slot.pending) {
+                continue;
+            }
+            // a SET is answered with "STORED" (the Lethe switch also sends DELETEs to the caches, their responses are ignored)
+            // a GET with "VALUE <key>" if the object is present, else "END"
+            if (is_set && (len < 14 || memcmp(recv_buf + 8, "STORED", 6) != 0)) {
+                continue;
+            }
+            if (!is_set && recv_buf[8] == 'V') {
+                present[slot.object] = 1;
+            }
+            slot.pending = false;
+            outstanding--;
+            window = std::min(window + 1.0 / window, (double)FILL_WINDOW_MAX);
+        }
+
+        // forget answered requests and requests without response
+        int64_t time_now = now_ns();
+        while (!sent_ids.empty()) {
+            fill_slot &slot = slots[sent_ids.front()];
+            if (slot.pending) {
+                if (time_now - slot.sent_ns < (int64_t)FILL_TIMEOUT_MS * 1000000) {
+                    break;
+                }
+                slot.pending = false;
+                outstanding--;
+                num_fill_lost++;
+                if (time_now - last_decrease_ns > (int64_t)FILL_TIMEOUT_MS * 1000000) {
+                    window = std::max(window / 2, 1.0);
+                    last_decrease_ns = time_now;
+                }
+            }
+            sent_ids.pop_front();
+        }
+
+        print_fill_progress(is_set ? "Filling" : "Verifying", next, todo.size(), last_percent);
+    }
+    socket->non_blocking(false);
+}
+
+/* TCP fill engine: sends the SETs of all objects of {todo} with "noreply" in large writes (pipelined, no round trip
+ * per SET), then waits for the response to a "version" command, which is sent after all SETs were processed */
+bool tcp_fill_sets(ip::tcp::socket &socket, object_store *objects, const std::vector<uint32_t> &todo)
+{
+    std::string buf;
+    buf.reserve(FILL_TCP_WRITE_SIZE + 2 * value_size_max);
+    boost::system::error_code err;
+    int last_percent = -1;
+
+    for (size_t n = 0; n < todo.size(); n++) {
+        uint32_t object = todo[n];
+        int value_len = objects->value_len[object];
+
+        char params[48];  // " <flags> <exptime> <bytes> noreply\r\n"
+        int params_len = snprintf(params, sizeof(params), " 0 %d %d noreply\r\n", object_exptime, value_len);
+        buf.append("set ", 4);
+        buf.append(object_key(object), key_length);
+        buf.append(params, params_len);
+        buf.append(value_pool + value_pool_offset(object), value_len);
+        buf.append("\r\n", 2);
+        num_fill_sets++;
+        fill_bytes += value_len;
+
+        if (buf.size() >= FILL_TCP_WRITE_SIZE || n + 1 == todo.size()) {
+            write(socket, buffer(buf), err);
+            if (err) {
+                std::cout << "\nError writing to " << memc_host << ":" << memc_tport << ": " << err.message() << std::endl;
+                return false;
+            }
+            buf.clear();
+            print_fill_progress("Filling", n + 1, todo.size(), last_percent);
+        }
+    }
+
+    streambuf response;
+    write(socket, buffer("version\r\n", 9), err);
+    if (!err) {
+        read_until(socket, response, "\r\n", err);
+    }
+    if (err) {
+        std::cout << "\nError waiting for " << memc_host << ":" << memc_tport << ": " << err.message() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/* TCP verification: requests the objects of {todo} with multi-gets of FILL_TCP_VERIFY_KEYS keys and sets
+ * present[object] for every object found */
+bool tcp_verify(ip::tcp::socket &socket, const std::vector<uint32_t> &todo, std::vector<uint8_t> &present)
+{
+    streambuf response;
+    std::istream response_stream(&response);
+    boost::system::error_code err;
+    int last_percent = -1;
+
+    for (size_t first = 0; first < todo.size(); first += FILL_TCP_VERIFY_KEYS) {
+        size_t last = std::min(first + FILL_TCP_VERIFY_KEYS, todo.size());
+        std::string req = "get";
+        for (size_t n = first; n < last; n++) {
+            req += ' ';
+            req.append(object_key(todo[n]), key_length);
+        }
+        req += "\r\n";
+        write(socket, buffer(req), err);
+
+        // values are returned in the order of the keys, missing keys are left out
+        size_t expected = first;
+        while (!err) {
+            read_until(socket, response, "\r\n", err);
+            if (err) {
+                break;
+            }
+            std::string line;
+            std::getline(response_stream, line);
+            if (line.compare(0, 3, "END") == 0) {
+                break;
+            }
+            if (line.compare(0, 6, "VALUE ") != 0) {
+                std::cout << "\nUnexpected response from " << memc_host << ":" << memc_tport << ": " << line << std::endl;
+                return false;
+            }
+
+            // "VALUE <key> <flags> <bytes>": skip the data block
+            std::string key = line.substr(6, line.find(' ', 6) - 6);
+            size_t bytes = std::stoul(line.substr(line.rfind(' ') + 1)) + 2;
+            if (response.size() < bytes) {
+                read(socket, response, transfer_at_least(bytes - response.size()), err);
+            }
+            response.consume(bytes);
+
+            while (expected < last && (key.size() != (size_t)key_length || memcmp(object_key(todo[expected]), key.data(), key_length) != 0)) {
+                expected++;
+            }
+            if (expected < last) {
+                present[todo[expected]] = 1;
+                expected++;
+            }
+        }
+        if (err) {
+            std::cout << "\nError reading from " << memc_host << ":" << memc_tport << ": " << err.message() << std::endl;
+            return false;
+        }
+        print_fill_progress("Verifying", last, todo.size(), last_percent);
+    }
+    return true;
+}
+
+/* write objects with random values to Memcached cache (UDP or TCP, see fill_mode), verify which objects are present
+ * and write the missing objects again (up to FILL_REPAIR_PASSES times) */
+void mc_fill_objects(ip::udp::socket *socket, ip::udp::endpoint *receiver_endpoint, object_store *objects, int count)
+{
+    auto fill_start = std::chrono::steady_clock::now();
+
+    io_service tcp_io_service;
+    ip::tcp::socket tcp_socket(tcp_io_service);
+    if (fill_mode == 1) {
+        boost::system::error_code err;
+        tcp_socket.connect(ip::tcp::endpoint(ip::address::from_string(memc_host), memc_tport), err);
+        if (err) {
+            std::cout << "Can't connect to " << memc_host << ":" << memc_tport << " (" << err.message() << "), filling over UDP" << std::endl;
+            fill_mode = 0;
+        } else {
+            tcp_socket.set_option(ip::tcp::no_delay(true));
+        }
+    }
+
+    std::vector<uint32_t> todo(count);
+    for (int i = 0; i < count; i++) {
+        todo[i] = i;
+    }
+    std::vector<uint8_t> present(count, 0);
+
+    for (int pass = 0; ; pass++) {
+        auto write_start = std::chrono::steady_clock::now();
+        bool ok = fill_mode == 1 ? tcp_fill_sets(tcp_socket, objects, todo) : (udp_fill_requests(socket, receiver_endpoint, objects, todo, true, present), true);
+        fill_write_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - write_start).count();
+        if (!ok || !fill_verify) {
+            break;
+        }
+
+        ok = fill_mode == 1 ? tcp_verify(tcp_socket, todo, present) : (udp_fill_requests(socket, receiver_endpoint, objects, todo, false, present), true);
+        if (!ok) {
+            break;
+        }
+
+        std::vector<uint32_t> missing;
+        for (uint32_t object : todo) {
+            if (!present[object]) {
+                missing.push_back(object);
+            }
+        }
+        todo.swap(missing);
+        num_objects_verified = count - (int)todo.size();
+        if (todo.empty() || pass == FILL_REPAIR_PASSES) {
+            break;
+        }
+        std::cout << "\r" << todo.size() << " objects missing, writing them again" << std::endl;
+    }
+    fill_duration_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - fill_start).count();
+
+    std::cout << "\rFilled " << count << " objects over " << (fill_mode == 1 ? "TCP" : "UDP") << " in " << fill_duration_seconds << "s: ";
+    std::cout << num_fill_sets / fill_write_seconds << " SET/s (" << fill_bytes / fill_write_seconds / 1e6 << " MB/s of values)";
+    if (fill_mode == 0) {
+        std::cout << " - " << num_fill_lost << " UDP requests without response";
+    }
+    std::cout << std::endl;
+    if (num_objects_verified >= 0) {
+        std::cout << "Verified: " << num_objects_verified << " of " << count << " objects present (" << 100.0 * num_objects_verified / count << "%)" << std::endl;
+    }
+}
+
+/* records how far a request was sent behind its intended time */
+inline void record_send_lag(sender_worker *w, int64_t lag_ns)
+{
+    w->sum_send_lag_ns += lag_ns;
+    w->max_send_lag_ns = std::max(w->max_send_lag_ns, lag_ns);
+}
+
+/* sends a get request for object {object} to Memcached via UDP and stores the time of request in the request table (key=request_id)
+ * {intended_ns} is the time the request should have been sent according to the schedule */
+void do_udp_get_request(int object, sender_worker *w, int64_t intended_ns)
+{
+    const uint16_t request_id = w->request_id;
+
+    // Frame Header: only the request id changes, "get <key>\r\n" is sent from the request arena
+    w->frame_header[0] = (request_id >> 8);
+    w->frame_header[1] = request_id & 0xFF;
+
+    std::array<const_buffer, 2> req = {
+        buffer(w->frame_header, 8),
+        buffer(get_frame(object) + 8, GET_FRAME_LEN - 8)
+    };
+
+    boost::system::error_code err;
+
+    // store the request before sending, the response may arrive before send_to returns
+    auto request_time = now_ns();
+    if (request_table_store(w->requests, request_id, object, request_time, intended_ns)) {
+        w->num_expired_requests++;
+    }
+    w->socket->send_to(req, *w->memc_remote, 0, err);
+
+    if (err.value() != 0) {
+        request_table_release(w->requests, request_id);
+    } else {
+        w->request_id++;
+        counter_add(w->num_requests, 1);
+        record_send_lag(w, request_time - intended_ns);
+    }
+}
+
+/* sets up the message vectors of a worker for batched sending */
+void init_send_batch(sender_worker *w)
+{
+    w->batch_msgs.assign(batch_size, mmsghdr());
+    w->batch_iov.assign(2 * batch_size, iovec());
+    w->batch_headers.assign(8 * batch_size, 0);
+    w->batch_objects.assign(batch_size, 0);
+    w->batch_intended.assign(batch_size, 0);
+    w->batch_len = 0;
+    w->batch_first_ns = 0;
+    w->num_batches = 0;
+
+    for (int i = 0; i < batch_size; i++) {
+        w->batch_iov[2 * i].iov_base = &w->batch_headers[8 * i];
+        w->batch_iov[2 * i].iov_len = 8;
+        w->batch_iov[2 * i + 1].iov_len = GET_FRAME_LEN - 8;
+
+        struct msghdr &msg = w->batch_msgs[i].msg_hdr;
+        msg.msg_name = w->memc_remote->data();
+        msg.msg_namelen = w->memc_remote->size();
+        msg.msg_iov = &w->batch_iov[2 * i];
+        msg.msg_iovlen = 2;
+    }
+}
+
+void uring_submit_requests(sender_worker *w);
+void packet_submit_requests(sender_worker *w);
+
+/* sends all queued requests of a worker with sendmmsg and stores them in the request table */
+void flush_requests(sender_worker *w)
+{
+    if (w->ring != nullptr) {
+        uring_submit_requests(w);
+        return;
+    }
+    if (w->packet != nullptr) {
+        packet_submit_requests(w);
+        return;
+    }
+    if (w->batch_len == 0) {
+        return;
+    }
+
+    // store the requests before sending, the responses may arrive before sendmmsg returns
+    // the time of request is taken once per batch (right before sending) but stored for every request, so the later
+    // requests of the batch are sent after their time of request (per-request send times: --timestamping)
+    int64_t request_time = now_ns();
+    for (int i = 0; i < w->batch_len; i++) {
+        uint16_t request_id = ((uint8_t)w->batch_headers[8 * i] << 8) | (uint8_t)w->batch_headers[8 * i + 1];
+        if (request_table_store(w->requests, request_id, w->batch_objects[i], request_time, w->batch_intended[i])) {
+            w->num_expired_requests++;
+        }
+    }
+
+    int fd = w->socket->native_handle();
+    int sent = 0;
+    while (sent < w->batch_len) {
+        int n = sendmmsg(fd, &w->batch_msgs[sent], w->batch_len - sent, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            std::cout << "Error sending batch. Code: " << errno << std::endl;
+            break;
+        }
+        sent += n;
+    }
+
+    // requests that couldn't be sent are removed from the request table again
+    for (int i = sent; i < w->batch_len; i++) {
+        uint16_t request_id = ((uint8_t)w->batch_headers[8 * i] << 8) | (uint8_t)w->batch_headers[8 * i + 1];
+        request_table_release(w->requests, request_id);
+    }
+    for (int i = 0; i < sent; i++) {
+        record_send_lag(w, request_time - w->batch_intended[i]);
+    }
+
+    counter_add(w->num_requests, sent);
+    w->num_batches++;
+    w->batch_len = 0;
+}
+
+/* queues a get request for object {object}, the batch is sent when it is full or batch_timeout_us passed */
+void queue_get_request(int object, sender_worker *w, int64_t intended_ns)
+{
+    int64_t time_now = now_ns();
+    if (w->batch_len == 0) {
+        w->batch_first_ns = time_now;
+    }
+
+    const uint16_t request_id = w->request_id++;
+    char *header = &w->batch_headers[8 * w->batch_len];
+    memcpy(header, w->frame_header, 8);
+    header[0] = (request_id >> 8);
+    header[1] = request_id & 0xFF;
+
+    w->batch_iov[2 * w->batch_len + 1].iov_base = get_frame(object) + 8;
+    w->batch_objects[w->batch_len] = object;
+    w->batch_intended[w->batch_len] = intended_ns;
+    w->batch_len++;
+
+    if (w->batch_len == batch_size || time_now - w->batch_first_ns >= (int64_t)batch_timeout_us * 1000) {
+        flush_requests(w);
+    }
+}
+
+void uring_queue_get_request(int object, sender_worker *w, int64_t intended_ns);
+void packet_queue_get_request(int object, sender_worker *w, int64_t intended_ns);
+
+// client-side balancing: ketama ring of the caches and home cache of every object on it
+ketama_ring lb_ring;
+std::vector<uint8_t> lb_home_cache;
+
+// bits of letheinfo (see udp_frame_header), client-side balancing describes the route of a request with them
+#define LETHEINFO_DB 0x10
+#define LETHEINFO_CACHE_SHIFT 5
+
+/* client-side balancing: sends the datagram {iov} to {endpoint} with sendmsg on the socket of worker {w}. Used by the
+ * sender and the receive thread, the socket is never written through boost::asio concurrently */
+inline bool lb_send(sender_worker *w, const ip::udp::endpoint &endpoint, struct iovec *iov, int iovlen)
+{
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = (void *)endpoint.data();
+    msg.msg_namelen = endpoint.size();
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iovlen;
+    return sendmsg(w->socket->native_handle(), &msg, 0) >= 0;
+}
+
+/* client-side balancing: deletes {object} on all caches after a write to the database, like the Lethe data plane
+ * does for a SET (noreply, the request id of the write) */
+void lb_invalidate(sender_worker *w, int object, uint16_t request_id)
+{
+    char header[8] = {(char)(request_id >> 8), (char)(request_id & 0xFF), 0, 0, 0, 1, 0, 0};
+    struct iovec iov[4] = {
+        {header, 8},
+        {(void *)"delete ", 7},
+        {(void *)object_key(object), (size_t)key_length},
+        {(void *)" noreply\r\n", 10}
+    };
+    for (const ip::udp::endpoint &cache : lb_caches) {
+        if (lb_send(w, cache, iov, 4)) {
+            w->num_invalidations++;
+        }
+    }
+}
+
+/* mixed workload: version state of an object. SETs and DELETEs of the object are numbered 1, 2, ... (the fill phase
+ * writes version 0), the version of a SET is sent in the first bytes of its value and returned by the GETs. {acked}
+ * is the newest acknowledged write: version << 32 | time of its response in microseconds since write_base_ns */
+struct object_version
+{
+    std::atomic<uint32_t> next;      // version of the last write sent
+    std::atomic<uint64_t> acked;
+};
+
+object_version *object_versions = nullptr;  // by object, nullptr if the workload has no writes
+int64_t write_base_ns = 0;                  // time base of object_version::acked
+
+// mixed workload: a SET replaces the first WRITE_VERSION_LEN bytes of the value with "#" and its version in 10 digits.
+// The flags can't carry the version, the P4 switch keeps only one flags character when it turns a database VALUE into a
+// SET to the caches. '#' isn't in key_chars, so the values of the fill phase (version 0) have no version prefix
+#define WRITE_VERSION_LEN 11
+
+/* writes the version prefix of {version} to {dst} (WRITE_VERSION_LEN + 1 bytes) */
+inline void write_version_prefix(char *dst, uint32_t version)
+{
+    snprintf(dst, WRITE_VERSION_LEN + 1, "#%010u", version);
+}
+
+/* version of the value {data} of {len} bytes: the version of its prefix, 0 if it has none */
+inline uint32_t value_version(const char *data, size_t len)
+{
+    if (len < WRITE_VERSION_LEN || data[0] != '#') {
+        return 0;
+    }
+    uint32_t version = 0;
+    for (int i = 1; i < WRITE_VERSION_LEN && data[i] >= '0' && data[i] <= '9'; i++) {
+        version = version * 10 + (data[i] - '0');
+    }
+    return version;
+}
+
+/* mixed workload: sends a SET (the value of the object with a new version) or a DELETE {operation} for object {object}
+ * via UDP and stores it in the request table. Writes are sent directly, also if the GETs are batched */
+void send_write_request(int object, sender_worker *w, int64_t intended_ns, uint32_t operation)
+{
+    const uint16_t request_id = w->request_id;
+    const bool is_set = operation == WRITE_SET;
+    const uint32_t version = (object_versions[object].next.fetch_add(1, std::memory_order_relaxed) + 1) & WRITE_VERSION_MASK;
+    const int value_len = is_set ? w->objects->value_len[object] : 0;
+
+    w->frame_header[0] = (request_id >> 8);
+    w->frame_header[1] = request_id & 0xFF;
+
+    char params[48];  // " <flags> <exptime> <bytes>\r\n"
+    int params_len = is_set ? snprintf(params, sizeof(params), " 0 %d %d\r\n", object_exptime, value_len) : snprintf(params, sizeof(params), "\r\n");
+    char prefix[WRITE_VERSION_LEN + 1];
+    write_version_prefix(prefix, version);
+    const int prefix_len = is_set ? WRITE_VERSION_LEN : 0;
+
+    std::array<const_buffer, 7> req = {
+        buffer(w->frame_header, 8),
+        is_set ? buffer("set ", 4) : buffer("delete ", 7),
+        buffer(object_key(object), key_length),
+        buffer(params, params_len),
+        buffer(prefix, prefix_len),
+        buffer(value_pool + value_pool_offset(object) + prefix_len, value_len - prefix_len),
+        buffer("\r\n", is_set ? 2 : 0)
+    };
+
+    boost::system::error_code err;
+
+    auto request_time = now_ns();
+    if (request_table_store(w->requests, request_id, object, request_time, intended_ns, operation << 30 | version, LETHEINFO_DB)) {
+        w->num_expired_requests++;
+    }
+    w->socket->send_to(req, *w->memc_remote, 0, err);
+
+    if (err.value() != 0) {
+        request_table_release(w->requests, request_id);
+    } else {
+        w->request_id++;
+        counter_add(w->num_requests, 1);
+        if (is_set) {
+            w->num_sets++;
+        } else {
+            w->num_deletes++;
+        }
+        record_send_lag(w, request_time - intended_ns);
+        if (lb_strategy != 0) {
+            lb_invalidate(w, object, request_id);
+        }
+    }
+}
+
+/* client-side balancing: the cache of a GET of {object} as letheinfo: the cache id and, as hotness, WARM1 for the home
+ * cache of the key on the ketama ring or HOT for any cache (p2c, hot keys) */
+inline uint8_t lb_choose_cache(sender_worker *w, int object, uint16_t request_id)
+{
+    int num_caches = lb_caches.size();
+    if (lb_strategy == 2) {
+        uint64_t r = next_random(w->lb_state);
+        int a = r % num_caches;
+        int b = num_caches > 1 ? (a + 1 + (r >> 32) % (num_caches - 1)) % num_caches : a;
+        int cache = w->cache_outstanding[b].load(std::memory_order_relaxed) < w->cache_outstanding[a].load(std::memory_order_relaxed) ? b : a;
+        return cache << LETHEINFO_CACHE_SHIFT | 2;
+    }
+    if (lb_strategy == 3) {
+        hotkey_record(*w->hotkeys, object);
+        if (w->hotkeys->is_hot[object]) {
+            return (request_id % num_caches) << LETHEINFO_CACHE_SHIFT | 2;
+        }
+    }
+    return lb_home_cache[object] << LETHEINFO_CACHE_SHIFT | 1;
+}
+
+/* client-side balancing: sends a GET for {object} to the cache chosen by lb_strategy and stores its route in the
+ * request table. A cache miss is fetched from the database by the receive thread (see lb_fetch_from_database) */
+void send_balanced_request(int object, sender_worker *w, int64_t intended_ns)
+{
+    const uint16_t request_id = w->request_id;
+    auto request_time = now_ns();
+    if (lb_strategy == 3 && request_time >= w->hotkeys_update_ns) {
+        hotkey_update(*w->hotkeys, LB_TOPK_DECAY);
+        w->hotkeys_update_ns = request_time + (int64_t)lb_interval_ms * 1000000;
+    }
+    uint8_t route = lb_choose_cache(w, object, request_id);
+    int cache = route >> LETHEINFO_CACHE_SHIFT;
+
+    char header[8] = {(char)(request_id >> 8), (char)(request_id & 0xFF), 0, 0, 0, 1, 0, (char)route};
+    struct iovec iov[2] = {{header, 8}, {get_frame(object) + 8, GET_FRAME_LEN - 8}};
+
+    // an overwritten request without response no longer counts at its cache (unless the cache answered and it went
+    // on to the database)
+    request_slot &old = w->requests->slots[request_id];
+    bool old_at_cache = !(old.state.load(std::memory_order_relaxed) & SLOT_REISSUED) && !(old.route.load(std::memory_order_relaxed) & LETHEINFO_DB);
+    int old_cache = old.route.load(std::memory_order_relaxed) >> LETHEINFO_CACHE_SHIFT;
+    if (request_table_store(w->requests, request_id, object, request_time, intended_ns, 0, route)) {
+        w->num_expired_requests++;
+        if (old_at_cache) {
+            w->cache_outstanding[old_cache].fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+    w->cache_outstanding[cache].fetch_add(1, std::memory_order_relaxed);
+
+    if (!lb_send(w, lb_caches[cache], iov, 2)) {
+        request_table_release(w->requests, request_id);
+        w->cache_outstanding[cache].fetch_sub(1, std::memory_order_relaxed);
+        return;
+    }
+    w->request_id++;
+    counter_add(w->num_requests, 1);
+    w->cache_requests[cache]++;
+    record_send_lag(w, request_time - intended_ns);
+}
+
+/* sends a request for object {object}: a GET, either directly or batched, or in the mixed workload a SET or DELETE
+ * with the percentages of --mix. With client-side balancing, the GETs are sent to the caches directly */
+inline void send_request(int object, sender_worker *w, int64_t intended_ns)
+{
+    if (object_versions != nullptr) {
+        uint32_t r = next_random(w->mix_state) % 100;
+        if (r < (uint32_t)(set_percent + delete_percent)) {
+            send_write_request(object, w, intended_ns, r < (uint32_t)set_percent ? WRITE_SET : WRITE_DELETE);
+            return;
+        }
+    }
+    if (lb_strategy != 0) {
+        send_balanced_request(object, w, intended_ns);
+    } else if (w->ring != nullptr) {
+        uring_queue_get_request(object, w, intended_ns);
+    } else if (w->packet != nullptr) {
+        packet_queue_get_request(object, w, intended_ns);
+    } else if (batch_size > 1) {
+        queue_get_request(object, w, intended_ns);
+    } else {
+        do_udp_get_request(object, w, intended_ns);
+    }
+}
+
+/* sends the queued requests if the batch timeout would pass while sleeping {sleep_time} seconds */
+inline void flush_requests_before_sleep(sender_worker *w, double sleep_time)
+{
+    if (w->ring != nullptr || w->packet != nullptr) {
+        return;  // uring_wait_until/packet_wait_until submit before they sleep
+    }
+    if (w->batch_len > 0 && now_ns() + (int64_t)(sleep_time * 1e9) >= w->batch_first_ns + (int64_t)batch_timeout_us * 1000) {
+        flush_requests(w);
+    }
+}
+
+/* waits until {time_ns} (clock of now_ns): sleeps until PACER_SPIN_US before {time_ns} and spins for the rest,
+ * as sleeping alone wakes up tens of microseconds too late */
+inline void wait_until_ns(int64_t time_ns)
+{
+    int64_t remaining = time_ns - now_ns();
+    if (remaining > PACER_SPIN_US * 1000) {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(remaining - PACER_SPIN_US * 1000));
+    }
+    while (now_ns() < time_ns) {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+}
+
+void uring_wait_until(sender_worker *w, int64_t time_ns, bool until_response);
+void packet_wait_until(sender_worker *w, int64_t time_ns, bool until_response);
+
+/* waits until {time_ns}. The io_uring backend and the raw-frame mode process the responses meanwhile */
+inline void wait_for_next_request(sender_worker *w, int64_t time_ns)
+{
+    if (w->ring != nullptr) {
+        uring_wait_until(w, time_ns, false);
+    } else if (w->packet != nullptr) {
+        packet_wait_until(w, time_ns, false);
+    } else {
+        wait_until_ns(time_ns);
+    }
+}
+
+/* entry of the timer heap of schedule_task: time of the next request of an object */
+struct scheduled_call
+{
+    int64_t next_call_ns;
+    uint32_t object;
+};
+
+/* heap order for std::make_heap/push_heap/pop_heap: earliest call on top */
+inline bool later_call(const scheduled_call &a, const scheduled_call &b)
+{
+    return a.next_call_ns > b.next_call_ns;
+}
+
+/* task that schedules and creates requests to the Memcached server (objects of the worker's slice only)
+ * The next call of every object is kept in a min-heap, so only the objects that are due are touched (O(log n) per request) */
+void schedule_task(sender_worker *w)
+{
+    object_store *objects = w->objects;
+    int64_t test_time_remaining = 0;  // used for priting the remaining time
+
+    const int64_t end_ns = test_start_ns + (int64_t)test_duration_seconds * 1000000000;
+
+    // first call of each object at a random point within its inter-request time, so the test doesn't start with a burst
+    std::vector<scheduled_call> heap;
+    heap.reserve(w->last_object - w->first_object);
+    uint64_t state = derived_seed("schedule", w->id);
+    for (int i = w->first_object; i < w->last_object; i++) {
+        int64_t irt_ns = (int64_t)std::max(objects->irt_ms[i], 1) * 1000000;
+        heap.push_back(scheduled_call{test_start_ns + (int64_t)(next_random_unit(state) * irt_ns), (uint32_t)i});
+    }
+    std::make_heap(heap.begin(), heap.end(), later_call);
+
+    while (heap.front().next_call_ns < end_ns)
+    {
+        int64_t time_now = now_ns();
+        if (heap.front().next_call_ns > time_now) {
+            flush_requests(w);
+            wait_for_next_request(w, heap.front().next_call_ns);
+            time_now = now_ns();
+        }
+
+        // send all requests that are due, the next call is relative to the scheduled call so the inter-request time doesn't drift
+        while (heap.front().next_call_ns <= time_now)
+        {
+            std::pop_heap(heap.begin(), heap.end(), later_call);
+            scheduled_call &call = heap.back();
+            send_request(call.object, w, call.next_call_ns);
+            call.next_call_ns += (int64_t)std::max(objects->irt_ms[call.object], 1) * 1000000;
+            std::push_heap(heap.begin(), heap.end(), later_call);
+        }
+
+        if (w->id == 0 && (end_ns - time_now) / 1000000000 != test_time_remaining) {
+            test_time_remaining = (end_ns - time_now) / 1000000000;
+            std::cout << "\rRemaining time: " << test_time_remaining << "s" << std::flush;
+        }
+    }
+    flush_requests(w);
+}
+
+/* sets up the Zipf sampler once, it is shared by all sender threads */
+void prepare_zipf_distribution(int count)
+{
+    uint64_t scramble_key = derived_seed("zipf_scramble", 0);
+    zipf_init(zipf, count, alpha, zipf_scramble, scramble_key);
+}
+
+/* popularity phases (--shift): the test is split into phases of shift_interval_seconds, each with its own mapping of
+ * the Zipf ranks to the objects. A request belongs to the phase of its intended time of request. The shift_track most
+ * popular objects of a phase that weren't among them in the phase before are the new hot objects of its shift, for
+ * which the receive threads record when the first response came back HOT or WARM (shift 0 is the start of the test) */
+struct popularity_shift
+{
+    int64_t time_ns;          // start of the phase, relative to the start of the test
+    uint64_t shuffle_key;     // shuffle: key of the permutation of the ranks (odd)
+    uint32_t first_hot;       // new hot objects: shift_hot_objects[first_hot, first_hot + num_hot)
+    uint32_t num_hot;
+};
+
+std::vector<popularity_shift> shifts;
+std::vector<uint32_t> shift_hot_objects;
+std::unordered_map<uint64_t, uint32_t> shift_hot_index;  // phase << 32 | object -> index in shift_hot_objects
+int64_t shift_interval_ns = 0;
+std::vector<int64_t> shift_classified_ns;  // first HOT/WARM response of every new hot object (merged after the test)
+std::vector<shift_bin> shift_bins;         // responses by intended time of request (merged after the test)
+
+/* phase of a request with intended time {intended_ns} */
+inline int shift_phase(int64_t intended_ns)
+{
+    int64_t phase = (intended_ns - test_start_ns) / shift_interval_ns;
+    return (int)std::min(std::max(phase, (int64_t)0), (int64_t)shifts.size() - 1);
+}
+
+/* object of Zipf rank {rank} in phase {phase}: rotate moves the ranks by shift_size objects per phase, shuffle maps
+ * them with a new permutation in every phase */
+inline uint32_t shifted_object(uint64_t rank, int phase)
+{
+    if (shift_mode == 2 && phase > 0) {
+        return (uint32_t)zipf_permute(zipf, rank - 1, shifts[phase].shuffle_key);
+    }
+    uint64_t index = zipf_rank_to_index(zipf, rank);
+    if (shift_mode == 1) {
+        index = (index + (uint64_t)phase * shift_size) % zipf.n;
+    }
+    return (uint32_t)index;
+}
+
+/* sets up the phases of the test and the new hot objects of every shift (after prepare_zipf_distribution) */
+void prepare_popularity_shifts()
+{
+    shift_interval_ns = (int64_t)(shift_interval_seconds * 1e9);
+    int num_phases = (int)std::ceil(test_duration_seconds / shift_interval_seconds);
+    shifts.assign(num_phases, popularity_shift{0, 0, 0, 0});
+    shift_hot_objects.clear();
+    shift_hot_index.clear();
+
+    std::vector<uint32_t> top, previous;
+    for (int p = 0; p < num_phases; p++) {
+        popularity_shift &shift = shifts[p];
+        shift.time_ns = p * shift_interval_ns;
+        shift.shuffle_key = derived_seed("shuffle", p) | 1;
+        shift.first_hot = shift_hot_objects.size();
+
+        top.clear();
+        for (int rank = 1; rank <= shift_track; rank++) {
+            top.push_back(shifted_object(rank, p));
+        }
+        for (uint32_t object : top) {
+            if (std::find(previous.begin(), previous.end(), object) == previous.end()) {
+                shift_hot_index[(uint64_t)p << 32 | object] = shift_hot_objects.size();
+                shift_hot_objects.push_back(object);
+            }
+        }
+        shift.num_hot = shift_hot_objects.size() - shift.first_hot;
+        std::swap(top, previous);
+    }
+}
+
+/* popularity shifts: records a response in the bin of its intended time of request and, if it is the first HOT or
+ * WARM response for a new hot object of the phase of its request, the time it arrived (called by the receive threads) */
+inline void record_shift_response(sender_worker *w, uint32_t object, int64_t intended_ns, int64_t receive_ns, uint8_t letheinfo, uint32_t intended_response_time_us)
+{
+    size_t bin = (intended_ns - test_start_ns) / ((int64_t)SHIFT_BIN_MS * 1000000);
+    if (bin < w->shift_bins.size()) {
+        shift_bin &b = w->shift_bins[bin];
+        b.count++;
+        b.db_responses += (letheinfo >> 4) & 1;
+        b.sum_us += intended_response_time_us;
+    }
+    if ((letheinfo & 0b00000111) == 0) {
+        return;  // COLD
+    }
+    auto it = shift_hot_index.find((uint64_t)shift_phase(intended_ns) << 32 | object);
+    if (it != shift_hot_index.end()) {
+        w->shift_classified_ns[it->second] = std::min(w->shift_classified_ns[it->second], receive_ns - test_start_ns);
+    }
+}
+
+/* open-loop arrival engine of zipf_task and uniform_task: sends {total_no_requests} requests at the intended times
+ * of the arrival process (constant or exponential inter-arrival times), independent of the responses.
+ * A sender that falls behind sends the following requests immediately until it caught up, but the requests keep
+ * their intended time of request, so response times measured from the intended time include the delay a client
+ * with this request rate would have seen (coordinated omission correction). */
+template <class ObjectChooser>
+void open_loop_task(sender_worker *w, ObjectChooser choose_object)
+{
+    const int total_no_requests = w->total_no_requests;
+    int64_t test_time_remaining = 0;  // used for priting the remaining time
+
+    const int64_t end_ns = test_start_ns + (int64_t)test_duration_seconds * 1000000000;
+    const double request_interval_ns = (double)test_duration_seconds * 1e9 / total_no_requests;
+
+    uint64_t state = derived_seed("open_loop", w->id);
+
+    double intended_ns = test_start_ns;
+    for (int i = 0; i < total_no_requests; i++) {
+        intended_ns += (arrival_process == 1) ? -std::log(1.0 - next_random_unit(state)) * request_interval_ns : request_interval_ns;  // exponential: inverse CDF
+
+        int64_t time_now = now_ns();
+        if ((int64_t)intended_ns > time_now) {
+            flush_requests_before_sleep(w, (intended_ns - time_now) / 1e9);
+            wait_for_next_request(w, (int64_t)intended_ns);
+            time_now = now_ns();
+        }
+
+        send_request(choose_object(state, (int64_t)intended_ns), w, (int64_t)intended_ns);
+
+        if (w->id == 0 && (end_ns - time_now) / 1000000000 != test_time_remaining) {
+            test_time_remaining = (end_ns - time_now) / 1000000000;
+            std::cout << "\rRemaining time: " << test_time_remaining << "s" << std::flush;
+        }
+    }
+    flush_requests(w);
+}
+
+/* state of a virtual client of closed_loop_task */
+struct virtual_client
+{
+    bool waiting;         // request without response
+    uint16_t request_id;  // of the request without response
+    int64_t request_ns;   // time of request
+};
+
+/* closed-loop engine of zipf_task and uniform_task: {num_clients} virtual clients, each sends a request, waits for its
+ * response and think_time_us, then sends its next request, until the test duration is over or {total_no_requests}
+ * requests were sent. The request rate is the one the server sustains with this number of clients.
+ * At most {max_outstanding} requests are without response: a client that is ready while the limit is reached waits,
+ * its request keeps the time the client became ready as intended time of request. A client that didn't get a response
+ * after REQUEST_TIMEOUT_MS gives up and continues with its next request. */
+template <class ObjectChooser>
+void closed_loop_task(sender_worker *w, ObjectChooser choose_object)
+{
+    int64_t test_time_remaining = 0;  // used for priting the remaining time
+
+    const int64_t end_ns = test_start_ns + (int64_t)test_duration_seconds * 1000000000;
+    const int64_t timeout_ns = (int64_t)REQUEST_TIMEOUT_MS * 1000000;
+    const int64_t think_ns = (int64_t)think_time_us * 1000;
+
+    uint64_t state = derived_seed("closed_loop", w->id);
+
+    std::vector<virtual_client> clients(w->num_clients, virtual_client{false, 0, 0});
+    std::vector<int32_t> client_of_request(REQUEST_TABLE_SIZE, -1);  // virtual client waiting for the response of a request id
+
+    // clients that are ready to send, in the order they became ready (the think time is the same for all clients)
+    std::deque<scheduled_call> ready;
+    for (int c = 0; c < w->num_clients; c++) {
+        ready.push_back(scheduled_call{test_start_ns, (uint32_t)c});
+    }
+    int outstanding = 0;
+    int num_sent = 0;
+    int64_t next_timeout_check_ns = test_start_ns;
+
+    while (num_sent < w->total_no_requests)
+    {
+        int64_t time_now = now_ns();
+        if (time_now >= end_ns) {
+            break;
+        }
+        bool idle = true;
+
+        uint16_t request_id;
+        while (completion_queue_pop(w->completions, &request_id)) {
+            int c = client_of_request[request_id];
+            client_of_request[request_id] = -1;
+            if (c >= 0 && clients[c].waiting && clients[c].request_id == request_id) {
+                clients[c].waiting = false;
+                outstanding--;
+                ready.push_back(scheduled_call{time_now + think_ns, (uint32_t)c});
+            }
+            idle = false;
+        }
+
+        // once per millisecond: clients whose request timed out give up
+        if (time_now >= next_timeout_check_ns) {
+            for (int c = 0; c < w->num_clients; c++) {
+                if (clients[c].waiting && time_now - clients[c].request_ns > timeout_ns) {
+                    clients[c].waiting = false;
+                    if (client_of_request[clients[c].request_id] == c) {
+                        client_of_request[clients[c].request_id] = -1;
+                    }
+                    outstanding--;
+                    w->num_client_timeouts++;
+                    ready.push_back(scheduled_call{time_now + think_ns, (uint32_t)c});
+                }
+            }
+            next_timeout_check_ns = time_now + 1000000;
+        }
+
+        while (!ready.empty() && ready.front().next_call_ns <= time_now && outstanding < w->max_outstanding && num_sent < w->total_no_requests) {
+            int c = ready.front().object;
+            int64_t intended_ns = ready.front().next_call_ns;
+            ready.pop_front();
+
+            clients[c] = virtual_client{true, w->request_id, time_now};
+            client_of_request[w->request_id] = c;
+            send_request(choose_object(state, intended_ns), w, intended_ns);
+            outstanding++;
+            num_sent++;
+            idle = false;
+        }
+        flush_requests(w);
+
+        if (idle && (w->ring != nullptr || w->packet != nullptr)) {
+            // the responses are received by this thread: wait for one, for the next client to become ready or for the next timeout check
+            int64_t wait_until = std::min(next_timeout_check_ns, end_ns);
+            if (!ready.empty() && outstanding < w->max_outstanding) {
+                wait_until = std::min(wait_until, ready.front().next_call_ns);
+            }
+            if (w->ring != nullptr) {
+                uring_wait_until(w, wait_until, true);
+            } else {
+                packet_wait_until(w, wait_until, true);
+            }
+        } else if (idle) {
+            std::this_thread::yield();  // the receive thread may run on the same CPU
+        }
+
+        if (w->id == 0 && (end_ns - time_now) / 1000000000 != test_time_remaining) {
+            test_time_remaining = (end_ns - time_now) / 1000000000;
+            std::cout << "\rRemaining time: " << test_time_remaining << "s" << std::flush;
+        }
+    }
+    flush_requests(w);
+}
+
+/* schedule_task but for Zipf distribution
+ * Every worker draws from the whole distribution (with its own random generator), slicing the objects
+ * would change the popularity of the objects per worker */
+void zipf_task(sender_worker *w)
+{
+    std::fill(w->counter_ranks, w->counter_ranks + ZIPF_PRINT_RANKS, 0);
+
+    auto choose_object = [w](uint64_t &state, int64_t intended_ns) {
+        uint64_t rank = zipf_sample_rank(zipf, [&state]() { return next_random_unit(state); });
+        if (rank <= ZIPF_PRINT_RANKS) {
+            w->counter_ranks[rank - 1] += 1;
+        }
+        if (shift_mode != 0) {
+            return (int)shifted_object(rank, shift_phase(intended_ns));
+        }
+        return (int)zipf_rank_to_index(zipf, rank);
+    };
+    if (w->num_clients > 0) {
+        closed_loop_task(w, choose_object);
+    } else {
+        open_loop_task(w, choose_object);
+    }
+}
+
+/* schedule_task but for Uniform distribution (objects of the worker's slice only) */
+void uniform_task(sender_worker *w)
+{
+    auto choose_object = [w](uint64_t &state, int64_t) {
+        return w->first_object + (int)(next_random(state) % (w->last_object - w->first_object));
+    };
+    if (w->num_clients > 0) {
+        closed_loop_task(w, choose_object);
+    } else {
+        open_loop_task(w, choose_object);
+    }
+}
+
+/* replays the trace (distribution 3): every sender thread reads the whole trace and sends every num_sender_threads-th
+ * of the first trace_num_requests requests at the time of the request in the trace relative to the first one, divided
+ * by trace_speed. A timestamp lower than the one before (e.g. a trace merged from several clients) is replayed at the
+ * one before. Like open_loop_task, a sender that falls behind catches up and the requests keep their intended time */
+void trace_task(sender_worker *w)
+{
+    int64_t test_time_remaining = 0;  // used for priting the remaining time
+
+    const int64_t end_ns = test_start_ns + (int64_t)(trace_span_ns / trace_speed);
+
+    trace_cursor cursor = {0};
+    trace_request r;
+    int64_t timestamp_ns = trace_first_ns;
+    for (uint64_t i = 0; i < trace_num_requests && trace_next(trace, cursor, r); i++) {
+        timestamp_ns = std::max(timestamp_ns, r.timestamp_ns);
+        if (i % num_sender_threads != (uint64_t)w->id) {
+            continue;
+        }
+        int64_t intended_ns = test_start_ns + (int64_t)((timestamp_ns - trace_first_ns) / trace_speed);
+
+        int64_t time_now = now_ns();
+        if (intended_ns > time_now) {
+            flush_requests_before_sleep(w, (intended_ns - time_now) / 1e9);
+            wait_for_next_request(w, intended_ns);
+            time_now = now_ns();
+        }
+
+        int object = trace.binary ? (int)r.key_index : (int)trace_objects.find(std::string_view(r.key, r.key_len))->second;
+        send_request(object, w, intended_ns);
+
+        if (w->id == 0 && (end_ns - time_now) / 1000000000 != test_time_remaining) {
+            test_time_remaining = (end_ns - time_now) / 1000000000;
+            std::cout << "\rRemaining time: " << test_time_remaining << "s" << std::flush;
+        }
+    }
+    flush_requests(w);
+}
+
+/* records the response time of a response in the latency histograms of its classes */
+inline void record_latency(sender_worker *w, uint8_t letheinfo, bool is_hit, uint32_t response_time_us, uint32_t intended_response_time_us)
+{
+    int hotness = letheinfo & 0b00000111;
+    bool is_db_response = (letheinfo >> 4) & 1;
+    int cache_id = (letheinfo >> 5) & 0b00000111;
+
+    hist_record(w->latency[LAT_ALL], response_time_us);
+    hist_record(w->latency[LAT_INTENDED], intended_response_time_us);
+    hist_record(w->latency[LAT_CACHE_ID + cache_id], response_time_us);
+    if (!is_hit) {
+        hist_record(w->latency[LAT_MISS], response_time_us);
+        return;
+    }
+    hist_record(w->latency[LAT_HIT], response_time_us);
+
+    // hotness 0=COLD 1=WARM1 2=HOT 3=WARM2
+    static const int hotness_class[4] = {LAT_COLD, LAT_WARM1, LAT_HOT, LAT_WARM2};
+    if (hotness < 4) {
+        hist_record(w->latency[hotness_class[hotness]], response_time_us);
+    }
+
+    if (is_db_response && hotness == 0)
+        hist_record(w->latency[LAT_DB_COLD], response_time_us);
+    else if (is_db_response && hotness != 0)
+        hist_record(w->latency[LAT_DB_CACHE_MISS], response_time_us);
+    else
+        hist_record(w->latency[LAT_CACHE], response_time_us);
+}
+
+/* Memcached UDP frame header */
+struct udp_frame_header
+{
+    uint16_t request_id;
+    uint16_t sequence;   // number of this datagram
+    uint16_t total;      // number of datagrams of the response
+    uint16_t letheinfo;  // reserved field, used by Lethe: hotness (bits 0-2), DB response (bit 4), cache id (bits 5-7)
+};
+
+inline bool parse_frame_header(const char *data, size_t len, udp_frame_header &header)
+{
+    if (len < 8) {
+        return false;
+    }
+    const uint8_t *d = (const uint8_t *)data;
+    header.request_id = d[0] << 8 | d[1];
+    header.sequence = d[2] << 8 | d[3];
+    header.total = d[4] << 8 | d[5];
+    header.letheinfo = d[6] << 8 | d[7];
+    return header.sequence < header.total;
+}
+
+enum response_status
+{
+    RESPONSE_HIT,
+    RESPONSE_MISS,
+    RESPONSE_INVALID
+};
+
+/* checks that [{p}, {end}) is "END\r\n" or "END <key>\r\n" and returns the key (key_len 0 if there is none) */
+inline bool parse_end_line(const char *p, const char *end, const char **key, size_t *key_len)
+{
+    if (end - p < 5 || memcmp(p, "END", 3) != 0 || end[-2] != '\r' || end[-1] != '\n') {
+        return false;
+    }
+    if (p + 5 == end) {
+        *key_len = 0;
+        return true;
+    }
+    if (p[3] != ' ') {
+        return false;
+    }
+    *key = p + 4;
+    *key_len = end - 2 - *key;
+    return true;
+}
+
+/* parses a complete GET response: "VALUE <key> <flags> <bytes>\r\n<data>\r\nEND\r\n" (hit) or "END\r\n" (miss).
+ * The patched Memcached of Lethe appends the key to END. Returns the key (key_len 0 if a miss has none), the value
+ * and its length */
+response_status parse_get_response(const char *p, size_t len, const char **key, size_t *key_len, const char **value, size_t *value_bytes)
+{
+    const char *end = p + len;
+    *value = nullptr;
+    *value_bytes = 0;
+
+    if (len < 6 || memcmp(p, "VALUE ", 6) != 0) {
+        return parse_end_line(p, end, key, key_len) ? RESPONSE_MISS : RESPONSE_INVALID;
+    }
+
+    const char *line_end = (const char *)memchr(p, '\r', len);
+    if (line_end == nullptr || line_end + 1 >= end || line_end[1] != '\n') {
+        return RESPONSE_INVALID;
+    }
+    const char *response_key = p + 6;
+    const char *key_end = (const char *)memchr(response_key, ' ', line_end - response_key);
+    const char *flags_end = key_end ? (const char *)memchr(key_end + 1, ' ', line_end - key_end - 1) : nullptr;
+    if (flags_end == nullptr) {
+        return RESPONSE_INVALID;
+    }
+
+    // <bytes>, optionally followed by " <cas unique>"
+    size_t bytes = 0;
+    const char *c = flags_end + 1;
+    for (; c < line_end && *c >= '0' && *c <= '9'; c++) {
+        bytes = bytes * 10 + (*c - '0');
+    }
+    if (c == flags_end + 1 || (c != line_end && *c != ' ')) {
+        return RESPONSE_INVALID;
+    }
+
+    const char *data = line_end + 2;
+    const char *end_key;
+    size_t end_key_len;
+    if ((size_t)(end - data) < bytes + 2 || data[bytes] != '\r' || data[bytes + 1] != '\n' || !parse_end_line(data + bytes + 2, end, &end_key, &end_key_len)) {
+        return RESPONSE_INVALID;
+    }
+
+    *key = response_key;
+    *key_len = key_end - response_key;
+    *value = data;
+    *value_bytes = bytes;
+    return RESPONSE_HIT;
+}
+
+/* records the response time between the kernel timestamps of a request and its response if it is plausible: a timestamp
+ * of an older request with the same request id gives a time longer than the userspace response time (+2us for the
+ * rounding and the two clocks), and is dropped */
+inline void record_kernel_latency(sender_worker *w, timestamp_slot &slot)
+{
+    int64_t kernel_response_time_ns = slot.rx_ns - slot.tx_ns;
+    if (kernel_response_time_ns > 0 && kernel_response_time_ns / 1000 <= (int64_t)slot.response_time_us + 2) {
+        hist_record(w->latency[LAT_KERNEL], kernel_response_time_ns / 1000);
+    }
+    slot.tx_ns = 0;
+    slot.rx_ns = 0;
+}
+
+/* transmit timestamp of the request {request_id} from the socket error queue */
+inline void record_tx_timestamp(sender_worker *w, uint16_t request_id, int64_t tx_ns)
+{
+    timestamp_slot &slot = w->timestamps[request_id];
+    slot.tx_ns = tx_ns;
+    w->num_tx_timestamps++;
+    if (slot.rx_ns != 0) {
+        record_kernel_latency(w, slot);
+    }
+}
+
+/* receive timestamp of the valid response to {request_id} (w->kernel_rx_ns, 0 if the datagram had none) */
+inline void record_rx_timestamp(sender_worker *w, uint16_t request_id, uint32_t response_time_us)
+{
+    if (w->kernel_rx_ns == 0) {
+        return;
+    }
+    timestamp_slot &slot = w->timestamps[request_id];
+    slot.rx_ns = w->kernel_rx_ns;
+    slot.response_time_us = response_time_us;
+    if (slot.tx_ns != 0) {
+        record_kernel_latency(w, slot);
+    }
+}
+
+/* true if the response [{p}, {p} + {len}) is the line {line} followed by "\r\n" */
+inline bool response_is(const char *p, size_t len, const char *line)
+{
+    size_t line_len = strlen(line);
+    return len == line_len + 2 && memcmp(p, line, line_len) == 0 && p[line_len] == '\r' && p[line_len + 1] == '\n';
+}
+
+/* mixed workload: the write {version} of {object} was acknowledged at {receive_time}. Only a newer version than the
+ * one already acknowledged is stored (the receive threads may process the acknowledgements out of order) */
+inline void record_write_ack(uint32_t object, uint32_t version, int64_t receive_time)
+{
+    uint64_t acked = (uint64_t)version << 32 | (uint32_t)((receive_time - write_base_ns) / 1000);
+    std::atomic<uint64_t> &newest = object_versions[object].acked;
+    uint64_t old = newest.load(std::memory_order_relaxed);
+    while ((old >> 32) < version && !newest.compare_exchange_weak(old, acked, std::memory_order_relaxed)) {
+    }
+}
+
+/* mixed workload: validates and records the response to a SET or DELETE ({write}: operation << 30 | version, see
+ * request_table.h). "STORED", "DELETED" and "NOT_FOUND" acknowledge the write, "NOT_STORED" and "SERVER_ERROR" fail */
+void process_write_response(sender_worker *w, uint32_t write, uint32_t object, const char *payload, size_t len, int64_t request_time, int64_t receive_time)
+{
+    bool is_set = (write >> 30) == WRITE_SET;
+    bool acked = is_set ? response_is(payload, len, "STORED") : response_is(payload, len, "DELETED") || response_is(payload, len, "NOT_FOUND");
+    bool failed = response_is(payload, len, "NOT_STORED") || (len >= 12 && memcmp(payload, "SERVER_ERROR", 12) == 0);
+    if (!acked && !failed) {
+        counter_add(w->num_invalid_responses, 1);
+        return;
+    }
+
+    hist_record(w->latency[is_set ? LAT_SET : LAT_DELETE], (receive_time - request_time) / 1000);
+    if (failed) {
+        w->num_write_failures++;
+        return;
+    }
+    record_write_ack(object, write & WRITE_VERSION_MASK, receive_time);
+}
+
+/* mixed workload: a hit is a stale read if it returned an older {version} than a write that was acknowledged before
+ * the GET was sent. Only the newest acknowledged write of an object is kept, so a stale read is missed if a newer
+ * write was acknowledged while the GET was in flight (the counts are a lower bound). The time since the newer write
+ * was acknowledged (how long the stale value outlived the write) is recorded in LAT_STALE */
+inline void check_stale_read(sender_worker *w, uint32_t object, uint32_t version, uint8_t letheinfo, int64_t request_time, int64_t receive_time)
+{
+    uint64_t acked = object_versions[object].acked.load(std::memory_order_relaxed);
+    int64_t acked_ns = write_base_ns + (int64_t)(uint32_t)acked * 1000;
+    if (version >= (acked >> 32) || acked_ns > request_time) {
+        return;
+    }
+    hist_record(w->latency[LAT_STALE], (receive_time - acked_ns) / 1000);
+    if (!((letheinfo >> 4) & 1)) {
+        w->num_stale_cache_reads++;
+    }
+}
+
+/* client-side balancing: a cache missed {object}, the request is sent to the database again with the same request id
+ * (look-aside). Returns false if the request id was reused meanwhile or the request couldn't be sent */
+bool lb_fetch_from_database(sender_worker *w, uint16_t request_id, int object, uint8_t route)
+{
+    if (!request_table_reissue(w->requests, request_id)) {
+        return false;
+    }
+    char header[8] = {(char)(request_id >> 8), (char)(request_id & 0xFF), 0, 0, 0, 1, 0, (char)(route | LETHEINFO_DB)};
+    struct iovec iov[2] = {{header, 8}, {get_frame(object) + 8, GET_FRAME_LEN - 8}};
+    if (!lb_send(w, *w->memc_remote, iov, 2)) {
+        request_table_release(w->requests, request_id);
+        return false;
+    }
+    w->num_db_fetches++;
+    return true;
+}
+
+/* client-side balancing: writes the value the database returned for {object} to {cache}, which missed it (look-aside),
+ * with the {version} of the database value (mixed workload) and without response (noreply) */
+void lb_fill_cache(sender_worker *w, int object, int cache, uint32_t version)
+{
+    const int value_len = w->objects->value_len[object];
+    char header[8] = {0, 0, 0, 0, 0, 1, 0, 0};
+    char params[64];  // " <flags> <exptime> <bytes> noreply\r\n"
+    int params_len = snprintf(params, sizeof(params), " 0 %d %d noreply\r\n", object_exptime, value_len);
+    char prefix[WRITE_VERSION_LEN + 1];
+    write_version_prefix(prefix, version);
+    const int prefix_len = version != 0 ? WRITE_VERSION_LEN : 0;
+    struct iovec iov[7] = {
+        {header, 8},
+        {(void *)"set ", 4},
+        {(void *)object_key(object), (size_t)key_length},
+        {params, (size_t)params_len},
+        {prefix, (size_t)prefix_len},
+        {value_pool + value_pool_offset(object) + prefix_len, (size_t)(value_len - prefix_len)},
+        {(void *)"\r\n", 2}
+    };
+    if (lb_send(w, lb_caches[cache], iov, 7)) {
+        w->num_lookaside_sets++;
+    }
+}
+
+/* matches a complete response with its request, validates and records it (called by the receive threads) */
+void process_response(sender_worker *w, const udp_frame_header &header, const char *payload, size_t len, int64_t receive_time)
+{
+    uint16_t request_id = header.request_id;
+
+    uint32_t object;
+    int64_t request_time, intended_time;
+    uint32_t write, route;
+    bool reissued;
+    uint32_t state = request_table_read(w->requests, request_id, &object, &request_time, &intended_time, &write, &route, &reissued);
+    if (state == SLOT_FREE) {
+        counter_add(w->num_late_responses, 1);
+        return;
+    }
+    bool is_late = receive_time - request_time > (int64_t)REQUEST_TIMEOUT_MS * 1000000;
+    if (write != 0) {
+        if (is_late || request_table_claim(w->requests, request_id, state) != CLAIM_OK) {
+            counter_add(w->num_late_responses, 1);
+            return;
+        }
+        if (w->completions != nullptr) {
+            completion_queue_push(w->completions, request_id);
+        }
+        process_write_response(w, write, object, payload, len, request_time, receive_time);
+        return;
+    }
+
+    const char *response_key = nullptr;
+    size_t response_key_len = 0;
+    const char *value = nullptr;
+    size_t value_bytes = 0;
+    response_status status = parse_get_response(payload, len, &response_key, &response_key_len, &value, &value_bytes);
+    bool is_hit = (status == RESPONSE_HIT);
+
+    // the key ("VALUE <key>" or "END <key>") tells if this is a late response to an older request with the same request
+    // id. It is checked before the request is claimed, so the request stays pending for its own response
+    bool key_matches = response_key_len == 0 || (response_key_len == (size_t)key_length && memcmp(response_key, object_key(object), key_length) == 0);
+    if ((status != RESPONSE_INVALID && (!key_matches || is_late)) || request_table_claim(w->requests, request_id, state) != CLAIM_OK) {
+        counter_add(w->num_late_responses, 1);
+        return;
+    }
+
+    // client-side balancing: the route of the request is its letheinfo, a cache miss goes on to the database. A late
+    // response never gets here, its request stays pending and is taken off its cache when the request id is reused
+    uint8_t letheinfo = header.letheinfo & 0xFF;  // TODO: Add the upper byte if needed in the future
+    if (lb_strategy != 0) {
+        letheinfo = route | (reissued ? LETHEINFO_DB : 0);
+        if (!reissued) {
+            w->cache_outstanding[route >> LETHEINFO_CACHE_SHIFT].fetch_sub(1, std::memory_order_relaxed);
+        }
+        if (!reissued && status == RESPONSE_MISS && lb_fetch_from_database(w, request_id, object, route)) {
+            return;
+        }
+    }
+    // only the response of this request (matching key, in time) gets here, a late response to an older request with
+    // the same request id doesn't wake a virtual client that still waits for its own response
+    if (w->completions != nullptr) {
+        completion_queue_push(w->completions, request_id);  // the virtual client can send its next request
+    }
+
+    if (status == RESPONSE_INVALID || (is_hit && value_bytes != (size_t)w->objects->value_len[object])) {
+        counter_add(w->num_invalid_responses, 1);
+        return;
+    }
+    counter_add(w->num_value_bytes, value_bytes);
+
+    uint32_t response_time_us = (receive_time - request_time) / 1000;
+    uint32_t intended_response_time_us = (receive_time - intended_time) / 1000;
+
+    record_latency(w, letheinfo, is_hit, response_time_us, intended_response_time_us);
+    if (shift_mode != 0) {
+        record_shift_response(w, object, intended_time, receive_time, letheinfo, intended_response_time_us);
+    }
+    uint32_t version = is_hit && object_versions != nullptr ? value_version(value, value_bytes) : 0;
+    if (is_hit && object_versions != nullptr) {
+        check_stale_read(w, object, version, letheinfo, request_time, receive_time);
+    }
+    if (is_hit && reissued && lb_strategy != 0) {
+        lb_fill_cache(w, object, route >> LETHEINFO_CACHE_SHIFT, version);
+    }
+    if (timestamping_mode != 0) {
+        record_rx_timestamp(w, request_id, response_time_us);
+    }
+
+    if (record_mode == 1) {
+        result_log_record &record = w->log_chunk->records[w->log_chunk->len++];
+        record.timestamp_us = (receive_time - test_start_ns) / 1000;
+        record.response_time_us = response_time_us;
+        record.intended_response_time_us = intended_response_time_us;
+        record.request_id = request_id;
+        record.letheinfo = letheinfo;
+        record.flags = is_hit ? RESULT_FLAG_HIT : 0;
+        record.reserved = 0;
+        if (w->log_chunk->len == RESULT_LOG_CHUNK_RECORDS) {
+            result_log_submit(&results_log, w->log_chunk);
+            w->log_chunk = result_log_get_chunk(&results_log);
+        }
+    } else if (record_mode == 2) {
+        w->response_list.emplace_back(response_record{
+            .request_id = request_id,
+            .timestamp_us = (receive_time - test_start_ns) / 1000,
+            .response_time_us = response_time_us,
+            .letheinfo_hdr = letheinfo,
+            .is_hit = is_hit,
+            .intended_response_time_us = intended_response_time_us
+        });
+    }
+}
+
+/* drops responses whose datagrams didn't all arrive within REQUEST_TIMEOUT_MS */
+void purge_partial_responses(sender_worker *w, int64_t time_now)
+{
+    for (auto it = w->partial_responses.begin(); it != w->partial_responses.end();) {
+        if (time_now - it->second.first_ns > (int64_t)REQUEST_TIMEOUT_MS * 1000000) {
+            w->num_incomplete_responses++;
+            it = w->partial_responses.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+/* handles a received datagram: responses of one datagram are processed directly, the datagrams of longer responses
+ * are collected by request id until all of them arrived (in any order) */
+void process_datagram(sender_worker *w, const char *data, size_t len, bool truncated, int64_t receive_time)
+{
+    if (len < 8) {
+        return;  // wake-up datagram (see stop_receiving)
+    }
+
+    udp_frame_header header;
+    if (truncated || !parse_frame_header(data, len, header)) {
+        counter_add(w->num_invalid_responses, 1);
+        return;
+    }
+    w->num_datagrams++;
+    if (w->num_datagrams % 4096 == 0 && !w->partial_responses.empty()) {
+        purge_partial_responses(w, receive_time);
+    }
+
+    if (header.total == 1) {
+        process_response(w, header, data + 8, len - 8, receive_time);
+        return;
+    }
+
+    partial_response &partial = w->partial_responses[header.request_id];
+    if (partial.received == 0 || partial.total != header.total) {
+        if (partial.received != 0) {
+            w->num_incomplete_responses++;  // datagrams of a different response with the same request id
+        }
+        partial.total = header.total;
+        partial.received = 0;
+        partial.first_ns = receive_time;
+        partial.datagrams.assign(header.total, std::string());
+    }
+    if (partial.datagrams[header.sequence].empty()) {
+        partial.datagrams[header.sequence].assign(data + 8, len - 8);
+        partial.received++;
+    }
+    if (partial.received < partial.total) {
+        return;
+    }
+
+    w->reassembly_buffer.clear();
+    for (auto &datagram : partial.datagrams) {
+        w->reassembly_buffer += datagram;
+    }
+    w->partial_responses.erase(header.request_id);
+    w->num_multi_datagram_responses++;
+    process_response(w, header, w->reassembly_buffer.data(), w->reassembly_buffer.size(), receive_time);
+}
+
+/* task that receives requests from the Memcached server on the socket of a sender worker (run in a separate thread) */
+void receive_memc_response_task(sender_worker *w)
+{
+    ip::udp::endpoint sender_endpoint;
+    std::vector<char> recv_buf(RECV_DATAGRAM_SIZE);
+    while (receiving) {
+        boost::system::error_code err;
+        size_t len = w->socket->receive_from(buffer(recv_buf), sender_endpoint, 0, err);
+
+        auto receive_time = now_ns();
+
+        if (err && err != error::message_size) {
+            continue;
+        }
+
+        process_datagram(w, recv_buf.data(), len, err == error::message_size, receive_time);
+    }
+}
+
+/* receive_memc_response_task but receives up to batch_size responses per recvmmsg call.
+ * The receive time of every response is taken from the kernel (SO_TIMESTAMPNS), as all responses of
+ * a batch are processed at the same time */
+void receive_memc_response_batch_task(sender_worker *w)
+{
+    const int recv_len = RECV_DATAGRAM_SIZE;
+    const int control_len = CMSG_SPACE(sizeof(struct timespec));
+    int fd = w->socket->native_handle();
+
+    int enable = 1;
+    bool kernel_timestamps = setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable)) == 0;
+
+    // offset between the kernel timestamps (CLOCK_REALTIME) and now_ns()
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    int64_t clock_offset = (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec - now_ns();
+
+    std::vector<struct mmsghdr> msgs(batch_size);
+    std::vector<struct iovec> iov(batch_size);
+    std::vector<char> recv_bufs(batch_size * recv_len);
+    std::vector<char> control_bufs(batch_size * control_len);
+    for (int i = 0; i < batch_size; i++) {
+        iov[i].iov_base = &recv_bufs[i * recv_len];
+        iov[i].iov_len = recv_len;
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    while (receiving) {
+        for (int i = 0; i < batch_size; i++) {
+            msgs[i].msg_hdr.msg_control = &control_bufs[i * control_len];
+            msgs[i].msg_hdr.msg_controllen = control_len;
+        }
+
+        int n = recvmmsg(fd, msgs.data(), batch_size, MSG_WAITFORONE, nullptr);
+        auto receive_time = now_ns();
+        if (n <= 0) {
+            continue;
+        }
+
+        for (int i = 0; i < n; i++) {
+            int64_t packet_time = receive_time;
+            if (kernel_timestamps) {
+                for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msgs[i].msg_hdr); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msgs[i].msg_hdr, cmsg)) {
+                    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                        memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                        packet_time = (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec - clock_offset;
+                    }
+                }
+            }
+            process_datagram(w, &recv_bufs[i * recv_len], std::min<size_t>(msgs[i].msg_len, recv_len), msgs[i].msg_hdr.msg_flags & MSG_TRUNC, packet_time);
+        }
+    }
+}
+
+/* enables kernel (software) or NIC (hardware) transmit and receive timestamps on the socket of a worker.
+ * Hardware timestamps must be enabled on the NIC (SIOCSHWTSTAMP, e.g. with hwstamp_ctl), otherwise none are reported.
+ * The transmit timestamps are returned with the request (no SOF_TIMESTAMPING_OPT_TSONLY), which tells its request id */
+bool enable_timestamping(sender_worker *w)
+{
+    int flags = timestamping_mode == 2
+        ? SOF_TIMESTAMPING_TX_HARDWARE | SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE
+        : SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+    return setsockopt(w->socket->native_handle(), SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == 0;
+}
+
+/* kernel or NIC timestamp of a received message (SCM_TIMESTAMPING) in nanoseconds, 0 if it has none */
+inline int64_t scm_timestamp_ns(struct msghdr *msg)
+{
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPING) {
+            struct scm_timestamping timestamps;
+            memcpy(&timestamps, CMSG_DATA(cmsg), sizeof(timestamps));
+            const struct timespec &ts = timestamps.ts[timestamping_mode == 2 ? 2 : 0];  // raw hardware or software
+            return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+        }
+    }
+    return 0;
+}
+
+/* receive task of the timestamping mode: receives up to batch_size responses per recvmmsg with their kernel receive
+ * timestamp, and the transmit timestamps of the requests from the socket error queue. The userspace receive time is
+ * still taken after recvmmsg returns, so both response times can be compared */
+void receive_memc_response_timestamping_task(sender_worker *w)
+{
+    const int recv_len = RECV_DATAGRAM_SIZE;
+    const int control_len = 512;
+    int fd = w->socket->native_handle();
+
+    std::vector<struct mmsghdr> msgs(batch_size);
+    std::vector<struct iovec> iov(batch_size);
+    std::vector<char> recv_bufs(batch_size * recv_len);
+    std::vector<char> control_bufs(batch_size * control_len);
+    for (int i = 0; i < batch_size; i++) {
+        iov[i].iov_base = &recv_bufs[i * recv_len];
+        iov[i].iov_len = recv_len;
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    auto reset_control = [&]() {
+        for (int i = 0; i < batch_size; i++) {
+            msgs[i].msg_hdr.msg_control = &control_bufs[i * control_len];
+            msgs[i].msg_hdr.msg_controllen = control_len;
+        }
+    };
+
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;  // POLLERR (error queue not empty) is always reported
+    while (receiving) {
+        if (poll(&pfd, 1, 100) <= 0) {
+            continue;
+        }
+
+        // transmit timestamps come with the request as it was sent, the frame (and its request id) is at the end of the
+        // packet. SETs and DELETEs (--mix, --lb) don't end with a GET frame and have no kernel response time
+        if (pfd.revents & POLLERR) {
+            while (true) {
+                reset_control();
+                int n = recvmmsg(fd, msgs.data(), batch_size, MSG_ERRQUEUE | MSG_DONTWAIT, nullptr);
+                if (n <= 0) {
+                    break;
+                }
+                for (int i = 0; i < n; i++) {
+                    int64_t tx_ns = scm_timestamp_ns(&msgs[i].msg_hdr);
+                    size_t len = std::min<size_t>(msgs[i].msg_len, recv_len);
+                    if (tx_ns != 0 && len >= GET_FRAME_LEN) {
+                        const uint8_t *frame = (const uint8_t *)&recv_bufs[i * recv_len] + len - GET_FRAME_LEN;
+                        if (frame[2] != 0 || frame[3] != 0 || frame[4] != 0 || frame[5] != 1 || memcmp(frame + 8, "get ", 4) != 0) {
+                            continue;
+                        }
+                        record_tx_timestamp(w, frame[0] << 8 | frame[1], tx_ns);
+                    }
+                }
+            }
+        }
+
+        if (pfd.revents & POLLIN) {
+            reset_control();
+            int n = recvmmsg(fd, msgs.data(), batch_size, MSG_DONTWAIT, nullptr);
+            auto receive_time = now_ns();
+            for (int i = 0; i < n; i++) {
+                w->kernel_rx_ns = scm_timestamp_ns(&msgs[i].msg_hdr);
+                process_datagram(w, &recv_bufs[i * recv_len], std::min<size_t>(msgs[i].msg_len, recv_len), msgs[i].msg_hdr.msg_flags & MSG_TRUNC, receive_time);
+            }
+        }
+    }
+}
+
+/* arms the multishot receive of the io_uring backend: one datagram per completion, each in a provided buffer.
+ * The receive has to be armed again when a completion doesn't have IORING_CQE_F_MORE (e.g. all buffers were in use) */
+void uring_arm_recv(sender_worker *w)
+{
+    io_uring_sqe *sqe = uring_get_sqe(*w->ring);
+    if (sqe == nullptr) {
+        uring_enter(*w->ring, 0, -1);
+        sqe = uring_get_sqe(*w->ring);
+    }
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = w->socket->native_handle();
+    sqe->addr = (uint64_t)(uintptr_t)&w->recv_msg;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = w->recv_buffers->bgid;
+    sqe->user_data = URING_RECV_USER_DATA;
+}
+
+/* sets up the io_uring backend of a worker: a ring, URING_RECV_BUFFERS provided receive buffers, the messages of
+ * URING_ENTRIES requests in flight and the multishot receive. Returns false if io_uring isn't available */
+bool uring_setup_worker(sender_worker *w)
+{
+    uring *ring = new uring();
+    if (!uring_init(*ring, URING_ENTRIES, URING_ENTRIES * 4)) {
+        delete ring;
+        return false;
+    }
+    uring_buf_ring *buffers = new uring_buf_ring();
+    if (!uring_buf_ring_init(*ring, *buffers, 0, URING_RECV_BUFFERS, sizeof(io_uring_recvmsg_out) + RECV_DATAGRAM_SIZE)) {
+        uring_exit(*ring);
+        delete ring;
+        delete buffers;
+        return false;
+    }
+    w->ring = ring;
+    w->recv_buffers = buffers;
+    memset(&w->recv_msg, 0, sizeof(w->recv_msg));
+
+    w->send_slots.assign(URING_ENTRIES, uring_send_slot());
+    w->free_send_slots.clear();
+    w->queued_send_slots.clear();
+    for (int i = URING_ENTRIES - 1; i >= 0; i--) {
+        uring_send_slot &slot = w->send_slots[i];
+        slot.iov[0].iov_base = slot.header;
+        slot.iov[0].iov_len = 8;
+        slot.iov[1].iov_len = GET_FRAME_LEN - 8;
+        memset(&slot.msg, 0, sizeof(slot.msg));
+        slot.msg.msg_name = w->memc_remote->data();
+        slot.msg.msg_namelen = w->memc_remote->size();
+        slot.msg.msg_iov = slot.iov;
+        slot.msg.msg_iovlen = 2;
+        w->free_send_slots.push_back(i);
+    }
+
+    uring_arm_recv(w);
+    return true;
+}
+
+void uring_free_worker(sender_worker *w)
+{
+    uring_buf_ring_free(*w->recv_buffers);
+    uring_exit(*w->ring);
+    delete w->recv_buffers;
+    delete w->ring;
+}
+
+/* processes all completions of the ring of a worker: sent requests and received datagrams. Returns the number of datagrams */
+int uring_process_completions(sender_worker *w)
+{
+    uring &ring = *w->ring;
+    int num_received = 0;
+    bool rearm = false;
+    int64_t receive_time = 0;
+
+    io_uring_cqe *cqe;
+    while ((cqe = uring_peek_cqe(ring)) != nullptr) {
+        uint64_t user_data = cqe->user_data;
+        int res = cqe->res;
+        unsigned flags = cqe->flags;
+        uring_cqe_seen(ring);
+
+        if (user_data != URING_RECV_USER_DATA) {
+            uring_send_slot &slot = w->send_slots[user_data];
+            if (res < 0) {
+                request_table_release(w->requests, slot.request_id);
+            } else {
+                counter_add(w->num_requests, 1);
+                record_send_lag(w, slot.request_ns - slot.intended_ns);
+            }
+            w->free_send_slots.push_back(user_data);
+            continue;
+        }
+
+        if (!(flags & IORING_CQE_F_MORE)) {
+            rearm = true;
+        }
+        if (res < 0 || !(flags & IORING_CQE_F_BUFFER)) {
+            continue;
+        }
+
+        // the buffer holds an io_uring_recvmsg_out followed by the (empty) address and control data and the datagram
+        if (receive_time == 0) {
+            receive_time = now_ns();
+        }
+        uint16_t bid = flags >> IORING_CQE_BUFFER_SHIFT;
+        char *buf = uring_buf(*w->recv_buffers, bid);
+        const io_uring_recvmsg_out *out = (const io_uring_recvmsg_out *)buf;
+        size_t offset = sizeof(io_uring_recvmsg_out) + out->namelen + out->controllen;
+        size_t len = std::min<size_t>(out->payloadlen, res - offset);
+        process_datagram(w, buf + offset, len, out->flags & MSG_TRUNC, receive_time);
+        uring_buf_ring_add(*w->recv_buffers, bid);
+        num_received++;
+    }
+
+    if (num_received > 0) {
+        uring_buf_ring_commit(*w->recv_buffers);
+    }
+    if (rearm) {
+        uring_arm_recv(w);
+    }
+    return num_received;
+}
+
+/* submits the queued requests (and a new multishot receive if needed). The time of request is taken once, right
+ * before submitting, and stored in the request table for every request */
+void uring_submit_requests(sender_worker *w)
+{
+    uring &ring = *w->ring;
+    if (uring_pending(ring) == 0) {
+        return;
+    }
+
+    int64_t request_time = now_ns();
+    for (uint32_t index : w->queued_send_slots) {
+        uring_send_slot &slot = w->send_slots[index];
+        slot.request_ns = request_time;
+        if (request_table_store(w->requests, slot.request_id, slot.object, request_time, slot.intended_ns)) {
+            w->num_expired_requests++;
+        }
+    }
+    if (!w->queued_send_slots.empty()) {
+        w->num_batches++;
+        w->queued_send_slots.clear();
+    }
+
+    while (uring_pending(ring) > 0) {
+        int ret = uring_enter(ring, 0, -1);
+        if (ret < 0 && ret != -EINTR && ret != -EAGAIN && ret != -EBUSY) {
+            std::cout << "Error submitting to io_uring: " << strerror(-ret) << std::endl;
+            break;
+        }
+        if (ret <= 0) {
+            uring_process_completions(w);  // completion queue full, make room
+        }
+    }
+}
+
+/* queues a get request for object {object} in the io_uring backend, submitted when batch_size requests are queued,
+ * batch_timeout_us passed or the sender waits */
+void uring_queue_get_request(int object, sender_worker *w, int64_t intended_ns)
+{
+    int64_t time_now = now_ns();
+    while (w->free_send_slots.empty()) {
+        uring_submit_requests(w);
+        uring_enter(*w->ring, 1, 1000000);
+        uring_process_completions(w);
+    }
+    io_uring_sqe *sqe = uring_get_sqe(*w->ring);
+    if (sqe == nullptr) {
+        uring_submit_requests(w);
+        sqe = uring_get_sqe(*w->ring);
+    }
+
+    uint32_t index = w->free_send_slots.back();
+    w->free_send_slots.pop_back();
+    uring_send_slot &slot = w->send_slots[index];
+    slot.request_id = w->request_id++;
+    memcpy(slot.header, w->frame_header, 8);
+    slot.header[0] = (slot.request_id >> 8);
+    slot.header[1] = slot.request_id & 0xFF;
+    slot.iov[1].iov_base = get_frame(object) + 8;
+    slot.object = object;
+    slot.intended_ns = intended_ns;
+
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = w->socket->native_handle();
+    sqe->addr = (uint64_t)(uintptr_t)&slot.msg;
+    sqe->len = 1;
+    sqe->user_data = index;
+
+    if (w->queued_send_slots.empty()) {
+        w->batch_first_ns = time_now;
+    }
+    w->queued_send_slots.push_back(index);
+    if ((int)w->queued_send_slots.size() >= batch_size || time_now - w->batch_first_ns >= (int64_t)batch_timeout_us * 1000) {
+        uring_submit_requests(w);
+    }
+}
+
+/* waits until {time_ns} while processing the completions of the ring: sleeps in io_uring_enter until a completion
+ * arrives or until PACER_SPIN_US before {time_ns}, then spins. With {until_response}, returns after a datagram was received */
+void uring_wait_until(sender_worker *w, int64_t time_ns, bool until_response)
+{
+    uring_submit_requests(w);
+    while (true) {
+        int num_received = uring_process_completions(w);
+        if (until_response && num_received > 0) {
+            return;
+        }
+        int64_t remaining = time_ns - now_ns();
+        if (remaining <= 0) {
+            return;
+        }
+        if (remaining > PACER_SPIN_US * 1000) {
+            uring_enter(*w->ring, 1, remaining - PACER_SPIN_US * 1000);
+        } else {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        }
+    }
+}
+
+/* raw-frame mode: resolves the addresses of the frames on packet_interface and sums the GET frames of the objects.
+ * The destination MAC address is --dst-mac, the neighbour table entry of the server or zero on a loopback interface */
+bool packet_prepare(int count)
+{
+    bool loopback;
+    if (!packet_interface_addresses(packet_interface.c_str(), packet_addrs.src_mac, &packet_addrs.src_ip, &loopback)) {
+        std::cout << "Can't get the addresses of interface " << packet_interface << " (" << strerror(errno) << ")" << std::endl;
+        return false;
+    }
+    if (inet_pton(AF_INET, memc_host.c_str(), &packet_addrs.dst_ip) != 1) {
+        std::cout << "Raw-frame mode needs the IPv4 address of the server, not " << memc_host << std::endl;
+        return false;
+    }
+    if (!packet_dst_mac.empty()) {
+        packet_parse_mac(packet_dst_mac.c_str(), packet_addrs.dst_mac);
+    } else if (loopback) {
+        memset(packet_addrs.dst_mac, 0, 6);
+    } else if (!packet_lookup_neighbour(packet_addrs.dst_ip, packet_interface.c_str(), packet_addrs.dst_mac)) {
+        std::cout << "No neighbour table entry of " << memc_host << " on " << packet_interface << ", use --dst-mac" << std::endl;
+        return false;
+    }
+
+    packet_frame_sums.resize(count);
+    for (int i = 0; i < count; i++) {
+        packet_frame_sums[i] = packet_csum_add(0, get_frame(i) + 2, GET_FRAME_LEN - 2);
+    }
+    return true;
+}
+
+/* opens the packet socket of a worker and builds its frame header: the source port is the port of the worker's
+ * UDP socket, which drops everything it receives from now on (the responses are taken from the receive ring, but
+ * without a bound port the kernel would answer them with ICMP port unreachable) */
+bool packet_setup_worker(sender_worker *w)
+{
+    uint16_t src_port = w->socket->local_endpoint().port();
+    packet_ring *packet = new packet_ring();
+    if (!packet_ring_open(*packet, packet_interface.c_str(), PACKET_RING_FRAMES, PACKET_FRAME_SIZE, memc_uport, src_port)) {
+        delete packet;
+        return false;
+    }
+    packet_drop_all(w->socket->native_handle());
+    w->packet = packet;
+
+    uint16_t udp_len = 8 + GET_FRAME_LEN;
+    uint8_t *h = (uint8_t *)w->packet_header;
+    memcpy(h, packet_addrs.dst_mac, 6);
+    memcpy(h + 6, packet_addrs.src_mac, 6);
+    h[12] = 0x08;  // IPv4
+    h[13] = 0x00;
+
+    uint8_t *ip = h + 14;
+    memset(ip, 0, 20);
+    ip[0] = 0x45;  // version 4, 5 words
+    ip[2] = (20 + udp_len) >> 8;
+    ip[3] = (20 + udp_len) & 0xFF;
+    ip[6] = 0x40;  // don't fragment, so the identification can stay 0 and the header checksum is the same for all requests
+    ip[8] = 64;    // TTL
+    ip[9] = IPPROTO_UDP;
+    memcpy(ip + 12, &packet_addrs.src_ip, 4);
+    memcpy(ip + 16, &packet_addrs.dst_ip, 4);
+    uint16_t ip_csum = packet_csum_fold(packet_csum_add(0, ip, 20));
+    ip[10] = ip_csum >> 8;
+    ip[11] = ip_csum & 0xFF;
+
+    uint8_t *udp = ip + 20;
+    udp[0] = src_port >> 8;
+    udp[1] = src_port & 0xFF;
+    udp[2] = memc_uport >> 8;
+    udp[3] = memc_uport & 0xFF;
+    udp[4] = udp_len >> 8;
+    udp[5] = udp_len & 0xFF;
+    udp[6] = udp[7] = 0;
+
+    // pseudo header (addresses, protocol, UDP length) and UDP header
+    w->packet_udp_sum = packet_csum_add(packet_csum_add(0, ip + 12, 8), udp, 8) + IPPROTO_UDP + udp_len;
+    return true;
+}
+
+void packet_free_worker(sender_worker *w)
+{
+    packet_ring_close(*w->packet);
+    delete w->packet;
+}
+
+/* sends the queued frames and stores their requests in the request table. The time of request is taken once,
+ * right before sending */
+void packet_submit_requests(sender_worker *w)
+{
+    if (w->batch_len == 0) {
+        return;
+    }
+
+    int64_t request_time = now_ns();
+    for (int i = 0; i < w->batch_len; i++) {
+        uint16_t request_id = ((uint8_t)w->batch_headers[8 * i] << 8) | (uint8_t)w->batch_headers[8 * i + 1];
+        if (request_table_store(w->requests, request_id, w->batch_objects[i], request_time, w->batch_intended[i])) {
+            w->num_expired_requests++;
+        }
+    }
+
+    // frames that can't be sent now (EAGAIN, ENOBUFS) stay in the transmit ring and go out with the next send
+    if (packet_tx_kick(*w->packet) < 0 && errno != EAGAIN && errno != ENOBUFS && errno != EINTR) {
+        std::cout << "Error sending frames. Code: " << errno << std::endl;
+    }
+    for (int i = 0; i < w->batch_len; i++) {
+        record_send_lag(w, request_time - w->batch_intended[i]);
+    }
+    counter_add(w->num_requests, w->batch_len);
+    w->num_batches++;
+    w->batch_len = 0;
+}
+
+/* processes the frames in the receive ring of a worker. Returns the number of datagrams */
+int packet_process_frames(sender_worker *w)
+{
+    int num_received = 0;
+    int64_t receive_time = 0;
+    unsigned len, snaplen;
+    char *frame;
+    while ((frame = packet_rx_frame(*w->packet, &len, &snaplen)) != nullptr) {
+        if (receive_time == 0) {
+            receive_time = now_ns();
+        }
+        // the filter of the socket only passes unfragmented UDP datagrams from the server to the worker's port
+        size_t udp_offset = 14 + (frame[14] & 0x0F) * 4;
+        size_t offset = udp_offset + 8;
+        if (offset <= snaplen) {
+            size_t payload_len = (((uint8_t)frame[udp_offset + 4] << 8) | (uint8_t)frame[udp_offset + 5]) - 8;
+            bool truncated = offset + payload_len > snaplen;
+            process_datagram(w, frame + offset, truncated ? snaplen - offset : payload_len, truncated, receive_time);
+            num_received++;
+        }
+        packet_rx_release(*w->packet);
     }
-    return s;
+    return num_received;
 }
 
-/* generate {count} random objects and store them to {objects} */
-void generate_random_kvobjects(kv_object *objects, int count)
+/* queues a get request for object {object} as a complete frame in the transmit ring, sent when batch_size requests
+ * are queued, batch_timeout_us passed or the sender waits */
+void packet_queue_get_request(int object, sender_worker *w, int64_t intended_ns)
 {
-    std::random_device rd;
+    int64_t time_now = now_ns();
+    char *frame = packet_tx_frame(*w->packet);
+    while (frame == nullptr) {
+        // transmit ring full: send the queued frames (or the ones a previous send left) and wait for the driver
+        if (w->batch_len > 0) {
+            packet_submit_requests(w);
+        } else {
+            packet_tx_kick(*w->packet);
+        }
+        packet_process_frames(w);
+        frame = packet_tx_frame(*w->packet);
+    }
 
-    std::exponential_distribution<> rng(exp_dist_lambda);
-    std::mt19937 rng_gen(rd());
+    const uint16_t request_id = w->request_id++;
+    memcpy(frame, w->packet_header, PACKET_HEADER_LEN);
+    memcpy(frame + PACKET_HEADER_LEN, get_frame(object), GET_FRAME_LEN);
+    frame[PACKET_HEADER_LEN] = (request_id >> 8);
+    frame[PACKET_HEADER_LEN + 1] = request_id & 0xFF;
+    uint16_t udp_csum = packet_csum_fold(w->packet_udp_sum + packet_frame_sums[object] + request_id);
+    frame[PACKET_HEADER_LEN - 2] = udp_csum >> 8;
+    frame[PACKET_HEADER_LEN - 1] = udp_csum & 0xFF;
+    packet_tx_commit(*w->packet, PACKET_HEADER_LEN + GET_FRAME_LEN);
 
-    for (int i = 0; i < count; i++)
-    {
-        double rps = rng(rng_gen);
-        double irt = 1 / rps * 1000;
-        objects[i].key = gen_random_string(key_length);
-        objects[i].irt_ms = int(irt);
-        objects[i].value_len = value_size_min + rand() % (value_size_max - value_size_min);
+    if (w->batch_len == 0) {
+        w->batch_first_ns = time_now;
+    }
+    w->batch_headers[8 * w->batch_len] = frame[PACKET_HEADER_LEN];
+    w->batch_headers[8 * w->batch_len + 1] = frame[PACKET_HEADER_LEN + 1];
+    w->batch_objects[w->batch_len] = object;
+    w->batch_intended[w->batch_len] = intended_ns;
+    w->batch_len++;
+    if (w->batch_len == batch_size || time_now - w->batch_first_ns >= (int64_t)batch_timeout_us * 1000) {
+        packet_submit_requests(w);
     }
 }
 
-/* sort kv objects by irt ascending using bubblesort */
-void sort_objects_irt_asc(kv_object *objects, int count)
+/* waits until {time_ns} while processing the receive ring: sleeps in ppoll until a frame arrives or until
+ * PACER_SPIN_US before {time_ns}, then spins. With {until_response}, returns after a datagram was received */
+void packet_wait_until(sender_worker *w, int64_t time_ns, bool until_response)
 {
-    kv_object tmp;
-    for (int n = count; n > 1; n--)
-    {
-        for (int i = 0; i < n - 1; i++)
-        {
-            if (objects[i].irt_ms > objects[i + 1].irt_ms)
-            {
-                tmp = objects[i];
-                objects[i] = objects[i + 1];
-                objects[i + 1] = tmp;
-            }
+    packet_submit_requests(w);
+    while (true) {
+        int num_received = packet_process_frames(w);
+        if (until_response && num_received > 0) {
+            return;
+        }
+        int64_t remaining = time_ns - now_ns();
+        if (remaining <= 0) {
+            return;
+        }
+        if (remaining > PACER_SPIN_US * 1000) {
+            int64_t sleep_ns = remaining - PACER_SPIN_US * 1000;
+            struct pollfd pfd = {w->packet->fd, POLLIN, 0};
+            struct timespec timeout = {(time_t)(sleep_ns / 1000000000), (long)(sleep_ns % 1000000000)};
+            ppoll(&pfd, 1, &timeout, nullptr);
+        } else {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
         }
     }
 }
 
-/* sends a set request to Memcached via UDP - doesn't care about response */
-void do_udp_set_request(std::string skey, std::string svalue, int flags, int exptime, ip::udp::socket *socket, ip::udp::endpoint *receiver_endpoint)
+/* sender thread: sends the requests of the distribution. With the io_uring backend and in raw-frame mode, it also
+ * receives the responses and waits RESPONSE_DRAIN_MS for the outstanding ones after the last request */
+void sender_task(sender_worker *w)
 {
-    const char *key = skey.c_str();
-    const char *value = svalue.c_str();
-
-    char flagsc[4];
-    char exptimec[4];
-    char value_lenc[8];
+    if (w->ring != nullptr && !uring_enable(*w->ring)) {
+        std::cout << "Can't enable io_uring: " << strerror(errno) << std::endl;
+        return;
+    }
 
-    sprintf(flagsc, "%d", flags);
-    sprintf(exptimec, "%d", exptime);
-    sprintf(value_lenc, "%d", strlen(value));
+    if (distribution_type == 0) {
+        schedule_task(w);  // exponential static inter-request times
+    } else if (distribution_type == 1) {
+        zipf_task(w);      // Zipf popularity per object
+    } else if (distribution_type == 2) {
+        uniform_task(w);   // Uniform
+    } else {
+        trace_task(w);     // trace replay
+    }
+    w->send_end_ns = now_ns();
 
-    int req_len = 19 + strlen(key) + strlen(flagsc) + strlen(exptimec) + strlen(value_lenc) + strlen(value);
-    char *req = (char*)malloc(req_len);
-    char *pof = req;
+    if (w->ring != nullptr) {
+        uring_wait_until(w, w->send_end_ns + (int64_t)RESPONSE_DRAIN_MS * 1000000, false);
+    } else if (w->packet != nullptr) {
+        packet_wait_until(w, w->send_end_ns + (int64_t)RESPONSE_DRAIN_MS * 1000000, false);
+    }
+}
 
-    req[0] = 0;
-    req[1] = 0;
-    req[2] = 0;
-    req[3] = 0;
-    req[4] = 0;
-    req[5] = 1;
-    req[6] = 0;
-    req[7] = 0;
-    pof += 8;
+/* stops the receive threads: sends a datagram to every worker socket to wake up the blocking receive */
+void stop_receiving(std::vector<sender_worker *> &workers)
+{
+    receiving = false;
 
-    memcpy(pof, "set ", 4); pof += 4;
-    memcpy(pof, key, strlen(key)); pof += strlen(key);
-    memcpy(pof, " ", 1); pof += 1;
-    memcpy(pof, flagsc, strlen(flagsc)); pof += strlen(flagsc);
-    memcpy(pof, " ", 1); pof += 1;
-    memcpy(pof, exptimec, strlen(exptimec)); pof += strlen(exptimec);
-    memcpy(pof, " ", 1); pof += 1;
-    memcpy(pof, value_lenc, strlen(value_lenc)); pof += strlen(value_lenc);
-    memcpy(pof, "\r\n", 2); pof += 2;
-    memcpy(pof, value, strlen(value)); pof += strlen(value);
-    memcpy(pof, "\r\n", 2); pof += 2;
+    io_service io_service;
+    ip::udp::socket wake_socket(io_service, ip::udp::v4());
+    for (auto w : workers) {
+        boost::system::error_code err;
+        ip::udp::endpoint wake_endpoint(ip::address_v4::loopback(), w->socket->local_endpoint().port());
+        wake_socket.send_to(buffer("", 0), wake_endpoint, 0, err);
+    }
+}
 
-    boost::system::error_code err;
+/* totals of all workers at a point in time (see telemetry_task) */
+struct telemetry_snapshot
+{
+    int64_t time_ns;
+    uint64_t num_requests;
+    uint64_t num_late_responses;
+    uint64_t num_invalid_responses;
+    uint64_t num_value_bytes;
+    latency_histogram latency[NUM_LATENCY_CLASSES];
+};
 
-    socket->send_to(buffer(req, req_len), *receiver_endpoint, 0, err);
+// telemetry_task runs until telemetry_stop is set
+std::mutex telemetry_mutex;
+std::condition_variable telemetry_cv;
+bool telemetry_stop = false;
 
-    if (err.value() != 0) {
-        std::cout << "Error sending key " << key << ". Code: " << err.value() << std::endl;
+/* adds the counters and latency histograms of all workers to {snapshot} while the workers keep running */
+void take_telemetry_snapshot(const std::vector<sender_worker *> &workers, telemetry_snapshot *snapshot)
+{
+    snapshot->time_ns = now_ns();
+    snapshot->num_requests = 0;
+    snapshot->num_late_responses = 0;
+    snapshot->num_invalid_responses = 0;
+    snapshot->num_value_bytes = 0;
+    for (int c = 0; c < NUM_LATENCY_CLASSES; c++) {
+        hist_reset(snapshot->latency[c]);
+    }
+    for (auto w : workers) {
+        snapshot->num_requests += counter_read(w->num_requests);
+        snapshot->num_late_responses += counter_read(w->num_late_responses);
+        snapshot->num_invalid_responses += counter_read(w->num_invalid_responses);
+        snapshot->num_value_bytes += counter_read(w->num_value_bytes);
+        for (int c = 0; c < NUM_LATENCY_CLASSES; c++) {
+            hist_merge_live(snapshot->latency[c], w->latency[c]);
+        }
     }
 }
 
-/* write objects with random values to Memcached cache */
-void mc_fill_objects(ip::udp::socket *socket, ip::udp::endpoint *receiver_endpoint, kv_object *objects, int count)
+/* appends the HELP and TYPE lines of a metric in Prometheus text format */
+void append_metric_header(std::string &out, const char *name, const char *type, const char *help)
 {
-    for (int i = 0; i < count; i++)
-    {
-        auto object = objects[i];
-        auto value = gen_random_string(object.value_len);
-        //memcached_return_t rc = memcached_set(memc, object.key.c_str(), strlen(object.key.c_str()), value.c_str(), strlen(value.c_str()), (time_t)0, (uint32_t)0);
-        do_udp_set_request(object.key, value, 0, 0, socket, receiver_endpoint);
-        std::this_thread::sleep_for(std::chrono::microseconds(500));
-        if (i % (count / 100) == 0) {
-            std::cout << "\rFilling objects " << (i * 100 / count) << "%" << std::flush;
-        }
-    }
+    out += std::string("# HELP ") + name + " " + help + "\n# TYPE " + name + " " + type + "\n";
+}
+
+/* appends a sample "<name>{run_id="..",<labels>} <value>" */
+void append_metric(std::string &out, const char *name, const std::string &labels, double value)
+{
+    char line[256];
+    snprintf(line, sizeof(line), "%s{run_id=\"%d\"%s%s} %.17g\n", name, run_id, labels.empty() ? "" : ",", labels.c_str(), value);
+    out += line;
 }
 
-/* sends a get request to Memcached via UDP and stores the time of request in request_times (key=request_id) */
-void do_udp_get_request(std::string skey, ip::udp::socket *socket, ip::udp::endpoint *receiver_endpoint)
+/* writes the totals of {now} and the rates, ratios and response time percentiles of the interval since {before}
+ * to telemetry_file. The file is written under a temporary name and renamed, so readers never see a partial file */
+void write_telemetry(const telemetry_snapshot &now, const telemetry_snapshot &before)
 {
-    const char *key = skey.c_str();
-    const int key_len = skey.length();
+    double interval = std::max((now.time_ns - before.time_ns) / 1e9, 1e-9);
+    uint64_t requests = now.num_requests - before.num_requests;
+    uint64_t reads = now.latency[LAT_ALL].count - before.latency[LAT_ALL].count;
+    uint64_t writes = now.latency[LAT_SET].count + now.latency[LAT_DELETE].count - before.latency[LAT_SET].count - before.latency[LAT_DELETE].count;
+    uint64_t responses = reads + writes;
+    uint64_t hits = now.latency[LAT_HIT].count - before.latency[LAT_HIT].count;
+    std::string out;
 
-    int req_len = 14 + strlen(key);
-    char *req = (char*)malloc(req_len);
+    append_metric_header(out, "mclgs_elapsed_seconds", "gauge", "Time since the start of the test");
+    append_metric(out, "mclgs_elapsed_seconds", "", (now.time_ns - test_start_ns) / 1e9);
 
-    // Frame Header
-    req[0] = (request_id >> 8);
-    req[1] = request_id & 0xFF;
-    req[2] = 0;
-    req[3] = 0;
-    req[4] = 0;
-    req[5] = 1;
-    req[6] = 0;
-    req[7] = 0;
+    // totals since the start of the test
+    append_metric_header(out, "mclgs_requests_total", "counter", "Requests sent");
+    append_metric(out, "mclgs_requests_total", "", now.num_requests);
+    append_metric_header(out, "mclgs_responses_total", "counter", "Valid responses received");
+    append_metric(out, "mclgs_responses_total", "result=\"hit\"", now.latency[LAT_HIT].count);
+    append_metric(out, "mclgs_responses_total", "result=\"miss\"", now.latency[LAT_MISS].count);
+    if (object_versions != nullptr) {
+        append_metric(out, "mclgs_responses_total", "result=\"set\"", now.latency[LAT_SET].count);
+        append_metric(out, "mclgs_responses_total", "result=\"delete\"", now.latency[LAT_DELETE].count);
+        append_metric_header(out, "mclgs_stale_reads_total", "counter", "Hits that returned an older version than a write acknowledged before the GET was sent");
+        append_metric(out, "mclgs_stale_reads_total", "", now.latency[LAT_STALE].count);
+    }
+    append_metric_header(out, "mclgs_hits_by_hotness_total", "counter", "Hits by hotness of the object (letheinfo)");
+    for (int c = LAT_HOT; c <= LAT_COLD; c++) {
+        append_metric(out, "mclgs_hits_by_hotness_total", std::string("hotness=\"") + latency_class_names[c] + "\"", now.latency[c].count);
+    }
+    append_metric_header(out, "mclgs_hits_by_source_total", "counter", "Hits answered by a cache, by the database for a COLD object or by the database for a WARM/HOT object");
+    for (int c = LAT_CACHE; c <= LAT_DB_CACHE_MISS; c++) {
+        append_metric(out, "mclgs_hits_by_source_total", std::string("source=\"") + latency_class_names[c] + "\"", now.latency[c].count);
+    }
+    append_metric_header(out, "mclgs_responses_by_cache_total", "counter", "Responses by cache id (letheinfo)");
+    for (int i = 0; i < 8; i++) {
+        append_metric(out, "mclgs_responses_by_cache_total", "cache_id=\"" + std::to_string(i) + "\"", now.latency[LAT_CACHE_ID + i].count);
+    }
+    append_metric_header(out, "mclgs_late_responses_total", "counter", "Responses after the request timeout or to an unknown request id");
+    append_metric(out, "mclgs_late_responses_total", "", now.num_late_responses);
+    append_metric_header(out, "mclgs_invalid_responses_total", "counter", "Truncated or malformed responses or responses with a wrong value length");
+    append_metric(out, "mclgs_invalid_responses_total", "", now.num_invalid_responses);
+    append_metric_header(out, "mclgs_value_bytes_total", "counter", "Value bytes of all hits");
+    append_metric(out, "mclgs_value_bytes_total", "", now.num_value_bytes);
 
-    // GET
-    memcpy(req + 8, "get ", 4);
+    // last interval
+    append_metric_header(out, "mclgs_request_rate", "gauge", "Requests per second in the last interval");
+    append_metric(out, "mclgs_request_rate", "", requests / interval);
+    append_metric_header(out, "mclgs_response_rate", "gauge", "Responses per second in the last interval");
+    append_metric(out, "mclgs_response_rate", "", responses / interval);
+    append_metric_header(out, "mclgs_hit_ratio", "gauge", "Hits per GET response in the last interval");
+    append_metric(out, "mclgs_hit_ratio", "", reads ? (double)hits / reads : 0);
+    append_metric_header(out, "mclgs_loss_ratio", "gauge", "Requests without response per request in the last interval (responses to requests of the previous interval count for this one)");
+    append_metric(out, "mclgs_loss_ratio", "", requests > responses ? (double)(requests - responses) / requests : 0);
+    append_metric_header(out, "mclgs_goodput_bytes_per_second", "gauge", "Value bytes of hits per second in the last interval");
+    append_metric(out, "mclgs_goodput_bytes_per_second", "", (now.num_value_bytes - before.num_value_bytes) / interval);
+    append_metric_header(out, "mclgs_hit_rate_by_hotness", "gauge", "Hits per second by hotness in the last interval");
+    for (int c = LAT_HOT; c <= LAT_COLD; c++) {
+        append_metric(out, "mclgs_hit_rate_by_hotness", std::string("hotness=\"") + latency_class_names[c] + "\"", (now.latency[c].count - before.latency[c].count) / interval);
+    }
+    append_metric_header(out, "mclgs_hit_rate_by_source", "gauge", "Hits per second by source in the last interval");
+    for (int c = LAT_CACHE; c <= LAT_DB_CACHE_MISS; c++) {
+        append_metric(out, "mclgs_hit_rate_by_source", std::string("source=\"") + latency_class_names[c] + "\"", (now.latency[c].count - before.latency[c].count) / interval);
+    }
+    append_metric_header(out, "mclgs_response_rate_by_cache", "gauge", "Responses per second by cache id in the last interval");
+    for (int i = 0; i < 8; i++) {
+        append_metric(out, "mclgs_response_rate_by_cache", "cache_id=\"" + std::to_string(i) + "\"", (now.latency[LAT_CACHE_ID + i].count - before.latency[LAT_CACHE_ID + i].count) / interval);
+    }
 
-    memcpy(req + 12, key, key_len);                 //memcpy(req + 12, key, strlen(key));
-    memcpy(req + 12 + key_len, "\r\n", 2);          //memcpy(req + 12 + strlen(key), "\r\n", 2);
+    // response time percentiles of the last interval, from the actual and from the intended time of request
+    static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+    append_metric_header(out, "mclgs_response_time_us", "gauge", "Response time percentiles in microseconds in the last interval");
+    for (int c : {LAT_ALL, LAT_INTENDED, LAT_KERNEL, LAT_HIT, LAT_MISS, LAT_SET, LAT_DELETE}) {
+        latency_histogram interval_latency;
+        hist_delta(interval_latency, now.latency[c], before.latency[c]);
+        for (double q : quantiles) {
+            char labels[64];
+            snprintf(labels, sizeof(labels), "class=\"%s\",quantile=\"%g\"", latency_class_names[c], q);
+            append_metric(out, "mclgs_response_time_us", labels, hist_percentile(interval_latency, q * 100));
+        }
+    }
 
-    boost::system::error_code err;
+    std::string tmp_file = telemetry_file + ".tmp";
+    FILE *f = fopen(tmp_file.c_str(), "w");
+    if (f == nullptr) {
+        return;
+    }
+    fwrite(out.data(), 1, out.size(), f);
+    fclose(f);
+    rename(tmp_file.c_str(), telemetry_file.c_str());
+}
 
-    auto request_time = std::chrono::high_resolution_clock::now();
-    socket->send_to(buffer(req, req_len), *receiver_endpoint, 0, err);
+/* telemetry thread: every telemetry_interval_ms, takes a snapshot of all workers and writes it to telemetry_file.
+ * The workers are never blocked, the snapshot only reads their counters and histograms */
+void telemetry_task(const std::vector<sender_worker *> *workers)
+{
+    telemetry_snapshot *before = new telemetry_snapshot();
+    telemetry_snapshot *now = new telemetry_snapshot();
+    take_telemetry_snapshot(*workers, before);
 
-    if (err.value() == 0 /* success */) {
-        // ToDo: Maybe use key (or key+request_id) instead of just request_id ???
-        rtm.lock();
-        request_times.insert(std::pair<uint16_t, std::chrono::time_point<std::chrono::high_resolution_clock>>(request_id, request_time));
-        rtm.unlock();
+    std::unique_lock<std::mutex> lock(telemetry_mutex);
+    auto next = std::chrono::steady_clock::now();
+    bool stop = false;
+    while (!stop) {
+        next += std::chrono::milliseconds(telemetry_interval_ms);
+        stop = telemetry_cv.wait_until(lock, next, [] { return telemetry_stop; });
 
-        request_id++;
-        num_requests++;
+        take_telemetry_snapshot(*workers, now);
+        write_telemetry(*now, *before);
+        std::swap(now, before);
     }
+
+    delete before;
+    delete now;
 }
 
-/* task that schedules and creates requests to the Memcached server */
-void schedule_task(kv_object *objects, int count, ip::udp::socket *socket, ip::udp::endpoint *memc_remote)
+/* runs the test with {num_sender_threads} sender threads and merges their results into response_list/num_requests */
+void run_sender_workers(io_service &io_service, object_store *objects, int count)
 {
-    int64_t test_time_remaining = 0;  // used for priting the remaining time
+    std::vector<sender_worker *> workers;
+    boost::thread_group receive_threads;
+    boost::thread_group send_threads;
 
-    auto time_now = std::chrono::high_resolution_clock::now();
-    auto end_time = time_now + std::chrono::seconds(test_duration_seconds);
-    std::chrono::time_point<std::chrono::high_resolution_clock> sleep_until;
+    if (distribution_type == 1) {
+        prepare_zipf_distribution(count);
+    }
+    if (shift_mode != 0) {
+        prepare_popularity_shifts();
+    }
+    if (io_backend == 2 && !packet_prepare(count)) {
+        std::cout << "Raw frames not available, using blocking sockets" << std::endl;
+        io_backend = 0;
+    }
 
-    while (time_now < end_time)
-    {
-        time_now = std::chrono::high_resolution_clock::now();
-        sleep_until = time_now + std::chrono::milliseconds(1000);
+    // request rate of the schedule: every object at its inter-request time, or the request limit over the test duration
+    if (distribution_type == 0) {
+        target_request_rate = 0;
+        for (int i = 0; i < count; i++) {
+            target_request_rate += 1000.0 / std::max(objects->irt_ms[i], 1);
+        }
+    } else if (num_clients > 0) {
+        target_request_rate = 0;  // closed loop: the request rate is the one the server sustains
+    } else if (distribution_type == 3) {
+        target_request_rate = trace_span_ns > 0 ? trace_num_requests / (trace_span_ns / trace_speed / 1e9) : 0;
+    } else {
+        target_request_rate = (double)total_request_limit / test_duration_seconds;
+    }
 
-        for (int i = 0; i < count; i++)
-        {
-            if (objects[i].next_call <= time_now)
-            {
-                do_udp_get_request(objects[i].key, socket, memc_remote);
-
-                objects[i].next_call = time_now + std::chrono::milliseconds(objects[i].irt_ms);
-                if (objects[i].next_call < sleep_until)
-                {
-                    sleep_until = objects[i].next_call;
-                }
+    std::string log_file_name = "test/mclgs_results" + std::to_string(run_id) + ".bin";
+    if (record_mode == 1 && !result_log_open(&results_log, log_file_name.c_str(), run_id)) {
+        std::cout << "Can't create " << log_file_name << ", responses are not recorded" << std::endl;
+        record_mode = 0;
+    }
+
+    for (int t = 0; t < num_sender_threads; t++) {
+        sender_worker *w = new sender_worker();
+        w->id = t;
+        w->objects = objects;
+        w->count = count;
+        w->first_object = (int)((int64_t)count * t / num_sender_threads);
+        w->last_object = (int)((int64_t)count * (t + 1) / num_sender_threads);
+        w->total_no_requests = total_request_limit / num_sender_threads + (t < total_request_limit % num_sender_threads ? 1 : 0);
+        w->socket = new ip::udp::socket(io_service);
+        w->memc_remote = new ip::udp::endpoint(ip::address::from_string(memc_host), memc_uport);
+        w->socket->open(ip::udp::v4());
+        w->socket->bind(ip::udp::endpoint(ip::udp::v4(), 0));
+        w->request_id = 0;
+        memcpy(w->frame_header, get_frame(0), 8);
+        w->num_requests = 0;
+        w->sum_send_lag_ns = 0;
+        w->max_send_lag_ns = 0;
+        w->requests = new request_table();
+        w->num_late_responses = 0;
+        w->num_expired_requests = 0;
+        w->num_clients = num_clients / num_sender_threads + (t < num_clients % num_sender_threads ? 1 : 0);
+        w->max_outstanding = max_outstanding > 0 ? max_outstanding / num_sender_threads + (t < max_outstanding % num_sender_threads ? 1 : 0) : w->num_clients;
+        w->completions = num_clients > 0 ? new completion_queue() : nullptr;
+        w->num_client_timeouts = 0;
+        w->num_datagrams = 0;
+        w->num_invalid_responses = 0;
+        w->num_incomplete_responses = 0;
+        w->num_multi_datagram_responses = 0;
+        w->num_value_bytes = 0;
+        w->kernel_rx_ns = 0;
+        w->num_tx_timestamps = 0;
+        w->mix_state = derived_seed("mix", w->id);
+        w->num_sets = 0;
+        w->num_deletes = 0;
+        w->num_write_failures = 0;
+        w->num_stale_cache_reads = 0;
+        w->lb_state = derived_seed("lb", w->id);
+        for (int i = 0; i < LB_MAX_CACHES; i++) {
+            w->cache_outstanding[i].store(0, std::memory_order_relaxed);
+            w->cache_requests[i] = 0;
+        }
+        w->num_invalidations = 0;
+        w->num_db_fetches = 0;
+        w->num_lookaside_sets = 0;
+        w->hotkeys = nullptr;
+        w->hotkeys_update_ns = 0;
+        if (lb_strategy == 3) {
+            w->hotkeys = new hotkey_tracker();
+            hotkey_init(*w->hotkeys, count, lb_topk_capacity, lb_hot_keys);
+        }
+        if (shift_mode != 0) {
+            w->shift_classified_ns.assign(shift_hot_objects.size(), INT64_MAX);
+            w->shift_bins.assign((size_t)test_duration_seconds * 1000 / SHIFT_BIN_MS + 1, shift_bin{0, 0, 0});
+        }
+        if (timestamping_mode != 0) {
+            w->timestamps.assign(REQUEST_TABLE_SIZE, timestamp_slot{0, 0, 0});
+            if (!enable_timestamping(w)) {
+                std::cout << "Can't enable SO_TIMESTAMPING (" << strerror(errno) << "), no kernel timestamps" << std::endl;
+                timestamping_mode = 0;
             }
         }
-
-        if (std::chrono::duration_cast<std::chrono::seconds>(end_time - time_now).count() != test_time_remaining) {
-            test_time_remaining = std::chrono::duration_cast<std::chrono::seconds>(end_time - time_now).count();
-            std::cout << "\rRemaining time: " << test_time_remaining << "s" << std::flush;
+        w->latency = new latency_histogram[NUM_LATENCY_CLASSES];
+        for (int c = 0; c < NUM_LATENCY_CLASSES; c++) {
+            hist_reset(w->latency[c]);
         }
+        w->log_chunk = record_mode == 1 ? result_log_get_chunk(&results_log) : nullptr;
+        init_send_batch(w);
+        w->ring = nullptr;
+        w->send_end_ns = 0;
+        if (io_backend == 1 && !uring_setup_worker(w)) {
+            std::cout << "Can't set up io_uring (" << strerror(errno) << "), using blocking sockets" << std::endl;
+            io_backend = 0;
+        }
+        w->packet = nullptr;
+        if (io_backend == 2 && !packet_setup_worker(w)) {
+            std::cout << "Can't open a packet socket on " << packet_interface << " (" << strerror(errno) << "), using blocking sockets" << std::endl;
+            io_backend = 0;
+        }
+        workers.push_back(w);
+    }
 
-        //std::this_thread::sleep_until(sleep_until);  // may make the request bursty
+    // receive responses on separate threads, one per socket (with io_uring and raw frames, the sender thread receives them)
+    receiving = true;
+    for (auto w : workers) {
+        if (w->ring != nullptr || w->packet != nullptr) {
+            continue;
+        } else if (timestamping_mode != 0) {
+            receive_threads.create_thread(boost::bind(receive_memc_response_timestamping_task, w));
+        } else if (batch_size > 1) {
+            receive_threads.create_thread(boost::bind(receive_memc_response_batch_task, w));
+        } else {
+            receive_threads.create_thread(boost::bind(receive_memc_response_task, w));
+        }
     }
-}
 
-/* schedule_task but for Zipf distribution */
-void zipf_task(kv_object *objects, int count, ip::udp::socket *socket, ip::udp::endpoint *memc_remote, int total_no_requests)
-{
-    //double alpha = 0.99;
-    std::vector<double> zipf_dist(count);
-    std::vector<double> zipf_dist_new(count-1);
-    double zipf_norm = 0.0;
-    for (int i = 1; i<= count; i++) {
-        zipf_dist[i-1] = 1.0 / pow(i, alpha);
-        zipf_norm += zipf_dist[i-1];
+    test_start_time = std::chrono::high_resolution_clock::now();
+    test_start_ns = now_ns();
+
+    std::thread telemetry_thread;
+    if (!telemetry_file.empty()) {
+        telemetry_stop = false;
+        telemetry_thread = std::thread(telemetry_task, &workers);
     }
 
-    for (int i = 0; i < count; i++) {
-        zipf_dist[i] /= zipf_norm;
+    for (auto w : workers) {
+        send_threads.create_thread(boost::bind(sender_task, w));
     }
-    //double zipf_dist_new[count-1];
-    for (int i = 0; i < count-1; i++) {
-        zipf_dist_new[i] = zipf_dist[i];
-        std::cout<<"New ZIPF Dist = "<< zipf_dist_new[i]<<std::endl;
+    send_threads.join_all();
+    int64_t send_end_ns = test_start_ns;
+    for (auto w : workers) {
+        send_end_ns = std::max(send_end_ns, w->send_end_ns);
     }
+    send_duration_seconds = (send_end_ns - test_start_ns) / 1e9;
 
-    int64_t test_time_remaining = 0;  // used for priting the remaining time
-
-    auto time_now = std::chrono::high_resolution_clock::now();
-    auto end_time = time_now + std::chrono::seconds(test_duration_seconds);
-    int counter_objects[count-1] = {0};
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::discrete_distribution<int> d(zipf_dist_new.begin(), zipf_dist_new.end());
+    // wait for late responses, then stop receiving
+    if (receive_threads.size() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(RESPONSE_DRAIN_MS));
+        stop_receiving(workers);
+        receive_threads.join_all();
+    }
 
-    auto start_time = std::chrono::high_resolution_clock::now();
-    double RequestPerSec = total_no_requests / test_duration_seconds;
-    double RequestInterval = 1.0 / RequestPerSec;
-    double counter_sum = 0;
-    for (int i = 0; i < total_no_requests; i++) {
+    // last telemetry update with the drained responses
+    if (telemetry_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(telemetry_mutex);
+            telemetry_stop = true;
+        }
+        telemetry_cv.notify_one();
+        telemetry_thread.join();
+    }
 
-        time_now = std::chrono::high_resolution_clock::now();
-        int k = d(gen);
-        counter_objects[k] += 1;
-        do_udp_get_request(objects[k].key, socket, memc_remote);
-        auto elapsed_time = std::chrono::high_resolution_clock::now() - start_time;
-        double time_since_start = std::chrono::duration<double>(elapsed_time).count();
-        double next_request_time = (i+1) * RequestInterval;
-        double sleep_time = next_request_time - time_since_start;
-        if (std::chrono::duration_cast<std::chrono::seconds>(end_time - time_now).count() != test_time_remaining) {
-            test_time_remaining = std::chrono::duration_cast<std::chrono::seconds>(end_time - time_now).count();
-            std::cout << "\rRemaining time: " << test_time_remaining << "s" << std::flush;
+    if (record_mode == 1) {
+        for (auto w : workers) {
+            result_log_submit(&results_log, w->log_chunk);
         }
+        result_log_close(&results_log);
+        std::cout << "\nWrote " << results_log.num_records << " responses to " << log_file_name << std::endl;
+    }
 
-        if (sleep_time > 0) {
-            std::this_thread::sleep_for(std::chrono::duration<double>(sleep_time));
+    // merge the results of all workers
+    uint32_t counter_ranks[ZIPF_PRINT_RANKS] = {0};
+    for (int c = 0; c < NUM_LATENCY_CLASSES; c++) {
+        hist_reset(latency[c]);
+    }
+    shift_classified_ns.assign(shift_hot_objects.size(), INT64_MAX);
+    shift_bins.assign(workers[0]->shift_bins.size(), shift_bin{0, 0, 0});
+    for (auto w : workers) {
+        num_requests += w->num_requests;
+        num_late_responses += w->num_late_responses;
+        num_batches += w->num_batches;
+        num_expired_requests += w->num_expired_requests;
+        num_client_timeouts += w->num_client_timeouts;
+        num_tx_timestamps += w->num_tx_timestamps;
+        num_invalid_responses += w->num_invalid_responses;
+        num_incomplete_responses += w->num_incomplete_responses + w->partial_responses.size();
+        num_multi_datagram_responses += w->num_multi_datagram_responses;
+        num_value_bytes += w->num_value_bytes;
+        num_sets += w->num_sets;
+        num_deletes += w->num_deletes;
+        num_write_failures += w->num_write_failures;
+        num_stale_cache_reads += w->num_stale_cache_reads;
+        for (int i = 0; i < LB_MAX_CACHES; i++) {
+            lb_cache_requests[i] += w->cache_requests[i];
         }
+        num_db_fetches += w->num_db_fetches;
+        num_lookaside_sets += w->num_lookaside_sets;
+        num_invalidations += w->num_invalidations;
+        sum_send_lag_ns += w->sum_send_lag_ns;
+        max_send_lag_ns = std::max(max_send_lag_ns, w->max_send_lag_ns);
+        response_list.insert(response_list.end(), w->response_list.begin(), w->response_list.end());
+        for (int c = 0; c < NUM_LATENCY_CLASSES; c++) {
+            hist_merge(latency[c], w->latency[c]);
+        }
+        for (int i = 0; i < ZIPF_PRINT_RANKS; i++) {
+            counter_ranks[i] += w->counter_ranks[i];
+        }
+        for (size_t i = 0; i < w->shift_classified_ns.size(); i++) {
+            shift_classified_ns[i] = std::min(shift_classified_ns[i], w->shift_classified_ns[i]);
+        }
+        for (size_t i = 0; i < w->shift_bins.size(); i++) {
+            shift_bins[i].count += w->shift_bins[i].count;
+            shift_bins[i].db_responses += w->shift_bins[i].db_responses;
+            shift_bins[i].sum_us += w->shift_bins[i].sum_us;
+        }
+        if (w->ring != nullptr) {
+            uring_free_worker(w);
+        }
+        if (w->packet != nullptr) {
+            packet_free_worker(w);
+        }
+        w->socket->close();
+        delete w->socket;
+        delete w->memc_remote;
+        delete w->requests;
+        delete w->completions;
+        delete w->hotkeys;
+        delete[] w->latency;
+        delete w;
     }
+    std::sort(response_list.begin(), response_list.end(), [](const response_record &a, const response_record &b) {
+        return a.timestamp_us < b.timestamp_us;
+    });
 
-    // To print the frequency of objects sent
-    for (int i = 0; i < count-1; i++) {
-        std::cout << counter_objects[i] << " ";
-        counter_sum += counter_objects[i];
+    // To print the frequency of the most popular objects sent
+    if (distribution_type == 1) {
+        double counter_sum = 0;
+        std::cout << "\nRequests of the " << ZIPF_PRINT_RANKS << " most popular objects: ";
+        for (int i = 0; i < ZIPF_PRINT_RANKS; i++) {
+            std::cout << counter_ranks[i] << " ";
+            counter_sum += counter_ranks[i];
+        }
+        std::cout << "Counter Sum = "<< counter_sum;
+        std::cout << std::endl;
     }
-    std::cout << "Counter Sum = "<< counter_sum;
-    std::cout << std::endl;
 }
 
-/* schedule_task but for Uniform distribution */
-void uniform_task(kv_object *objects, int count, ip::udp::socket *socket, ip::udp::endpoint *memc_remote, int total_no_requests)
+/* resets the merged results of run_sender_workers, e.g. before the next step of a ramp */
+void reset_results()
 {
-    int64_t test_time_remaining = 0;  // used for priting the remaining time
+    num_requests = 0;
+    sum_send_lag_ns = 0;
+    max_send_lag_ns = 0;
+    num_batches = 0;
+    num_late_responses = 0;
+    num_expired_requests = 0;
+    num_invalid_responses = 0;
+    num_incomplete_responses = 0;
+    num_multi_datagram_responses = 0;
+    num_value_bytes = 0;
+    num_client_timeouts = 0;
+    num_tx_timestamps = 0;
+    num_sets = 0;
+    num_deletes = 0;
+    num_write_failures = 0;
+    num_stale_cache_reads = 0;
+    std::fill(lb_cache_requests, lb_cache_requests + LB_MAX_CACHES, 0);
+    num_db_fetches = 0;
+    num_lookaside_sets = 0;
+    num_invalidations = 0;
+    response_list.clear();
+}
+
+/* result of a step of the ramp mode */
+struct ramp_step
+{
+    double target_rps;
+    double send_rps;
+    double response_rps;
+    double loss_percent;
+    uint32_t p50_us;   // response times from the intended time of request
+    uint32_t p99_us;
+    uint32_t p999_us;
+    const char *result;  // "ok" or the threshold that was broken: "p99", "loss", "send_rate"
+};
 
-    auto time_now = std::chrono::high_resolution_clock::now();
-    auto end_time = time_now + std::chrono::seconds(test_duration_seconds);
+std::vector<ramp_step> ramp_steps;
+double max_sustainable_rps = 0;  // request rate of the last sustainable step of the ramp
 
-    auto start_time = std::chrono::high_resolution_clock::now();
-    double RequestPerSec = total_no_requests / test_duration_seconds;
-    double RequestInterval = 1.0 / RequestPerSec;
-    double counter_sum = 0;
-    for (int i = 0; i < total_no_requests; i++) {
+/* ramp mode: runs the test in steps of test_duration_seconds with a request rate increasing by ramp_step_rps, until
+ * the p99 response time from the intended time of request exceeds slo_p99_us, more than max_loss_percent of the
+ * requests are lost or the sender can't keep up with the rate. The response times from the intended time are used,
+ * as they include the time requests waited in the sender (coordinated omission) */
+void run_ramp(io_service &io_service, object_store *objects, int count)
+{
+    for (int n = 0; n < RAMP_MAX_STEPS; n++) {
+        int rate = ramp_start_rps + n * ramp_step_rps;
+        total_request_limit = rate * test_duration_seconds;
+        std::cout << "\nRamp step " << n + 1 << ": " << rate << " requests/s for " << test_duration_seconds << "s" << std::endl;
 
-        time_now = std::chrono::high_resolution_clock::now();
-        int k = rand() % (count - 1);
-        do_udp_get_request(objects[k].key, socket, memc_remote);
-        auto elapsed_time = std::chrono::high_resolution_clock::now() - start_time;
-        double time_since_start = std::chrono::duration<double>(elapsed_time).count();
-        double next_request_time = (i+1) * RequestInterval;
-        double sleep_time = next_request_time - time_since_start;
-        if (std::chrono::duration_cast<std::chrono::seconds>(end_time - time_now).count() != test_time_remaining) {
-            test_time_remaining = std::chrono::duration_cast<std::chrono::seconds>(end_time - time_now).count();
-            std::cout << "\rRemaining time: " << test_time_remaining << "s" << std::flush;
+        reset_results();
+        run_sender_workers(io_service, objects, count);
+
+        uint32_t num_responses_received = latency[LAT_ALL].count + latency[LAT_SET].count + latency[LAT_DELETE].count;
+        ramp_step step;
+        step.target_rps = rate;
+        step.send_rps = num_requests / send_duration_seconds;
+        step.response_rps = num_responses_received / send_duration_seconds;
+        step.loss_percent = num_requests ? 100.0 * (num_requests - num_responses_received) / num_requests : 100.0;
+        step.p50_us = hist_percentile(latency[LAT_INTENDED], 50);
+        step.p99_us = hist_percentile(latency[LAT_INTENDED], 99);
+        step.p999_us = hist_percentile(latency[LAT_INTENDED], 99.9);
+        if (step.send_rps < rate * RAMP_MIN_SEND_PERCENT / 100.0) {
+            step.result = "send_rate";
+        } else if (step.loss_percent > max_loss_percent) {
+            step.result = "loss";
+        } else if (step.p99_us > (uint32_t)slo_p99_us) {
+            step.result = "p99";
+        } else {
+            step.result = "ok";
         }
+        ramp_steps.push_back(step);
 
-        if (sleep_time > 0) {
-            std::this_thread::sleep_for(std::chrono::duration<double>(sleep_time));
+        std::cout << "\rSent " << step.send_rps << " requests/s, received " << step.response_rps << " responses/s, lost " << step.loss_percent << "% - ";
+        std::cout << "p50 " << step.p50_us << "us, p99 " << step.p99_us << "us, p99.9 " << step.p999_us << "us - " << step.result << std::endl;
+
+        if (strcmp(step.result, "ok") != 0) {
+            break;
         }
+        max_sustainable_rps = rate;
     }
 }
 
-/* task that receives requests from the Memcached server (run in a separate thread) */
-void receive_memc_response_task(ip::udp::socket *socket, ip::udp::endpoint *memc_remote)
+/* print the latency curve of the ramp and the highest sustainable request rate to stdout */
+void print_ramp_results()
 {
-    auto start_time = std::chrono::high_resolution_clock::now();
-    while (true) {
-        const auto a = 8+6+key_length; // frame header + "VALUE " + key
-        boost::array<char, a> recv_buf;
-        size_t len = socket->receive_from(buffer(recv_buf), *memc_remote);
+    std::string steps_json;
+    std::cout << "\n ===== Ramp results =====" << std::endl;
+    std::cout << "Response times from the intended time of request (us). SLO: p99 <= " << slo_p99_us << "us, loss <= " << max_loss_percent << "%" << std::endl;
+    std::cout << "  target/s      sent/s  responses/s   loss %      p50      p99    p99.9  result" << std::endl;
+    for (const ramp_step &step : ramp_steps) {
+        char line[256];
+        sprintf(line, "%10.0f  %10.0f   %10.0f  %7.3f %8u %8u %8u  %s", step.target_rps, step.send_rps, step.response_rps,
+            step.loss_percent, step.p50_us, step.p99_us, step.p999_us, step.result);
+        std::cout << line << std::endl;
+
+        sprintf(line, "%s{\"target_rps\": %f, \"send_rate_rps\": %f, \"response_rate_rps\": %f, \"loss_percent\": %f, \"p50_us\": %u, \"p99_us\": %u, \"p999_us\": %u, \"result\": \"%s\"}",
+            steps_json.empty() ? "" : ", ", step.target_rps, step.send_rps, step.response_rps, step.loss_percent, step.p50_us, step.p99_us, step.p999_us, step.result);
+        steps_json += line;
+    }
+    std::cout << "Highest sustainable request rate: " << max_sustainable_rps << " requests/s" << std::endl;
 
-        auto receive_time = std::chrono::high_resolution_clock::now();
+    std::string str(512 + steps_json.size(), '\0');
+    int len = snprintf(&str[0], str.size(), "{\"testprogram\": \"mcloadgen_static\", \"num_objects\": %d, \"seed\": %lu, \"num_sender_threads\": %d, \"batch_size\": %d, \"step_duration\": %d, \"slo_p99_us\": %d, \"max_loss_percent\": %f, \"max_sustainable_rps\": %f, \"ramp_steps\": [%s]}",
+        num_objects, object_seed, num_sender_threads, batch_size, test_duration_seconds, slo_p99_us, max_loss_percent, max_sustainable_rps, steps_json.c_str());
+    str.resize(len);
+    std::cout << "COMPUTER_READABLE: " << str << std::endl;
+}
 
-        char *data = recv_buf.data();
+/* popularity shifts: responses of the bins [{begin_ns}, {end_ns}) of intended time of request (at least one bin) */
+shift_bin sum_shift_bins(int64_t begin_ns, int64_t end_ns)
+{
+    const int64_t bin_ns = (int64_t)SHIFT_BIN_MS * 1000000;
+    size_t first = begin_ns / bin_ns;
+    size_t last = std::max((size_t)((end_ns + bin_ns - 1) / bin_ns), first + 1);
+    shift_bin sum = {0, 0, 0};
+    for (size_t i = first; i < last && i < shift_bins.size(); i++) {
+        sum.count += shift_bins[i].count;
+        sum.db_responses += shift_bins[i].db_responses;
+        sum.sum_us += shift_bins[i].sum_us;
+    }
+    return sum;
+}
 
-        uint16_t request_id = (data[0] << 8) + (uint8_t)data[1];  // use bitwise or instead of +
-        bool is_hit = (data[8] == 'V');  // cache response starts with "VALUE" if hit, else with "END"
+/* print the reclassification of every popularity shift: the time until 50% and SHIFT_CLASSIFIED_PERCENT of its new hot
+ * objects came back HOT/WARM, and the response times and DB responses until then compared to the second half of the
+ * phase before. {json} is set to the JSON array of the shifts */
+void print_shift_results(std::string &json)
+{
+    std::cout << "\nPopularity shifts (" << (shift_mode == 1 ? "rotate by " + std::to_string(shift_size) + " objects" : std::string("shuffle")) << " every " << shift_interval_seconds << "s): ";
+    std::cout << "time until the new objects of the " << shift_track << " most popular came back HOT/WARM, and the responses until " << SHIFT_CLASSIFIED_PERCENT << "% of them did" << std::endl;
+    std::cout << "(avg. response time from the intended time of request, DB responses) compared to the second half of the phase before" << std::endl;
+    std::cout << "shift   time s  new hot  HOT/WARM    p50 ms    p" << SHIFT_CLASSIFIED_PERCENT << " ms   avg us    DB %  before: avg us    DB %" << std::endl;
 
-        rtm.lock();
-        if (request_times.count(request_id)) {
-            auto request_time = request_times.at(request_id);
-            request_times.erase(request_id);
-            rtm.unlock();
+    const int64_t duration_ns = (int64_t)test_duration_seconds * 1000000000;
+    json.clear();
+    for (size_t p = 0; p < shifts.size(); p++) {
+        const popularity_shift &shift = shifts[p];
+        int64_t phase_end_ns = p + 1 < shifts.size() ? shifts[p + 1].time_ns : duration_ns;
 
-            uint32_t response_time_us = std::chrono::duration_cast<std::chrono::microseconds>(receive_time - request_time).count();
+        std::vector<int64_t> times;
+        for (uint32_t i = shift.first_hot; i < shift.first_hot + shift.num_hot; i++) {
+            if (shift_classified_ns[i] != INT64_MAX) {
+                times.push_back(shift_classified_ns[i] - shift.time_ns);
+            }
+        }
+        std::sort(times.begin(), times.end());
+        auto classified_after = [&times, &shift](double percent) {
+            size_t n = (size_t)std::ceil(shift.num_hot * percent / 100.0);
+            return n > 0 && n <= times.size() ? times[n - 1] / 1e6 : -1.0;
+        };
+        double p50_ms = classified_after(50);
+        double done_ms = classified_after(SHIFT_CLASSIFIED_PERCENT);
 
-            response_list.emplace_back(response_record{
-                .request_id = request_id,
-                .timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(receive_time - start_time).count(),
-                .response_time_us = response_time_us,
-                .letheinfo_hdr = (uint16_t)data[7],  // TODO: Add data[6] if needed in the future
-                .is_hit = is_hit
-            });
-        } else {
-            rtm.unlock();
+        // responses until the reclassification was done (or the end of the phase), and in the second half of the phase before
+        shift_bin window = sum_shift_bins(shift.time_ns, done_ms >= 0 ? shift.time_ns + (int64_t)(done_ms * 1e6) : phase_end_ns);
+        shift_bin before = {0, 0, 0};
+        if (p > 0) {
+            before = sum_shift_bins((shifts[p - 1].time_ns + shift.time_ns) / 2, shift.time_ns);
         }
+        double window_avg_us = window.count ? (double)window.sum_us / window.count : -1;
+        double window_db_percent = window.count ? 100.0 * window.db_responses / window.count : -1;
+        double before_avg_us = before.count ? (double)before.sum_us / before.count : -1;
+        double before_db_percent = before.count ? 100.0 * before.db_responses / before.count : -1;
+
+        auto column = [](double value, const char *format) {
+            char text[32];
+            snprintf(text, sizeof(text), format, value);
+            return value >= 0 ? std::string(text) : std::string("-");
+        };
+        char line[256];
+        snprintf(line, sizeof(line), "%5zu %8.3f %8u %9zu %9s %9s %8s %7s %15s %7s", p, shift.time_ns / 1e9, shift.num_hot, times.size(),
+            column(p50_ms, "%.1f").c_str(), column(done_ms, "%.1f").c_str(), column(window_avg_us, "%.0f").c_str(),
+            column(window_db_percent, "%.2f").c_str(), column(before_avg_us, "%.0f").c_str(), column(before_db_percent, "%.2f").c_str());
+        std::cout << line << std::endl;
+
+        snprintf(line, sizeof(line), "%s{\"time_s\": %f, \"new_hot_objects\": %u, \"classified\": %zu, \"reclassification_p50_ms\": %f, \"reclassification_ms\": %f, \"avg_us\": %f, \"db_percent\": %f, \"before_avg_us\": %f, \"before_db_percent\": %f}",
+            json.empty() ? "" : ", ", shift.time_ns / 1e9, shift.num_hot, times.size(), p50_ms, done_ms, window_avg_us, window_db_percent, before_avg_us, before_db_percent);
+        json += line;
     }
 }
 
-/* print the test results in human- and computer-readable form to stdout */
-void print_results()
-{
-    // Calculate results
-    int num_hits = 0;
-    int num_misses = 0;
-    uint64_t response_time_sum = 0;
-    int num_cold_responses = 0;
-    int num_warm1_responses = 0;
-    int num_warm2_responses = 0;
-    int num_hot_responses = 0;
-    int num_database_responses = 0;
-    int num_cache_miss_db_hit = 0;
-    int num_cache_responses = 0;
+const char *lb_strategy_names[4] = {"off", "ketama", "p2c", "hotkey"};
 
-    for (auto resp : response_list) {
-        if (resp.is_hit) {
-            num_hits++;
-
-            int hotness = resp.letheinfo_hdr & 0b00000111;
-            if (hotness == 0)
-                num_cold_responses++;
-            else if (hotness == 1)
-                num_warm1_responses++;
-            else if (hotness == 2)
-                num_hot_responses++;
-            else if (hotness == 3)
-                num_warm2_responses++;
-            else
-                std::cout << "HOTness unknown: " << hotness << std::endl;
-
-            bool is_db_response = (resp.letheinfo_hdr >> 4) & 1;
-            if (is_db_response && hotness == 0)
-                num_database_responses++;
-            else if (is_db_response && hotness != 0)
-                num_cache_miss_db_hit++;
-            else
-                num_cache_responses++;
+/* client-side balancing: builds the ketama ring of the caches and looks up the home cache of every object */
+void prepare_client_balancing(int count)
+{
+    std::vector<std::string> names;
+    for (const ip::udp::endpoint &cache : lb_caches) {
+        names.push_back(cache.address().to_string() + ":" + std::to_string(cache.port()));
+    }
+    ketama_build(lb_ring, names);
+    lb_home_cache.resize(count);
+    for (int i = 0; i < count; i++) {
+        lb_home_cache[i] = ketama_lookup(lb_ring, object_key(i), key_length);
+    }
 
-        } else {
-            num_misses++;
-        }
+    std::cout << "Client-side load balancing: " << lb_strategy_names[lb_strategy] << " over " << lb_caches.size() << " caches (";
+    for (size_t i = 0; i < names.size(); i++) {
+        std::cout << (i > 0 ? ", " : "") << names[i];
+    }
+    std::cout << ") - Database: " << memc_host << ":" << memc_uport;
+    if (lb_strategy == 3) {
+        std::cout << " - Hot keys: " << lb_hot_keys << " of a top-" << lb_topk_capacity << " per client, updated every " << lb_interval_ms << "ms";
+    }
+    std::cout << std::endl;
+}
 
-        response_time_sum += resp.response_time_us;
+/* prints the GETs of every cache and the look-aside requests of client-side balancing and appends them to {json} */
+void print_balancing_results(std::string &json)
+{
+    int num_caches = lb_caches.size();
+    uint64_t sum = 0;
+    uint32_t max = 0;
+    std::string cache_json;
+    std::cout << "Client-side balancing (" << lb_strategy_names[lb_strategy] << "): GETs per cache";
+    for (int i = 0; i < num_caches; i++) {
+        std::cout << " " << lb_caches[i] << ": " << lb_cache_requests[i];
+        sum += lb_cache_requests[i];
+        max = std::max(max, lb_cache_requests[i]);
+        cache_json += (i > 0 ? ", " : "") + std::to_string(lb_cache_requests[i]);
     }
+    double imbalance = sum > 0 ? max / ((double)sum / num_caches) : 0;
+    std::cout << " - imbalance (max/mean): " << imbalance << std::endl;
+    std::cout << "Cache misses fetched from the database: " << num_db_fetches << " - look-aside SETs: " << num_lookaside_sets << " - DELETEs to the caches after writes: " << num_invalidations << std::endl;
+
+    char line[512];
+    snprintf(line, sizeof(line), ", \"lb_strategy\": \"%s\", \"num_caches\": %d, \"cache_requests\": [%s], \"cache_load_imbalance\": %f, \"num_db_fetches\": %u, \"num_lookaside_sets\": %u, \"num_invalidations\": %u",
+        lb_strategy_names[lb_strategy], num_caches, cache_json.c_str(), imbalance, num_db_fetches, num_lookaside_sets, num_invalidations);
+    json = line;
+}
+
+/* print the test results in human- and computer-readable form to stdout */
+void print_results()
+{
+    // Calculate results (counts of the latency histograms)
+    uint32_t num_hits = latency[LAT_HIT].count;
+    uint32_t num_misses = latency[LAT_MISS].count;
+    uint32_t num_cold_responses = latency[LAT_COLD].count;
+    uint32_t num_warm1_responses = latency[LAT_WARM1].count;
+    uint32_t num_warm2_responses = latency[LAT_WARM2].count;
+    uint32_t num_hot_responses = latency[LAT_HOT].count;
+    uint32_t num_database_responses = latency[LAT_DB_COLD].count;
+    uint32_t num_cache_miss_db_hit = latency[LAT_DB_CACHE_MISS].count;
+    uint32_t num_cache_responses = latency[LAT_CACHE].count;
+    uint32_t num_unknown_hotness = num_hits - num_cold_responses - num_warm1_responses - num_warm2_responses - num_hot_responses;
 
-    auto num_responses_received = num_hits + num_misses;
-    auto avg_response_time = response_time_sum / num_responses_received;
-    float hit_rate = (float)num_hits / (float)num_responses_received;
-    float miss_rate = (float)num_misses / (float)num_responses_received;
+    uint32_t num_write_responses = latency[LAT_SET].count + latency[LAT_DELETE].count;
+    uint32_t num_stale_reads = latency[LAT_STALE].count;
+
+    auto num_responses_received = num_hits + num_misses + num_write_responses;
+    auto avg_response_time = hist_mean(latency[LAT_ALL]);
+    auto avg_intended_response_time = hist_mean(latency[LAT_INTENDED]);
+    float hit_rate = (float)num_hits / (float)(num_hits + num_misses);
+    float miss_rate = (float)num_misses / (float)(num_hits + num_misses);
     auto lost_requests = num_requests - num_responses_received;
     auto lost_requests_percent = (float)lost_requests / (float)num_requests * 100.0;
+    double send_rate = num_requests / send_duration_seconds;
+    double avg_send_lag_us = num_requests ? sum_send_lag_ns / 1000.0 / num_requests : 0;
+    double goodput = num_value_bytes / send_duration_seconds;  // value bytes per second
+    double response_rate = num_responses_received / send_duration_seconds;
 
     // Print results human-readable
     std::cout << "\n ===== Results =====" << std::endl;
     std::cout << num_requests << " requests were made and " << num_responses_received <<" responses were received. ";
     std::cout << "Lost " << lost_requests << " requests (" << lost_requests_percent << "%)" << std::endl;
+    std::cout << "Send rate: " << send_rate << " requests/s (" << send_duration_seconds << "s)";
+    if (batch_size > 1) {
+        std::cout << " - " << num_batches << " batches of up to " << batch_size << " requests (avg. " << (num_batches ? (double)num_requests / num_batches : 0) << ")";
+    }
+    std::cout << std::endl;
+    if (num_clients > 0) {
+        std::cout << "Closed loop: " << num_clients << " virtual clients, max. " << (max_outstanding > 0 ? max_outstanding : num_clients) << " requests without response, ";
+        std::cout << "think time " << think_time_us << "us - Wait for a free request slot: avg. " << avg_send_lag_us << "us, max. " << max_send_lag_ns / 1000 << "us - ";
+        std::cout << "Requests given up after " << REQUEST_TIMEOUT_MS << "ms: " << num_client_timeouts << std::endl;
+    } else {
+        std::cout << "Target rate: " << target_request_rate << " requests/s - achieved " << send_rate / target_request_rate * 100.0 << "% - ";
+        std::cout << "Send lag behind schedule: avg. " << avg_send_lag_us << "us, max. " << max_send_lag_ns / 1000 << "us" << std::endl;
+    }
+    std::cout << "Late responses (after " << REQUEST_TIMEOUT_MS << "ms or to a reused request id): " << num_late_responses << " - ";
+    std::cout << "Requests expired by request id reuse: " << num_expired_requests << std::endl;
+    std::cout << "Invalid responses (truncated, malformed or wrong value length): " << num_invalid_responses << " - ";
+    std::cout << "Incomplete responses (datagrams missing): " << num_incomplete_responses << " - ";
+    std::cout << "Responses of more than one datagram: " << num_multi_datagram_responses << std::endl;
+    std::cout << "Goodput: " << goodput / 1e6 << " MB/s of values - " << response_rate << " responses/s" << std::endl;
     std::cout << "Of received responses: Hit-rate: " << hit_rate * 100.0 << "% (" << num_hits << ") - ";
     std::cout << "Miss-rate: " << miss_rate * 100.0 << "% (" << num_misses << ")" << std::endl;
-    std::cout << "The average response time was " << avg_response_time << " microseconds" << std::endl;
+    std::cout << "The average response time was " << avg_response_time << " microseconds (" << avg_intended_response_time << " microseconds from the intended time of request)" << std::endl;
+    if (object_versions != nullptr) {
+        const latency_histogram &stale = latency[LAT_STALE];
+        std::cout << "Writes (" << set_percent << "% SET, " << delete_percent << "% DELETE, exptime " << object_exptime << "s): " << num_sets << " SETs and " << num_deletes << " DELETEs sent - ";
+        std::cout << latency[LAT_SET].count << "/" << latency[LAT_DELETE].count << " responses, avg. " << hist_mean(latency[LAT_SET]) << "/" << hist_mean(latency[LAT_DELETE]) << "us - failed: " << num_write_failures << std::endl;
+        std::cout << "Stale reads: " << num_stale_reads << " of " << num_hits << " hits (" << (num_hits ? 100.0 * num_stale_reads / num_hits : 0) << "%), " << num_stale_cache_reads << " from a cache";
+        if (stale.count > 0) {
+            std::cout << " - stale for avg. " << hist_mean(stale) << "us, p99 " << hist_percentile(stale, 99) << "us, max. " << stale.max << "us after the newer write was acknowledged";
+        }
+        std::cout << std::endl;
+    }
+    if (timestamping_mode != 0) {
+        const latency_histogram &k = latency[LAT_KERNEL];
+        std::cout << "Kernel timestamps (" << (timestamping_mode == 2 ? "hardware" : "software") << "): " << num_tx_timestamps << " transmit timestamps, ";
+        std::cout << k.count << " of " << num_responses_received << " responses measured";
+        if (k.count > 0) {
+            std::cout << " - response time between the timestamps (network and server): avg. " << hist_mean(k) << "us, p50 " << hist_percentile(k, 50) << "us, p99 " << hist_percentile(k, 99) << "us";
+            std::cout << " - avg. " << (int64_t)avg_response_time - (int64_t)hist_mean(k) << "us in the load generator (sending, receiving, scheduling)";
+        }
+        std::cout << std::endl;
+    }
     std::cout << "HOT: " << num_hot_responses << " - WARM1: " << num_warm1_responses << " - WARM2: " << num_warm2_responses << " - COLD: " << num_cold_responses << std::endl;
-    std::cout << "DB+COLD: " << num_database_responses << " - DB+WARM/HOT(Cache Miss): " << num_cache_miss_db_hit << " - Cache+WARM/HOT: " << num_cache_responses << "\n" << std::endl;
+    if (num_unknown_hotness > 0) {
+        std::cout << "HOTness unknown: " << num_unknown_hotness << std::endl;
+    }
+    std::cout << "DB+COLD: " << num_database_responses << " - DB+WARM/HOT(Cache Miss): " << num_cache_miss_db_hit << " - Cache+WARM/HOT: " << num_cache_responses << std::endl;
+
+    // Response time percentiles of every class with responses (microseconds)
+    std::string latency_json;
+    std::cout << "\nResponse times (us):  count      avg      p50      p90      p99    p99.9      max" << std::endl;
+    for (int c = 0; c < NUM_LATENCY_CLASSES; c++) {
+        const latency_histogram &h = latency[c];
+        if (h.count == 0) {
+            continue;
+        }
+        char line[256];
+        sprintf(line, "%-17s %9lu %8lu %8u %8u %8u %8u %8u", latency_class_names[c], h.count, hist_mean(h),
+            hist_percentile(h, 50), hist_percentile(h, 90), hist_percentile(h, 99), hist_percentile(h, 99.9), h.max);
+        std::cout << line << std::endl;
+
+        sprintf(line, "%s\"%s\": {\"count\": %lu, \"avg\": %lu, \"p50\": %u, \"p90\": %u, \"p99\": %u, \"p999\": %u, \"max\": %u}",
+            latency_json.empty() ? "" : ", ", latency_class_names[c], h.count, hist_mean(h),
+            hist_percentile(h, 50), hist_percentile(h, 90), hist_percentile(h, 99), hist_percentile(h, 99.9), h.max);
+        latency_json += line;
+    }
+    std::cout << std::endl;
+
+    std::string shifts_json;
+    if (shift_mode != 0) {
+        print_shift_results(shifts_json);
+        shifts_json = ", \"popularity_shifts\": [" + shifts_json + "]";
+    }
+
+    std::string lb_json;
+    if (lb_strategy != 0) {
+        print_balancing_results(lb_json);
+    }
+
+    std::string writes_json;
+    if (object_versions != nullptr) {
+        char line[512];
+        snprintf(line, sizeof(line), ", \"set_percent\": %d, \"delete_percent\": %d, \"exptime\": %d, \"num_sets\": %u, \"num_deletes\": %u, \"num_write_responses\": %u, \"num_write_failures\": %u, \"num_stale_reads\": %u, \"num_stale_cache_reads\": %u, \"stale_read_percent\": %f",
+            set_percent, delete_percent, object_exptime, num_sets, num_deletes, num_write_responses, num_write_failures, num_stale_reads, num_stale_cache_reads, num_hits ? 100.0 * num_stale_reads / num_hits : 0);
+        writes_json = line;
+    }
 
     // Print results computer-readable (JSON)
-    char str[1024];
-    sprintf(str, "{\"testprogram\": \"mcloadgen_static\", \"num_objects\": %d, \"duration\": %d, \"min_value_size\": %d, \"max_value_size\": %d, \"exp_dist_mean\": %f, \"exp_dist_lambda\": %f, \"num_requests\": %u, \"num_responses_received\": %u, \"num_hits\": %u, \"num_misses\": %u, \"num_hot_responses\": %u, \"num_warm1_responses\": %u, \"num_warm2_responses\": %u, \"num_cold_responses\": %u, \"num_database_responses\": %u, \"num_cache_miss_db_hit\": %u, \"num_cache_responses\": %u, \"avg_response_time_us\": %lu}",
-        num_objects, test_duration_seconds, value_size_min, value_size_max, exp_dist_mean, exp_dist_lambda, num_requests, num_responses_received, num_hits, num_misses, num_hot_responses, num_warm1_responses, num_warm2_responses, num_cold_responses, num_database_responses, num_cache_miss_db_hit, num_cache_responses, avg_response_time);
+    std::string str(8192 + latency_json.size() + shifts_json.size() + writes_json.size() + lb_json.size(), '\0');
+    int len = snprintf(&str[0], str.size(), "{\"testprogram\": \"mcloadgen_static\", \"num_objects\": %d, \"seed\": %lu, \"num_sender_threads\": %d, \"batch_size\": %d, \"duration\": %d, \"min_value_size\": %d, \"max_value_size\": %d, \"fill_transport\": \"%s\", \"fill_duration_s\": %f, \"fill_rate_sps\": %f, \"num_fill_lost\": %u, \"num_objects_verified\": %d, \"exp_dist_mean\": %f, \"exp_dist_lambda\": %f, \"num_requests\": %u, \"send_rate_rps\": %f, \"target_rate_rps\": %f, \"avg_send_lag_us\": %f, \"max_send_lag_us\": %ld, \"num_clients\": %d, \"max_outstanding\": %d, \"think_time_us\": %d, \"num_client_timeouts\": %u, \"num_responses_received\": %u, \"num_late_responses\": %u, \"num_expired_requests\": %u, \"num_invalid_responses\": %u, \"num_incomplete_responses\": %u, \"num_multi_datagram_responses\": %u, \"response_rate_rps\": %f, \"goodput_bps\": %f, \"num_hits\": %u, \"num_misses\": %u, \"num_hot_responses\": %u, \"num_warm1_responses\": %u, \"num_warm2_responses\": %u, \"num_cold_responses\": %u, \"num_database_responses\": %u, \"num_cache_miss_db_hit\": %u, \"num_cache_responses\": %u, \"avg_response_time_us\": %lu, \"avg_intended_response_time_us\": %lu, \"clock\": \"%s\", \"timestamping\": \"%s\", \"num_tx_timestamps\": %u, \"io_backend\": \"%s\", \"latency_us\": {%s}%s%s%s}",
+        num_objects, object_seed, num_sender_threads, batch_size, test_duration_seconds, value_size_min, value_size_max, fill_mode == 1 ? "tcp" : "udp", fill_duration_seconds, fill_write_seconds > 0 ? num_fill_sets / fill_write_seconds : 0, num_fill_lost, num_objects_verified, exp_dist_mean, exp_dist_lambda, num_requests, send_rate, target_request_rate, avg_send_lag_us, max_send_lag_ns / 1000, num_clients, max_outstanding > 0 ? max_outstanding : num_clients, think_time_us, num_client_timeouts, num_responses_received, num_late_responses, num_expired_requests, num_invalid_responses, num_incomplete_responses, num_multi_datagram_responses, response_rate, goodput, num_hits, num_misses, num_hot_responses, num_warm1_responses, num_warm2_responses, num_cold_responses, num_database_responses, num_cache_miss_db_hit, num_cache_responses, avg_response_time, avg_intended_response_time, clock_source == 1 ? "tsc" : "chrono", timestamping_mode == 2 ? "hardware" : timestamping_mode == 1 ? "software" : "off", num_tx_timestamps, io_backend == 2 ? "packet" : io_backend == 1 ? "uring" : "asio", latency_json.c_str(), shifts_json.c_str(), writes_json.c_str(), lb_json.c_str());
+    str.resize(len);
     std::cout << "COMPUTER_READABLE: " << str << std::endl;
 }
 
@@ -490,30 +3682,85 @@ void generate_csv(const std::string filename)
 {
     std::ofstream csvf(filename);
 
-    csvf << "timestamp_us,request_id,response_time_us,is_hit,hotness,db_response,cache_id\n";
+    csvf << "timestamp_us,request_id,response_time_us,is_hit,hotness,db_response,cache_id,intended_response_time_us\n";
 
     for (auto resp : response_list) {
         int hotness = resp.letheinfo_hdr & 0b00000111;
         bool db_response = (resp.letheinfo_hdr >> 4) & 1;
         int cache_id = (resp.letheinfo_hdr >> 5) & 0b00000111;
 
-        csvf << resp.timestamp_us << "," << resp.request_id << "," << resp.response_time_us << "," << resp.is_hit << "," << hotness << "," << db_response << "," << cache_id << ",\n";
+        csvf << resp.timestamp_us << "," << resp.request_id << "," << resp.response_time_us << "," << resp.is_hit << "," << hotness << "," << db_response << "," << cache_id << "," << resp.intended_response_time_us << ",\n";
     }
 
     csvf.close();
 }
 
+/* parses "<ip>[:<port>]" into {host} and {port} ({port} is kept if not given) */
+bool parse_endpoint(const std::string &s, std::string &host, int &port)
+{
+    size_t colon = s.find(':');
+    host = s.substr(0, colon);
+    if (colon != std::string::npos) {
+        port = atoi(s.c_str() + colon + 1);
+    }
+    boost::system::error_code err;
+    ip::address_v4::from_string(host, err);
+    return !err && port > 0 && port < 65536;
+}
+
 bool parse_cmdline(int argc, char const *argv[])
 {
     if (argc < 7) {
-        std::cout << "Error. Syntax: " << argv[0] << " <ip e.g. 127.0.0.1> <distribution> <number of objects> <Max requests limit> <Run ID> <Zipf alpha, e.g. 99 for 0.99>" << std::endl;
-        std::cout << "Available distributions: 0=Exponential inter-request times 1=Zipf popularity per object 2=Uniform" << std::endl;
+        std::cout << "Error. Syntax: " << argv[0] << " <ip[:port] e.g. 127.0.0.1> <distribution> <number of objects> <Max requests limit> <Run ID> <Zipf alpha, e.g. 99 for 0.99> [options]" << std::endl;
+        std::cout << "Available distributions: 0=Exponential inter-request times 1=Zipf popularity per object 2=Uniform 3=Trace replay (--trace)" << std::endl;
+        std::cout << "Options: --threads=<n> number of sender threads (default " << NUM_SENDER_THREADS << ")" << std::endl;
+        std::cout << "         --batch=<n> requests per sendmmsg/responses per recvmmsg, 1=no batching (default " << IO_BATCH_SIZE << ")" << std::endl;
+        std::cout << "         --batch-timeout=<us> maximum time a request waits for its batch to be sent (default " << IO_BATCH_TIMEOUT_US << ")" << std::endl;
+        std::cout << "         --arrival=constant|poisson inter-arrival times of distribution 1 and 2 (default " << (ARRIVAL_PROCESS == 1 ? "poisson" : "constant") << ")" << std::endl;
+        std::cout << "         --records[=bin|csv] record every response in test/mclgs_results<Run ID>.bin (streamed while the test runs) or .csv" << std::endl;
+        std::cout << "         --fill=udp|tcp transport of the fill phase: windowed UDP SETs or pipelined TCP SETs with noreply (default " << (FILL_MODE == 1 ? "tcp" : "udp") << ")" << std::endl;
+        std::cout << "         --fill-verify=0|1 verify that all objects are present after the fill phase and write missing objects again (default 1)" << std::endl;
+        std::cout << "         --value-size=<min>-<max> range of the value sizes in bytes (default " << VALUE_SIZE_MIN << "-" << VALUE_SIZE_MAX << ")" << std::endl;
+        std::cout << "         --seed=<n> seed of the objects, values and request sequences (default random)" << std::endl;
+        std::cout << "         --zipf-scramble spread the most popular Zipf ranks over the objects with a random permutation" << std::endl;
+        std::cout << "         --clients=<n> closed loop with n virtual clients, each sends its next request after the response to the previous one (distribution 1 and 2)" << std::endl;
+        std::cout << "         --max-outstanding=<n> closed loop: maximum number of requests without response (default one per client)" << std::endl;
+        std::cout << "         --think-time=<us> closed loop: time a client waits after a response before its next request (default 0)" << std::endl;
+        std::cout << "         --ramp=<start>:<step> ramp mode: raise the request rate from <start> by <step> requests/s per step of " << RAMP_STEP_SECONDS << "s until the SLO is broken (distribution 1 and 2)" << std::endl;
+        std::cout << "         --ramp-step-time=<s> ramp mode: duration of a step (default " << RAMP_STEP_SECONDS << ")" << std::endl;
+        std::cout << "         --slo-p99=<us> ramp mode: maximum p99 response time from the intended time of request (default " << RAMP_SLO_P99_US << ")" << std::endl;
+        std::cout << "         --max-loss=<percent> ramp mode: maximum percentage of lost requests (default " << RAMP_MAX_LOSS_PERCENT << ")" << std::endl;
+        std::cout << "         --telemetry[=<file>] write live metrics in Prometheus text format to <file> (default test/mclgs_metrics<Run ID>.prom) while the test runs" << std::endl;
+        std::cout << "         --telemetry-interval=<ms> interval of the live metrics (default " << TELEMETRY_INTERVAL_MS << ")" << std::endl;
+        std::cout << "         --clock=chrono|tsc clock of the userspace timestamps, tsc = calibrated time stamp counter (default " << (CLOCK_SOURCE == 1 ? "tsc" : "chrono") << ")" << std::endl;
+        std::cout << "         --timestamping=off|software|hardware also measure the response times between kernel/NIC timestamps (SO_TIMESTAMPING, default off)" << std::endl;
+        std::cout << "         --io=asio|uring|packet network backend: blocking sockets with a receive thread per socket, or io_uring with one thread sending and receiving (default " << (IO_BACKEND == 1 ? "uring" : "asio") << ")" << std::endl;
+        std::cout << "         --io=packet --interface=<name> raw Ethernet frames through AF_PACKET rings on the interface, one thread sending and receiving (needs CAP_NET_RAW)" << std::endl;
+        std::cout << "         --dst-mac=<aa:bb:cc:dd:ee:ff> raw frames: destination MAC address (default from the neighbour table)" << std::endl;
+        std::cout << "         --shift=rotate|shuffle distribution 1: popularity phases, the Zipf ranks move to other objects every --shift-interval" << std::endl;
+        std::cout << "         --shift-interval=<s> popularity shifts: duration of a phase (default " << SHIFT_INTERVAL_SECONDS << ")" << std::endl;
+        std::cout << "         --shift-size=<n> rotate: objects the ranks move per shift (default --shift-track)" << std::endl;
+        std::cout << "         --churn=<objects/s> rotate: objects per second the ranks move, sets --shift-size" << std::endl;
+        std::cout << "         --shift-track=<n> popularity shifts: most popular ranks whose reclassification is measured (default " << SHIFT_TRACK_RANKS << ")" << std::endl;
+        std::cout << "         --trace=<file> distribution 3: request trace to replay, CSV (timestamp in seconds, key[, value size]) or binary (see --trace-save)" << std::endl;
+        std::cout << "         --trace-speed=<factor> distribution 3: replay speed, the inter-arrival times of the trace are divided by it (default 1)" << std::endl;
+        std::cout << "         --trace-columns=<time>,<key>[,<value size>] distribution 3: columns of a CSV trace, counted from 0 (default 0,1)" << std::endl;
+        std::cout << "         --trace-save=<file> distribution 3: write the replayed requests of a CSV trace as binary trace, which is replayed without parsing" << std::endl;
+        std::cout << "         --mix=<get>:<set>:<delete> mixed workload: percentages of GET, SET and DELETE requests, measures stale reads (default 100:0:0)" << std::endl;
+        std::cout << "         --exptime=<s> exptime of the SETs of the fill phase and the mixed workload (default 0 = never)" << std::endl;
+        std::cout << "         --lb=ketama|p2c|hotkey --caches=<ip>[:<port>],... client-side load balancing over the caches, the server <ip> is the database" << std::endl;
+        std::cout << "         --hot-keys=<n> hotkey: keys replicated on all caches per client (default " << LB_HOT_KEYS << ")" << std::endl;
+        std::cout << "         --topk-capacity=<n> hotkey: keys tracked by the top-K of a client (default " << LB_TOPK_CAPACITY << ")" << std::endl;
+        std::cout << "         --topk-interval=<ms> hotkey: interval of the hot key updates (default " << LB_INTERVAL_MS << ")" << std::endl;
         return false;
     }
 
-    memc_host = argv[1];
+    if (!parse_endpoint(argv[1], memc_host, memc_uport)) {
+        std::cout << "Invalid server " << argv[1] << std::endl;
+        return false;
+    }
     strcpy(memc_config, "--SERVER=");
-    strcat(memc_config, argv[1]);
+    strcat(memc_config, memc_host.c_str());
     strcat(memc_config, ":");
     strcat(memc_config, std::to_string(memc_tport).c_str());
 
@@ -527,13 +3774,290 @@ bool parse_cmdline(int argc, char const *argv[])
 
     alpha = (double)std::stoi(argv[6]) / 100.0;
 
+    std::random_device rd;
+    object_seed = (uint64_t)rd() << 32 | rd();
+
+    // optional arguments "--name=value"
+    for (int i = 7; i < argc; i++) {
+        std::string arg = argv[i];
+        std::string name = arg.substr(0, arg.find('='));
+        std::string value = arg.find('=') != std::string::npos ? arg.substr(arg.find('=') + 1) : "";
+
+        if (name == "--threads") {
+            num_sender_threads = std::stoi(value);
+        } else if (name == "--batch") {
+            batch_size = std::stoi(value);
+        } else if (name == "--batch-timeout") {
+            batch_timeout_us = std::stoi(value);
+        } else if (name == "--records") {
+            if (value.empty() || value == "bin") {
+                record_mode = 1;
+            } else if (value == "csv") {
+                record_mode = 2;
+            } else {
+                std::cout << "Unknown record format " << value << " (bin or csv)" << std::endl;
+                return false;
+            }
+        } else if (name == "--arrival") {
+            if (value == "constant") {
+                arrival_process = 0;
+            } else if (value == "poisson") {
+                arrival_process = 1;
+            } else {
+                std::cout << "Unknown arrival process " << value << " (constant or poisson)" << std::endl;
+                return false;
+            }
+        } else if (name == "--fill") {
+            if (value == "udp") {
+                fill_mode = 0;
+            } else if (value == "tcp") {
+                fill_mode = 1;
+            } else {
+                std::cout << "Unknown fill transport " << value << " (udp or tcp)" << std::endl;
+                return false;
+            }
+        } else if (name == "--fill-verify") {
+            fill_verify = value.empty() || std::stoi(value) != 0;
+        } else if (name == "--value-size") {
+            value_size_min = std::stoi(value.substr(0, value.find('-')));
+            value_size_max = std::stoi(value.substr(value.find('-') + 1));
+        } else if (name == "--seed") {
+            object_seed = std::stoull(value);
+        } else if (name == "--zipf-scramble") {
+            zipf_scramble = value.empty() || std::stoi(value) != 0;
+        } else if (name == "--clients") {
+            num_clients = std::stoi(value);
+        } else if (name == "--max-outstanding") {
+            max_outstanding = std::stoi(value);
+        } else if (name == "--think-time") {
+            think_time_us = std::stoi(value);
+        } else if (name == "--ramp") {
+            ramp_start_rps = std::stoi(value.substr(0, value.find(':')));
+            ramp_step_rps = value.find(':') != std::string::npos ? std::stoi(value.substr(value.find(':') + 1)) : 0;
+            if (ramp_start_rps < 1 || ramp_step_rps < 1) {
+                std::cout << "Ramp start and step must be at least 1 request/s" << std::endl;
+                return false;
+            }
+        } else if (name == "--ramp-step-time") {
+            ramp_step_seconds = std::stoi(value);
+        } else if (name == "--slo-p99") {
+            slo_p99_us = std::stoi(value);
+        } else if (name == "--max-loss") {
+            max_loss_percent = std::stod(value);
+        } else if (name == "--telemetry") {
+            telemetry_file = value.empty() ? "test/mclgs_metrics" + std::to_string(run_id) + ".prom" : value;
+        } else if (name == "--telemetry-interval") {
+            telemetry_interval_ms = std::stoi(value);
+        } else if (name == "--clock") {
+            if (value == "chrono") {
+                clock_source = 0;
+            } else if (value == "tsc") {
+                clock_source = 1;
+            } else {
+                std::cout << "Unknown clock " << value << " (chrono or tsc)" << std::endl;
+                return false;
+            }
+        } else if (name == "--timestamping") {
+            if (value == "off") {
+                timestamping_mode = 0;
+            } else if (value.empty() || value == "software") {
+                timestamping_mode = 1;
+            } else if (value == "hardware") {
+                timestamping_mode = 2;
+            } else {
+                std::cout << "Unknown timestamping mode " << value << " (off, software or hardware)" << std::endl;
+                return false;
+            }
+        } else if (name == "--io") {
+            if (value == "asio") {
+                io_backend = 0;
+            } else if (value == "uring") {
+                io_backend = 1;
+            } else if (value == "packet") {
+                io_backend = 2;
+            } else {
+                std::cout << "Unknown network backend " << value << " (asio, uring or packet)" << std::endl;
+                return false;
+            }
+        } else if (name == "--interface") {
+            packet_interface = value;
+        } else if (name == "--dst-mac") {
+            uint8_t mac[6];
+            if (!packet_parse_mac(value.c_str(), mac)) {
+                std::cout << "Invalid MAC address " << value << std::endl;
+                return false;
+            }
+            packet_dst_mac = value;
+        } else if (name == "--shift") {
+            if (value == "rotate") {
+                shift_mode = 1;
+            } else if (value == "shuffle") {
+                shift_mode = 2;
+            } else {
+                std::cout << "Unknown popularity shift " << value << " (rotate or shuffle)" << std::endl;
+                return false;
+            }
+        } else if (name == "--shift-interval") {
+            shift_interval_seconds = std::stod(value);
+        } else if (name == "--shift-size") {
+            shift_size = std::stoi(value);
+        } else if (name == "--churn") {
+            churn_rate = std::stod(value);
+        } else if (name == "--shift-track") {
+            shift_track = std::stoi(value);
+        } else if (name == "--trace") {
+            trace_filename = value;
+        } else if (name == "--trace-speed") {
+            trace_speed = std::stod(value);
+        } else if (name == "--trace-columns") {
+            int n = sscanf(value.c_str(), "%d,%d,%d", &trace_columns[0], &trace_columns[1], &trace_columns[2]);
+            if (n < 2 || trace_columns[0] < 0 || trace_columns[1] < 0 || trace_columns[0] == trace_columns[1]) {
+                std::cout << "Invalid trace columns " << value << " (<time>,<key>[,<value size>])" << std::endl;
+                return false;
+            }
+            if (n == 2) {
+                trace_columns[2] = -1;
+            }
+        } else if (name == "--trace-save") {
+            trace_save_filename = value;
+        } else if (name == "--mix") {
+            int get_percent;
+            if (sscanf(value.c_str(), "%d:%d:%d", &get_percent, &set_percent, &delete_percent) != 3 || get_percent < 0 || set_percent < 0 || delete_percent < 0 || get_percent + set_percent + delete_percent != 100) {
+                std::cout << "Invalid mix " << value << " (<get>:<set>:<delete> percentages that sum up to 100)" << std::endl;
+                return false;
+            }
+        } else if (name == "--exptime") {
+            object_exptime = std::stoi(value);
+        } else if (name == "--lb") {
+            auto it = std::find(lb_strategy_names + 1, lb_strategy_names + 4, value);
+            if (it == lb_strategy_names + 4) {
+                std::cout << "Unknown load balancing strategy " << value << " (ketama, p2c or hotkey)" << std::endl;
+                return false;
+            }
+            lb_strategy = it - lb_strategy_names;
+        } else if (name == "--caches") {
+            lb_caches.clear();
+            for (size_t begin = 0; begin <= value.size();) {
+                size_t end = std::min(value.find(',', begin), value.size());
+                std::string host;
+                int port = memc_uport;
+                if (!parse_endpoint(value.substr(begin, end - begin), host, port)) {
+                    std::cout << "Invalid cache " << value.substr(begin, end - begin) << std::endl;
+                    return false;
+                }
+                lb_caches.emplace_back(ip::address::from_string(host), port);
+                begin = end + 1;
+            }
+        } else if (name == "--hot-keys") {
+            lb_hot_keys = std::stoi(value);
+        } else if (name == "--topk-capacity") {
+            lb_topk_capacity = std::stoi(value);
+        } else if (name == "--topk-interval") {
+            lb_interval_ms = std::stoi(value);
+        } else {
+            std::cout << "Unknown option " << arg << std::endl;
+            return false;
+        }
+    }
+
+    if (num_sender_threads < 1 || (num_sender_threads > num_objects && distribution_type != 3)) {
+        std::cout << "Number of sender threads must be between 1 and the number of objects" << std::endl;
+        return false;
+    }
+    if (batch_size < 1 || batch_size > 1024) {
+        std::cout << "Batch size must be between 1 and 1024" << std::endl;
+        return false;
+    }
+    if (value_size_min < 1 || value_size_max < value_size_min || value_size_max > 1024 * 1024) {
+        std::cout << "Value sizes must be between 1 and 1048576 bytes and min <= max" << std::endl;
+        return false;
+    }
+    if ((num_clients > 0 || ramp_start_rps > 0) && (distribution_type == 0 || distribution_type == 3)) {
+        std::cout << "Closed loop and ramp mode need distribution 1 or 2" << std::endl;
+        return false;
+    }
+    if (num_clients < 0 || (num_clients > 0 && num_clients < num_sender_threads) || num_clients > num_sender_threads * REQUEST_TABLE_SIZE / 2) {
+        std::cout << "Number of virtual clients must be at least the number of sender threads and at most " << REQUEST_TABLE_SIZE / 2 << " per thread" << std::endl;
+        return false;
+    }
+    if (max_outstanding < 0 || (max_outstanding > 0 && (num_clients == 0 || max_outstanding < num_sender_threads))) {
+        std::cout << "Maximum of outstanding requests needs --clients and must be at least the number of sender threads" << std::endl;
+        return false;
+    }
+    if (ramp_start_rps > 0 && (num_clients > 0 || record_mode != 0)) {
+        std::cout << "Ramp mode can't be combined with --clients or --records" << std::endl;
+        return false;
+    }
+    if (shift_mode != 0 && (distribution_type != 1 || ramp_start_rps > 0)) {
+        std::cout << "Popularity shifts need distribution 1 and can't be combined with --ramp" << std::endl;
+        return false;
+    }
+    if (shift_mode != 0 && (shift_interval_seconds < 0.001 || shift_track < 1 || shift_track > num_objects || shift_size < 0 || churn_rate < 0)) {
+        std::cout << "Shift interval must be at least 0.001s and the tracked ranks between 1 and the number of objects" << std::endl;
+        return false;
+    }
+    if (churn_rate > 0) {
+        shift_size = std::max(1, (int)std::lround(churn_rate * shift_interval_seconds));
+    } else if (shift_size == 0) {
+        shift_size = shift_track;
+    }
+    if (distribution_type == 3 && trace_filename.empty()) {
+        std::cout << "Trace replay (distribution 3) needs --trace" << std::endl;
+        return false;
+    }
+    if (!(trace_speed > 0)) {
+        std::cout << "Trace speed must be greater than 0" << std::endl;
+        return false;
+    }
+    if (io_backend == 2 && packet_interface.empty()) {
+        std::cout << "Raw frames (--io=packet) need --interface" << std::endl;
+        return false;
+    }
+    if (lb_strategy != 0 && (lb_caches.empty() || lb_caches.size() > LB_MAX_CACHES)) {
+        std::cout << "Client-side load balancing needs 1 to " << LB_MAX_CACHES << " caches (--caches)" << std::endl;
+        return false;
+    }
+    if (lb_strategy == 0 && !lb_caches.empty()) {
+        std::cout << "--caches needs a load balancing strategy (--lb)" << std::endl;
+        return false;
+    }
+    if (lb_strategy != 0 && (io_backend == 2 || batch_size > 1 || value_size_max > WRITE_VALUE_SIZE_MAX)) {
+        std::cout << "Client-side load balancing needs --io=asio or uring, --batch=1 and values of at most " << WRITE_VALUE_SIZE_MAX << " bytes (a look-aside SET must fit into one datagram)" << std::endl;
+        return false;
+    }
+    if (lb_strategy == 3 && (lb_hot_keys < 1 || lb_topk_capacity < lb_hot_keys || lb_interval_ms < 1)) {
+        std::cout << "Hot keys must be at least 1 and at most the top-K capacity, the interval at least 1ms" << std::endl;
+        return false;
+    }
+    if (set_percent + delete_percent > 0 && (io_backend == 2 || value_size_min < WRITE_VERSION_LEN || value_size_max > WRITE_VALUE_SIZE_MAX)) {
+        std::cout << "The mixed workload needs --io=asio or uring and values of " << WRITE_VERSION_LEN << " to " << WRITE_VALUE_SIZE_MAX << " bytes (the version is in the value, a SET must fit into one datagram)" << std::endl;
+        return false;
+    }
+    if (object_exptime < 0) {
+        std::cout << "Exptime must be at least 0" << std::endl;
+        return false;
+    }
+    if (io_backend != 0 && timestamping_mode != 0) {
+        std::cout << "Kernel timestamps need --io=asio" << std::endl;
+        return false;
+    }
+    if (telemetry_interval_ms < 10) {
+        std::cout << "Telemetry interval must be at least 10ms" << std::endl;
+        return false;
+    }
+    if (ramp_step_seconds < 1) {
+        std::cout << "Ramp step time must be at least 1 second" << std::endl;
+        return false;
+    }
+    if (ramp_start_rps > 0) {
+        test_duration_seconds = ramp_step_seconds;
+    }
+
     return true;
 }
 
 int main(int argc, char const *argv[])
 {
-    std::srand(static_cast<long unsigned int>(time(0)));
-
     std::cout << "Very fast Memcached load generator" << std::endl;
     std::cout << "David Munstein @ NCS, October 2022" << std::endl;
 
@@ -542,29 +4066,59 @@ int main(int argc, char const *argv[])
         return 1;
     }
 
-    std::cout << "Variables: " << num_objects << " objects - Time: " << test_duration_seconds << "s - Run ID: " << run_id << " - Total request limit: " << total_request_limit << std::endl;
+    std::cout << "Variables: " << num_objects << " objects - Time: " << test_duration_seconds << "s - Run ID: " << run_id << " - Total request limit: " << total_request_limit << " - Sender threads: " << num_sender_threads << " - Batch size: " << batch_size << std::endl;
     switch (distribution_type) {
         case 0:
             std::cout << "Distribution: Exponential inter-request times" << std::endl;
             break;
         case 1:
-            std::cout << "Distribution: Zipf object popularities - Alpha: " << alpha << std::endl;
+            std::cout << "Distribution: Zipf object popularities - Alpha: " << alpha << (zipf_scramble ? " - Scrambled ranks" : "") << std::endl;
+            if (shift_mode != 0) {
+                std::cout << "Popularity shifts: " << (shift_mode == 1 ? "rotate by " + std::to_string(shift_size) + " objects" : std::string("shuffle")) << " every " << shift_interval_seconds << "s - Tracked ranks: " << shift_track << std::endl;
+            }
             break;
         case 2:
             std::cout << "Distribution: Uniform object popularities" << std::endl;
             break;
+        case 3:
+            std::cout << "Distribution: Trace replay of " << trace_filename << " - Speed: " << trace_speed << std::endl;
+            break;
         default:
             std::cout << "No distribution no. " << distribution_type << std::endl;
             return 1;
             break;
     }
 
-    // allocate, generate (random) and sort objects
-    kv_object *objects = (kv_object *)malloc(num_objects * sizeof(kv_object));
-    generate_random_kvobjects(objects, num_objects);
+    // calibrate the TSC against std::chrono, so TSC and kernel timestamps can be compared
+    if (clock_source == 1) {
+        if (!tsc_available()) {
+            std::cout << "No invariant TSC, using std::chrono" << std::endl;
+            clock_source = 0;
+        } else {
+            tsc_calibrate(tsc, chrono_now_ns, TSC_CALIBRATION_MS);
+            std::cout << "Clock: TSC at " << 1.0 / tsc.ns_per_tick << " GHz" << std::endl;
+        }
+    }
+
+    // generate (random) and sort objects
+    auto generate_start = std::chrono::steady_clock::now();
+    object_store *objects = new object_store();
+    if (distribution_type == 3) {
+        if (!load_trace(objects)) {
+            return 1;
+        }
+        std::cout << "Trace: " << trace_num_requests << " requests of " << num_objects << " keys (" << (trace.binary ? "binary" : "CSV") << ") over " << trace_span_ns / 1e9 << "s, replayed in " << trace_span_ns / trace_speed / 1e9 << "s" << std::endl;
+    } else {
+        generate_objects(objects, num_objects);
+    }
     if (distribution_type == 0) {
-        sort_objects_irt_asc(objects, num_objects);
+        sort_objects_irt_asc(objects);
     }
+    build_request_arena(objects);
+    if (lb_strategy != 0) {
+        prepare_client_balancing(num_objects);
+    }
+    std::cout << "Generated " << num_objects << " objects in " << std::chrono::duration<double>(std::chrono::steady_clock::now() - generate_start).count() << "s - Seed: " << object_seed << std::endl;
 
     io_service io_service;
     ip::udp::socket *socket = new ip::udp::socket(io_service);
@@ -574,29 +4128,36 @@ int main(int argc, char const *argv[])
     // write all objects to cache
     mc_fill_objects(socket, memc_remote, objects, num_objects);
 
-    // receive responses on separate thread
-    // TODO: Use Mutex or single thread with non-blocking receive instead (tested current solution and works good enough for now)
-    boost::thread receive_memc_response_thread(receive_memc_response_task, socket, memc_remote);
-
-    // schedule sending requests (exponential static inter-request times)
-    if (distribution_type == 0) {
-        schedule_task(objects, num_objects, socket, memc_remote);
-    }
-    // schedule sending requests (Zipf popularity per object)
-    else if (distribution_type == 1) {
-        zipf_task(objects, num_objects, socket, memc_remote, total_request_limit);
+    // mixed workload: the fill phase wrote version 0 of every object
+    if (set_percent + delete_percent > 0) {
+        object_versions = new object_version[num_objects];
+        for (int i = 0; i < num_objects; i++) {
+            object_versions[i].next.store(0, std::memory_order_relaxed);
+            object_versions[i].acked.store(0, std::memory_order_relaxed);
+        }
+        write_base_ns = now_ns();
+        std::cout << "Mixed workload: " << 100 - set_percent - delete_percent << "% GET, " << set_percent << "% SET, " << delete_percent << "% DELETE - Exptime: " << object_exptime << "s" << std::endl;
     }
-    // schedule sending requests (Uniform)
-    else {
-        uniform_task(objects, num_objects, socket, memc_remote, total_request_limit);
+
+    // ramp mode: raise the request rate step by step until the SLO is broken
+    if (ramp_start_rps > 0) {
+        run_ramp(io_service, objects, num_objects);
+        print_ramp_results();
+        std::cout << "test run " << run_id << " completed." << std::endl;
+        return 0;
     }
 
+    // send requests and receive responses (one socket and receive thread per sender thread)
+    run_sender_workers(io_service, objects, num_objects);
+
     // print results
     print_results();
 
     // store results to csv file
-    std::string file_name = "test/mclgs_results" + std::to_string(run_id) + ".csv";
-    generate_csv(file_name);
+    if (record_mode == 2) {
+        std::string file_name = "test/mclgs_results" + std::to_string(run_id) + ".csv";
+        generate_csv(file_name);
+    }
 
     std::cout << "test run " << run_id << " completed." << std::endl;
     return 0;
@@ -36,20 +36,17 @@ with open(filename, 'w') as f:
      writer.writerow(header)
 
 fraw = open(raw_csv, 'w')
-fraw.write('timestamp_us,request_id,response_time_us,is_hit,hotness,db_response,cache_id\n')
+fraw.write('timestamp_us,request_id,response_time_us,is_hit,hotness,db_response,cache_id,intended_response_time_us\n')
 
 for i in range(RUNS):
     if alpha == 0:
-        EXE = f'../mcloadgen_static/mcloadgen_static 10.0.0.4 2 {num_objects} {num_requests} {i} 0'
+        EXE = f'../mcloadgen_static/mcloadgen_static 10.0.0.4 2 {num_objects} {num_requests} {i} 0 --records'
     else:
-        EXE = f'../mcloadgen_static/mcloadgen_static 10.0.0.4 1 {num_objects} {num_requests} {i} {alpha}'
+        EXE = f'../mcloadgen_static/mcloadgen_static 10.0.0.4 1 {num_objects} {num_requests} {i} {alpha} --records'
     os.system(EXE)
-    run_filename = f'test/mclgs_results' + str(i) + '.csv'
-    with open(run_filename) as f:
-        f.readline()
-        fraw.write(f.read())
-        fraw.write('\n')
-    EVA = '../mcloadgen_static/mcloadgen_evaluate.py ' + run_filename + ' ' + filename
+    run_filename = f'test/mclgs_results' + str(i) + '.bin'
+    fraw.flush()
+    EVA = '../mcloadgen_static/mcloadgen_evaluate ' + run_filename + ' ' + filename + ' --csv=' + raw_csv
     os.system(EVA)
 
     time.sleep(3)
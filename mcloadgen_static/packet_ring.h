@@ -0,0 +1,252 @@
+#pragma once
+
+// AF_PACKET rings for the raw-frame mode of the Memcached load generator (mcloadgen_static.cpp)
+//
+// A packet socket bound to one interface with a PACKET_MMAP (TPACKET_V2) receive and transmit ring in one
+// mapping. Requests are complete Ethernet/IPv4/UDP frames written into the transmit ring (packet_tx_frame/
+// packet_tx_commit) and handed to the driver with one send() per batch (packet_tx_kick), past the qdisc and
+// the UDP stack of the kernel. The receive ring gets the frames that pass a classic BPF filter (the datagrams
+// from one UDP port to another), read without system calls (packet_rx_frame/packet_rx_release).
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <linux/filter.h>
+#include <linux/if_packet.h>
+#include <net/ethernet.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Ethernet, IPv4 (without options) and UDP header of a frame
+#define PACKET_HEADER_LEN (14 + 20 + 8)
+
+struct packet_ring
+{
+    int fd;
+    char *map;          // receive ring followed by the transmit ring
+    size_t map_size;
+    unsigned frame_size;
+    unsigned frame_nr;  // frames per ring
+    char *rx;
+    char *tx;
+    unsigned rx_index;  // next frame to read
+    unsigned tx_index;  // next frame to fill
+};
+
+/* MAC and IPv4 address (network byte order) of interface {ifname} and whether it is a loopback interface */
+inline bool packet_interface_addresses(const char *ifname, uint8_t mac[6], uint32_t *ip, bool *loopback)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        return false;
+    }
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, ifname, IFNAMSIZ - 1);
+    bool ok = ioctl(fd, SIOCGIFFLAGS, &ifr) == 0;
+    *loopback = ifr.ifr_flags & IFF_LOOPBACK;
+    ok = ok && ioctl(fd, SIOCGIFHWADDR, &ifr) == 0;
+    memcpy(mac, ifr.ifr_hwaddr.sa_data, 6);
+    ok = ok && ioctl(fd, SIOCGIFADDR, &ifr) == 0;
+    *ip = ((struct sockaddr_in *)&ifr.ifr_addr)->sin_addr.s_addr;
+    close(fd);
+    return ok;
+}
+
+/* parses a MAC address "aa:bb:cc:dd:ee:ff" */
+inline bool packet_parse_mac(const char *s, uint8_t mac[6])
+{
+    return sscanf(s, "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx", &mac[0], &mac[1], &mac[2], &mac[3], &mac[4], &mac[5]) == 6;
+}
+
+/* MAC address of {ip} (network byte order) on interface {ifname} from the neighbour table of the kernel.
+ * The entry exists after the kernel has sent a datagram to {ip} (e.g. in the fill phase) */
+inline bool packet_lookup_neighbour(uint32_t ip, const char *ifname, uint8_t mac[6])
+{
+    FILE *f = fopen("/proc/net/arp", "r");
+    if (f == nullptr) {
+        return false;
+    }
+    char line[256], address[64], hw_address[64], device[IFNAMSIZ + 1];
+    unsigned hw_type, flags;
+    bool found = false;
+    fgets(line, sizeof(line), f);  // column names
+    while (!found && fgets(line, sizeof(line), f) != nullptr) {
+        if (sscanf(line, "%63s 0x%x 0x%x %63s %*s %16s", address, &hw_type, &flags, hw_address, device) != 5) {
+            continue;
+        }
+        struct in_addr a;
+        found = (flags & 0x2) && inet_pton(AF_INET, address, &a) == 1 && a.s_addr == ip && strcmp(device, ifname) == 0 && packet_parse_mac(hw_address, mac);
+    }
+    fclose(f);
+    return found;
+}
+
+/* adds {len} bytes to a one's complement sum of big-endian 16-bit words (an odd last byte is padded with zero) */
+inline uint32_t packet_csum_add(uint32_t sum, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    for (size_t i = 0; i + 1 < len; i += 2) {
+        sum += (p[i] << 8) | p[i + 1];
+    }
+    if (len & 1) {
+        sum += p[len - 1] << 8;
+    }
+    return sum;
+}
+
+/* Internet checksum of a sum of packet_csum_add (0 is sent as 0xFFFF, 0 means no UDP checksum) */
+inline uint16_t packet_csum_fold(uint32_t sum)
+{
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    uint16_t csum = ~sum & 0xFFFF;
+    return csum == 0 ? 0xFFFF : csum;
+}
+
+/* opens a packet socket on interface {ifname} with a receive and a transmit ring of {frame_nr} frames of
+ * {frame_size} bytes each (powers of two). Only IPv4/UDP datagrams from port {src_port} to port {dst_port}
+ * are received. Returns false (errno set) if the socket can't be set up (e.g. without CAP_NET_RAW) */
+inline bool packet_ring_open(packet_ring &p, const char *ifname, unsigned frame_nr, unsigned frame_size, uint16_t src_port, uint16_t dst_port)
+{
+    memset(&p, 0, sizeof(p));
+    unsigned ifindex = if_nametoindex(ifname);
+    if (ifindex == 0) {
+        return false;
+    }
+    // protocol 0: nothing is received before the filter is attached and the socket is bound
+    p.fd = socket(AF_PACKET, SOCK_RAW, 0);
+    if (p.fd < 0) {
+        return false;
+    }
+
+    // ether type IPv4, protocol UDP, not a fragment, source port, destination port (offsets of the Ethernet frame)
+    struct sock_filter code[] = {
+        BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 12),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ETHERTYPE_IP, 0, 8),
+        BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 23),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_UDP, 0, 6),
+        BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 20),
+        BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x1FFF, 4, 0),
+        BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 14),
+        BPF_STMT(BPF_LD | BPF_W | BPF_IND, 14),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, (uint32_t)src_port << 16 | dst_port, 0, 1),
+        BPF_STMT(BPF_RET | BPF_K, 0xFFFF),
+        BPF_STMT(BPF_RET | BPF_K, 0),
+    };
+    struct sock_fprog filter = {sizeof(code) / sizeof(code[0]), code};
+    int version = TPACKET_V2;
+    int one = 1;
+    struct tpacket_req req;
+    req.tp_frame_size = frame_size;
+    req.tp_frame_nr = frame_nr;
+    req.tp_block_size = std::max<unsigned>(frame_size, getpagesize());
+    req.tp_block_nr = frame_nr / (req.tp_block_size / frame_size);
+    if (setsockopt(p.fd, SOL_SOCKET, SO_ATTACH_FILTER, &filter, sizeof(filter)) < 0 ||
+        setsockopt(p.fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0 ||
+        setsockopt(p.fd, SOL_PACKET, PACKET_LOSS, &one, sizeof(one)) < 0 ||
+        setsockopt(p.fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0 ||
+        setsockopt(p.fd, SOL_PACKET, PACKET_TX_RING, &req, sizeof(req)) < 0) {
+        int err = errno;
+        close(p.fd);
+        errno = err;
+        return false;
+    }
+    // frames go to the driver directly (no qdisc), available since Linux 3.14
+    setsockopt(p.fd, SOL_PACKET, PACKET_QDISC_BYPASS, &one, sizeof(one));
+
+    p.frame_size = frame_size;
+    p.frame_nr = frame_nr;
+    p.map_size = 2 * (size_t)req.tp_block_size * req.tp_block_nr;
+    p.map = (char *)mmap(nullptr, p.map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, p.fd, 0);
+    if (p.map == MAP_FAILED) {
+        int err = errno;
+        close(p.fd);
+        errno = err;
+        return false;
+    }
+    p.rx = p.map;
+    p.tx = p.map + p.map_size / 2;
+
+    struct sockaddr_ll addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = htons(ETH_P_IP);
+    addr.sll_ifindex = ifindex;
+    if (bind(p.fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        int err = errno;
+        munmap(p.map, p.map_size);
+        close(p.fd);
+        errno = err;
+        return false;
+    }
+    return true;
+}
+
+inline void packet_ring_close(packet_ring &p)
+{
+    munmap(p.map, p.map_size);
+    close(p.fd);
+}
+
+/* next free frame of the transmit ring (data from the Ethernet header on, up to frame_size - TPACKET2_HDRLEN
+ * bytes), nullptr if the ring is full */
+inline char *packet_tx_frame(packet_ring &p)
+{
+    tpacket2_hdr *hdr = (tpacket2_hdr *)(p.tx + (size_t)p.tx_index * p.frame_size);
+    if (__atomic_load_n(&hdr->tp_status, __ATOMIC_ACQUIRE) & (TP_STATUS_SEND_REQUEST | TP_STATUS_SENDING)) {
+        return nullptr;
+    }
+    return (char *)hdr + TPACKET2_HDRLEN - sizeof(struct sockaddr_ll);
+}
+
+/* queues the frame of packet_tx_frame with {len} bytes, sent by the next packet_tx_kick */
+inline void packet_tx_commit(packet_ring &p, unsigned len)
+{
+    tpacket2_hdr *hdr = (tpacket2_hdr *)(p.tx + (size_t)p.tx_index * p.frame_size);
+    hdr->tp_len = len;
+    __atomic_store_n(&hdr->tp_status, TP_STATUS_SEND_REQUEST, __ATOMIC_RELEASE);
+    p.tx_index = (p.tx_index + 1) & (p.frame_nr - 1);
+}
+
+/* sends the queued frames without waiting for the driver. Returns the result of send() */
+inline int packet_tx_kick(packet_ring &p)
+{
+    return send(p.fd, nullptr, 0, MSG_DONTWAIT);
+}
+
+/* next received frame (from the Ethernet header on) with its length on the wire {len} and captured length
+ * {snaplen}, nullptr if there is none */
+inline char *packet_rx_frame(packet_ring &p, unsigned *len, unsigned *snaplen)
+{
+    tpacket2_hdr *hdr = (tpacket2_hdr *)(p.rx + (size_t)p.rx_index * p.frame_size);
+    if (!(__atomic_load_n(&hdr->tp_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER)) {
+        return nullptr;
+    }
+    *len = hdr->tp_len;
+    *snaplen = hdr->tp_snaplen;
+    return (char *)hdr + hdr->tp_mac;
+}
+
+/* gives the frame of packet_rx_frame back to the kernel */
+inline void packet_rx_release(packet_ring &p)
+{
+    tpacket2_hdr *hdr = (tpacket2_hdr *)(p.rx + (size_t)p.rx_index * p.frame_size);
+    __atomic_store_n(&hdr->tp_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+    p.rx_index = (p.rx_index + 1) & (p.frame_nr - 1);
+}
+
+/* makes a socket drop everything it would receive (the UDP socket whose port the raw frames use) */
+inline bool packet_drop_all(int fd)
+{
+    struct sock_filter code[] = {BPF_STMT(BPF_RET | BPF_K, 0)};
+    struct sock_fprog filter = {1, code};
+    return setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &filter, sizeof(filter)) == 0;
+}
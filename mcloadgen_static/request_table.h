@@ -0,0 +1,157 @@
+#pragma once
+
+// Lock-free request id correlation table for the Memcached load generator (mcloadgen_static.cpp)
+//
+// Each sender thread owns one table with a slot for every 16-bit Memcached request id. The sender
+// writes a slot when sending a request, the receive thread claims it when the response arrives.
+// A slot holds a generation counter, so a response can never claim a slot that was rewritten
+// while it was read, and the object index, so late responses to an earlier request with the same
+// (wrapped) request id can be told apart by comparing the key of the response before claiming.
+
+#include <atomic>
+#include <cstdint>
+
+#define REQUEST_TABLE_SIZE 65536
+
+// slot flags (lower two bits of request_slot::state), bit 2 is SLOT_REISSUED, the generation counter starts at bit 3
+#define SLOT_FREE 0
+#define SLOT_WRITING 1
+#define SLOT_PENDING 2
+#define SLOT_DONE 3
+#define SLOT_REISSUED 4  // the request was sent again after its first response (client-side balancing: cache miss -> database)
+
+// operations of request_slot::write (mixed workload): write = operation << 30 | version, 0 = GET
+#define WRITE_SET 1
+#define WRITE_DELETE 2
+#define WRITE_VERSION_MASK 0x3FFFFFFF
+
+/* 32 byte slot: two slots share a cache line and no slot crosses a cache line */
+struct alignas(32) request_slot
+{
+    std::atomic<uint32_t> state;        // generation << 3 | SLOT_REISSUED | slot flag
+    std::atomic<uint32_t> object;       // index of the requested object
+    std::atomic<int64_t> request_ns;    // time of request in nanoseconds
+    std::atomic<int64_t> intended_ns;   // time the request should have been sent (open-loop schedule)
+    std::atomic<uint32_t> write;        // SET/DELETE: operation << 30 | version, 0: GET
+    std::atomic<uint32_t> route;        // client-side balancing: letheinfo of the server the request was sent to
+};
+
+struct alignas(64) request_table
+{
+    request_slot slots[REQUEST_TABLE_SIZE];
+};
+
+/* result of claiming a slot for a received response */
+enum claim_result
+{
+    CLAIM_OK,        // response belongs to a pending request
+    CLAIM_UNKNOWN    // no pending request for this request id (duplicate, already expired or foreign)
+};
+
+/* stores a new request in the slot of {request_id}. Returns true if the slot still held a request
+ * without response, which is overwritten (expired) by this request. Only the owning sender thread writes. */
+inline bool request_table_store(request_table *table, uint16_t request_id, uint32_t object, int64_t request_ns, int64_t intended_ns, uint32_t write = 0, uint32_t route = 0)
+{
+    request_slot &slot = table->slots[request_id];
+    uint32_t generation = (slot.state.load(std::memory_order_relaxed) >> 3) + 1;
+
+    // exchange, not store: the receive thread may claim the old request at the same time
+    uint32_t old_state = slot.state.exchange(generation << 3 | SLOT_WRITING, std::memory_order_acquire);
+    slot.object.store(object, std::memory_order_relaxed);
+    slot.request_ns.store(request_ns, std::memory_order_relaxed);
+    slot.intended_ns.store(intended_ns, std::memory_order_relaxed);
+    slot.write.store(write, std::memory_order_relaxed);
+    slot.route.store(route, std::memory_order_relaxed);
+    slot.state.store(generation << 3 | SLOT_PENDING, std::memory_order_release);
+
+    return (old_state & 3) == SLOT_PENDING;
+}
+
+/* reads the pending request of {request_id} without claiming it: its object, request time, intended request time and,
+ * if the pointers aren't nullptr, its operation and version, its route and whether it was reissued. Returns the slot
+ * state to pass to request_table_claim, or SLOT_FREE if no request is pending. The response can be checked against
+ * the request (key, timeout) before it is claimed, so a late response to an older request with the same request id
+ * leaves the request pending */
+inline uint32_t request_table_read(request_table *table, uint16_t request_id, uint32_t *object, int64_t *request_ns, int64_t *intended_ns,
+                                   uint32_t *write = nullptr, uint32_t *route = nullptr, bool *reissued = nullptr)
+{
+    request_slot &slot = table->slots[request_id];
+    uint32_t state = slot.state.load(std::memory_order_acquire);
+    if ((state & 3) != SLOT_PENDING) {
+        return SLOT_FREE;
+    }
+
+    *object = slot.object.load(std::memory_order_relaxed);
+    *request_ns = slot.request_ns.load(std::memory_order_relaxed);
+    *intended_ns = slot.intended_ns.load(std::memory_order_relaxed);
+    if (write != nullptr) {
+        *write = slot.write.load(std::memory_order_relaxed);
+    }
+    if (route != nullptr) {
+        *route = slot.route.load(std::memory_order_relaxed);
+    }
+    if (reissued != nullptr) {
+        *reissued = state & SLOT_REISSUED;
+    }
+    return state;
+}
+
+/* claims the request of {request_id} that request_table_read returned {state} for */
+inline claim_result request_table_claim(request_table *table, uint16_t request_id, uint32_t state)
+{
+    // fails if the sender rewrote the slot in the meantime (generation changed)
+    if ((state & 3) != SLOT_PENDING || !table->slots[request_id].state.compare_exchange_strong(state, (state & ~3u) | SLOT_DONE, std::memory_order_acq_rel)) {
+        return CLAIM_UNKNOWN;
+    }
+    return CLAIM_OK;
+}
+
+/* makes the request of {request_id}, which the receive thread just claimed, pending again with SLOT_REISSUED set, so it
+ * can be sent once more with the same request id. Only the state changes, so it can't collide with the sender thread
+ * rewriting the slot. Returns false if the sender reused the request id meanwhile or it was reissued before */
+inline bool request_table_reissue(request_table *table, uint16_t request_id)
+{
+    request_slot &slot = table->slots[request_id];
+    uint32_t state = slot.state.load(std::memory_order_acquire);
+    if ((state & 3) != SLOT_DONE || (state & SLOT_REISSUED)) {
+        return false;
+    }
+    return slot.state.compare_exchange_strong(state, (state & ~3u) | SLOT_REISSUED | SLOT_PENDING, std::memory_order_acq_rel);
+}
+
+/* removes the pending request of {request_id}, e.g. if it couldn't be sent */
+inline void request_table_release(request_table *table, uint16_t request_id)
+{
+    uint32_t object;
+    int64_t request_ns, intended_ns;
+    request_table_claim(table, request_id, request_table_read(table, request_id, &object, &request_ns, &intended_ns));
+}
+
+/* single-producer single-consumer queue of request ids: the receive thread reports every request that got its
+ * response, the sender thread takes them (closed loop). There are never more than REQUEST_TABLE_SIZE requests
+ * pending, so the queue can't overflow */
+struct alignas(64) completion_queue
+{
+    alignas(64) std::atomic<uint32_t> head;   // next entry read by the sender thread
+    alignas(64) std::atomic<uint32_t> tail;   // next entry written by the receive thread
+    uint16_t request_ids[REQUEST_TABLE_SIZE];
+};
+
+inline void completion_queue_push(completion_queue *queue, uint16_t request_id)
+{
+    uint32_t tail = queue->tail.load(std::memory_order_relaxed);
+    queue->request_ids[tail % REQUEST_TABLE_SIZE] = request_id;
+    queue->tail.store(tail + 1, std::memory_order_release);
+}
+
+/* takes the next completed request id. Returns false if the queue is empty */
+inline bool completion_queue_pop(completion_queue *queue, uint16_t *request_id)
+{
+    uint32_t head = queue->head.load(std::memory_order_relaxed);
+    if (head == queue->tail.load(std::memory_order_acquire)) {
+        return false;
+    }
+    *request_id = queue->request_ids[head % REQUEST_TABLE_SIZE];
+    queue->head.store(head + 1, std::memory_order_release);
+    return true;
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+// Binary result log of the Memcached load generator (mcloadgen_static.cpp), read by mcloadgen_evaluate.cpp
+//
+// File format: a result_log_header followed by fixed-width result_log_records (little endian, no padding
+// between records). The records of one receive thread are in the order the responses were received, the
+// records of different threads are interleaved in chunks, so the file is not sorted by timestamp.
+//
+// The receive threads fill chunks of RESULT_LOG_CHUNK_RECORDS records and hand full chunks to a writer
+// thread, which writes them to the file while the test runs. Only the hand-over of a full chunk takes a
+// lock; recording a response is a copy into the chunk.
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define RESULT_LOG_MAGIC "MCLGSLOG"
+#define RESULT_LOG_VERSION 1
+#define RESULT_LOG_CHUNK_RECORDS 4096
+
+// result_log_record::flags
+#define RESULT_FLAG_HIT 1
+
+struct result_log_header
+{
+    char magic[8];            // RESULT_LOG_MAGIC (not null-terminated)
+    uint32_t version;         // RESULT_LOG_VERSION
+    uint32_t record_size;     // sizeof(result_log_record)
+    uint64_t num_records;     // written when the log is closed, 0 if the test didn't finish
+    int32_t run_id;
+    uint32_t reserved;
+};
+
+struct result_log_record
+{
+    int64_t timestamp_us;                // time of response relative to the start of the test
+    uint32_t response_time_us;
+    uint32_t intended_response_time_us;  // response time from the intended time of request
+    uint16_t request_id;
+    uint8_t letheinfo;                   // hotness (bits 0-2), DB response (bit 4), cache id (bits 5-7)
+    uint8_t flags;                       // RESULT_FLAG_*
+    uint32_t reserved;
+};
+
+static_assert(sizeof(result_log_header) == 32, "result_log_header must be 32 bytes");
+static_assert(sizeof(result_log_record) == 24, "result_log_record must be 24 bytes");
+
+struct result_log_chunk
+{
+    uint32_t len;
+    result_log_record records[RESULT_LOG_CHUNK_RECORDS];
+};
+
+struct result_log
+{
+    FILE *file;
+    uint64_t num_records;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<result_log_chunk *> full_chunks;   // waiting to be written
+    std::vector<result_log_chunk *> free_chunks;  // written, can be reused
+    bool closing;
+    std::thread writer;
+};
+
+/* writer thread: writes full chunks to the file until the log is closed */
+inline void result_log_writer_task(result_log *log)
+{
+    std::unique_lock<std::mutex> lock(log->mutex);
+    while (true) {
+        log->cv.wait(lock, [log] { return log->closing || !log->full_chunks.empty(); });
+        if (log->full_chunks.empty()) {
+            return;  // closing and everything written
+        }
+        result_log_chunk *chunk = log->full_chunks.front();
+        log->full_chunks.pop_front();
+
+        lock.unlock();
+        fwrite(chunk->records, sizeof(result_log_record), chunk->len, log->file);
+        log->num_records += chunk->len;
+        lock.lock();
+
+        log->free_chunks.push_back(chunk);
+    }
+}
+
+/* creates {filename} and starts the writer thread. Returns false if the file can't be created */
+inline bool result_log_open(result_log *log, const char *filename, int32_t run_id)
+{
+    log->file = fopen(filename, "wb");
+    if (log->file == nullptr) {
+        return false;
+    }
+
+    result_log_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, RESULT_LOG_MAGIC, 8);
+    header.version = RESULT_LOG_VERSION;
+    header.record_size = sizeof(result_log_record);
+    header.run_id = run_id;
+    fwrite(&header, sizeof(header), 1, log->file);
+
+    log->num_records = 0;
+    log->closing = false;
+    log->writer = std::thread(result_log_writer_task, log);
+    return true;
+}
+
+/* returns an empty chunk (a written one if available) */
+inline result_log_chunk *result_log_get_chunk(result_log *log)
+{
+    result_log_chunk *chunk = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(log->mutex);
+        if (!log->free_chunks.empty()) {
+            chunk = log->free_chunks.back();
+            log->free_chunks.pop_back();
+        }
+    }
+    if (chunk == nullptr) {
+        chunk = new result_log_chunk();
+    }
+    chunk->len = 0;
+    return chunk;
+}
+
+/* hands {chunk} over to the writer thread */
+inline void result_log_submit(result_log *log, result_log_chunk *chunk)
+{
+    {
+        std::lock_guard<std::mutex> lock(log->mutex);
+        log->full_chunks.push_back(chunk);
+    }
+    log->cv.notify_one();
+}
+
+/* writes the remaining chunks, stores the number of records in the header and closes the file */
+inline void result_log_close(result_log *log)
+{
+    {
+        std::lock_guard<std::mutex> lock(log->mutex);
+        log->closing = true;
+    }
+    log->cv.notify_one();
+    log->writer.join();
+
+    fseek(log->file, offsetof(result_log_header, num_records), SEEK_SET);
+    fwrite(&log->num_records, sizeof(log->num_records), 1, log->file);
+    fclose(log->file);
+
+    for (auto chunk : log->free_chunks) {
+        delete chunk;
+    }
+    log->free_chunks.clear();
+}
@@ -10,3 +10,99 @@
 #define VALUE_SIZE_MAX 300
 
 #define TEST_DURATION_SECONDS 30
+
+// Number of sender threads. Each thread uses its own UDP socket (source port) and receive thread
+#define NUM_SENDER_THREADS 1
+
+// Time in milliseconds to wait for outstanding responses after the last request was sent
+#define RESPONSE_DRAIN_MS 200
+
+// Responses received later than this (in milliseconds) after their request are counted as late, not as response
+#define REQUEST_TIMEOUT_MS 1000
+
+// Batched I/O: requests per sendmmsg and responses per recvmmsg (1 = one syscall per request/response)
+#define IO_BATCH_SIZE 1
+
+// Maximum time in microseconds a queued request waits until its batch is sent
+#define IO_BATCH_TIMEOUT_US 100
+
+// Pacing: sleep until this many microseconds before a request is due and busy-wait for the rest
+#define PACER_SPIN_US 50
+
+// Number of most popular objects whose request count is printed after a Zipf test
+#define ZIPF_PRINT_RANKS 10
+
+// Inter-arrival times of distribution 1 and 2 (open loop): 0 = constant, 1 = Poisson (exponential)
+#define ARRIVAL_PROCESS 0
+
+// Fill phase: 0 = SETs over UDP with a window of outstanding requests, 1 = pipelined SETs with noreply over TCP
+#define FILL_MODE 0
+
+// UDP fill: initial and maximum number of requests without response, and the time after which a request is considered lost
+#define FILL_WINDOW_START 16
+#define FILL_WINDOW_MAX 512
+#define FILL_TIMEOUT_MS 200
+
+// TCP fill: bytes per write, and keys per multi-get of the verification
+#define FILL_TCP_WRITE_SIZE 65536
+#define FILL_TCP_VERIFY_KEYS 100
+
+// Number of times objects the verification didn't find are written again
+#define FILL_REPAIR_PASSES 2
+
+// Receive buffer per datagram in bytes. Memcached sends at most 1400 bytes per datagram, larger datagrams are counted as invalid
+#define RECV_DATAGRAM_SIZE 2048
+
+// Ramp mode: duration of a step in seconds, default p99 response time SLO in microseconds and loss threshold in percent
+#define RAMP_STEP_SECONDS 10
+#define RAMP_SLO_P99_US 1000
+#define RAMP_MAX_LOSS_PERCENT 1.0
+
+// Ramp mode: a step is not sustainable if less than this percentage of its request rate could be sent, and the ramp stops after this many steps
+#define RAMP_MIN_SEND_PERCENT 95
+#define RAMP_MAX_STEPS 100
+
+// Default interval of the live telemetry in milliseconds (see --telemetry)
+#define TELEMETRY_INTERVAL_MS 1000
+
+// Default clock of the userspace timestamps: 0 = std::chrono::high_resolution_clock, 1 = TSC (see --clock)
+#define CLOCK_SOURCE 0
+
+// Time in milliseconds the TSC rate is measured against std::chrono at startup
+#define TSC_CALIBRATION_MS 200
+
+// Network backend: 0 = boost::asio blocking sockets with a receive thread per socket, 1 = io_uring, 2 = raw frames (AF_PACKET, needs --interface)
+#define IO_BACKEND 0
+
+// Submission queue entries of an io_uring and requests in flight per sender thread (power of two)
+#define URING_ENTRIES 4096
+
+// Receive buffers per sender thread of the io_uring backend (power of two, at most 32768)
+#define URING_RECV_BUFFERS 2048
+
+// Raw-frame mode: frames of the transmit and of the receive ring per sender thread (power of two)
+#define PACKET_RING_FRAMES 4096
+
+// Raw-frame mode: size of a ring frame in bytes including the TPACKET_V2 header (power of two, at least the MTU + 64)
+#define PACKET_FRAME_SIZE 2048
+
+// Popularity shifts (see --shift): default duration of a popularity phase in seconds and number of most popular ranks
+// whose reclassification is measured
+#define SHIFT_INTERVAL_SECONDS 10
+#define SHIFT_TRACK_RANKS 100
+
+// Popularity shifts: the reclassification of a shift is complete when this percentage of its new hot objects came
+// back HOT or WARM; response times and DB responses are compared in bins of SHIFT_BIN_MS of intended time of request
+#define SHIFT_CLASSIFIED_PERCENT 90
+#define SHIFT_BIN_MS 10
+
+// Mixed workload (see --mix): largest value size, a SET must fit into one datagram as Memcached drops requests of
+// more than one datagram
+#define WRITE_VALUE_SIZE_MAX 1300
+
+// Client-side load balancing, hotkey strategy (see --lb): keys replicated on all caches per client, keys tracked by
+// the top-K of a client, interval of the hot key updates in milliseconds and decay of the popularities per interval
+#define LB_HOT_KEYS 100
+#define LB_TOPK_CAPACITY 400
+#define LB_INTERVAL_MS 1000
+#define LB_TOPK_DECAY 0.75
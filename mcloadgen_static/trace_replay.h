@@ -0,0 +1,241 @@
+#pragma once
+
+// Request traces of the Memcached load generator (mcloadgen_static.cpp, distribution 3)
+//
+// A trace is a sequence of timestamped requests. It is memory-mapped and read sequentially, so a trace larger than
+// the memory is streamed from the file and never loaded as a whole. Two formats:
+// - CSV: one request per line with the columns separated by ',': the timestamp in seconds (with an optional fraction),
+//   the key and optionally the value size. The columns are selected with trace_file::columns, e.g. 0,1,3 for the
+//   Twitter cache traces ("timestamp,key,key size,value size,client id,operation,TTL"). Lines without a valid
+//   timestamp and key (headers, comments) are skipped.
+// - Binary: a trace_header followed by fixed-width trace_records (little endian) with the keys already mapped to the
+//   indexes 0..num_keys-1, written from a CSV trace by trace_writer (--trace-save). 16 bytes per request and no
+//   parsing or key lookup while replaying.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define TRACE_MAGIC "MCLGTRCE"
+#define TRACE_VERSION 1
+
+struct trace_header
+{
+    char magic[8];           // TRACE_MAGIC (not null-terminated)
+    uint32_t version;        // TRACE_VERSION
+    uint32_t record_size;    // sizeof(trace_record)
+    uint64_t num_records;
+    uint64_t num_keys;
+};
+
+struct trace_record
+{
+    int64_t timestamp_ns;    // relative to the first request of the trace
+    uint32_t key;            // index of the key, 0..num_keys-1 in the order of the first request
+    uint32_t value_size;     // 0: unknown
+};
+
+static_assert(sizeof(trace_header) == 32, "trace_header must be 32 bytes");
+static_assert(sizeof(trace_record) == 16, "trace_record must be 16 bytes");
+
+struct trace_file
+{
+    const char *data;        // the memory-mapped file
+    size_t size;
+    bool binary;
+    const trace_header *header;    // binary: the header and the records
+    const trace_record *records;
+    uint64_t num_records;
+    int columns[3];          // CSV: columns of the timestamp, the key and the value size (-1: none)
+};
+
+/* a request of a trace. CSV: {key} points into the mapped file, binary: {key_index} is set */
+struct trace_request
+{
+    int64_t timestamp_ns;
+    const char *key;
+    size_t key_len;
+    uint32_t key_index;
+    uint32_t value_size;     // 0: unknown
+};
+
+/* position of a reader in a trace, every reader has its own */
+struct trace_cursor
+{
+    size_t pos;              // CSV: byte offset of the next line, binary: index of the next record
+};
+
+/* maps trace {filename} into memory, a binary trace is recognized by its header. Returns false if the file can't be
+ * read or is a binary trace of another version */
+inline bool trace_open(trace_file &t, const char *filename)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    fstat(fd, &st);
+    t.size = st.st_size;
+    void *data = t.size > 0 ? mmap(nullptr, t.size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    madvise(data, t.size, MADV_SEQUENTIAL);
+    t.data = (const char *)data;
+
+    t.header = (const trace_header *)data;
+    t.binary = t.size >= sizeof(trace_header) && memcmp(t.header->magic, TRACE_MAGIC, 8) == 0;
+    if (t.binary) {
+        if (t.header->version != TRACE_VERSION || t.header->record_size != sizeof(trace_record)) {
+            return false;
+        }
+        t.records = (const trace_record *)(t.data + sizeof(trace_header));
+        t.num_records = (t.size - sizeof(trace_header)) / sizeof(trace_record);
+        if (t.header->num_records < t.num_records) {
+            t.num_records = t.header->num_records;
+        }
+    } else {
+        t.records = nullptr;
+        t.num_records = 0;  // counted by the first pass over the trace
+    }
+    return true;
+}
+
+inline void trace_close(trace_file &t)
+{
+    munmap((void *)t.data, t.size);
+}
+
+/* parses the timestamp in seconds [{p}, {end}), e.g. "1589500800" or "12.000345", into nanoseconds */
+inline bool trace_parse_seconds(const char *p, const char *end, int64_t *ns)
+{
+    int64_t seconds = 0;
+    int64_t fraction = 0;
+    int64_t scale = 1000000000;
+    bool digits = false;
+    for (; p < end && *p >= '0' && *p <= '9'; p++) {
+        seconds = seconds * 10 + (*p - '0');
+        digits = true;
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++) {
+            if (scale > 1) {
+                scale /= 10;
+                fraction += (*p - '0') * scale;
+            }
+            digits = true;
+        }
+    }
+    if (!digits || p != end || seconds > INT64_MAX / 1000000000 - 1) {
+        return false;
+    }
+    *ns = seconds * 1000000000 + fraction;
+    return true;
+}
+
+/* parses the line [{p}, {end}) of a CSV trace into {r}, false if it has no valid timestamp and key */
+inline bool trace_parse_line(const trace_file &t, const char *p, const char *end, trace_request &r)
+{
+    if (end > p && end[-1] == '\r') {
+        end--;
+    }
+    const char *field[3] = {nullptr, nullptr, nullptr};
+    const char *field_end[3] = {nullptr, nullptr, nullptr};
+    for (int column = 0; p <= end; column++) {
+        const char *sep = (const char *)memchr(p, ',', end - p);
+        if (sep == nullptr) {
+            sep = end;
+        }
+        for (int i = 0; i < 3; i++) {
+            if (t.columns[i] == column) {
+                field[i] = p;
+                field_end[i] = sep;
+            }
+        }
+        p = sep + 1;
+    }
+    if (field[0] == nullptr || field[1] == nullptr || field_end[1] == field[1] || !trace_parse_seconds(field[0], field_end[0], &r.timestamp_ns)) {
+        return false;
+    }
+    r.key = field[1];
+    r.key_len = field_end[1] - field[1];
+    r.key_index = 0;
+    r.value_size = 0;
+    for (const char *s = field[2]; s != nullptr && s < field_end[2] && *s >= '0' && *s <= '9'; s++) {
+        r.value_size = r.value_size * 10 + (*s - '0');
+    }
+    return true;
+}
+
+/* reads the next request of the trace at cursor {c} into {r}, false at the end of the trace */
+inline bool trace_next(const trace_file &t, trace_cursor &c, trace_request &r)
+{
+    if (t.binary) {
+        if (c.pos >= t.num_records) {
+            return false;
+        }
+        const trace_record &record = t.records[c.pos++];
+        r.timestamp_ns = record.timestamp_ns;
+        r.key = nullptr;
+        r.key_len = 0;
+        r.key_index = record.key;
+        r.value_size = record.value_size;
+        return true;
+    }
+    while (c.pos < t.size) {
+        const char *line = t.data + c.pos;
+        const char *eol = (const char *)memchr(line, '\n', t.size - c.pos);
+        const char *end = eol != nullptr ? eol : t.data + t.size;
+        c.pos = end - t.data + 1;
+        if (trace_parse_line(t, line, end, r)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* writes a binary trace: the records are buffered by stdio, the header is written when the trace is closed */
+struct trace_writer
+{
+    FILE *file;
+    trace_header header;
+    int64_t first_ns;
+};
+
+inline bool trace_writer_open(trace_writer &w, const char *filename)
+{
+    w.file = fopen(filename, "wb");
+    if (w.file == nullptr) {
+        return false;
+    }
+    memcpy(w.header.magic, TRACE_MAGIC, 8);
+    w.header.version = TRACE_VERSION;
+    w.header.record_size = sizeof(trace_record);
+    w.header.num_records = 0;
+    w.header.num_keys = 0;
+    w.first_ns = 0;
+    return fwrite(&w.header, sizeof(w.header), 1, w.file) == 1;
+}
+
+inline void trace_writer_add(trace_writer &w, int64_t timestamp_ns, uint32_t key, uint32_t value_size)
+{
+    if (w.header.num_records == 0) {
+        w.first_ns = timestamp_ns;
+    }
+    trace_record record = {timestamp_ns - w.first_ns, key, value_size};
+    fwrite(&record, sizeof(record), 1, w.file);
+    w.header.num_records++;
+}
+
+/* writes the header with the number of records and {num_keys} and closes the file */
+inline bool trace_writer_close(trace_writer &w, uint64_t num_keys)
+{
+    w.header.num_keys = num_keys;
+    bool ok = fseek(w.file, 0, SEEK_SET) == 0 && fwrite(&w.header, sizeof(w.header), 1, w.file) == 1;
+    return fclose(w.file) == 0 && ok;
+}
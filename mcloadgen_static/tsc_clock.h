@@ -0,0 +1,86 @@
+#pragma once
+
+// Time stamp counter clock for the Memcached load generator (mcloadgen_static.cpp)
+//
+// Reading the TSC takes a few nanoseconds and no system call or vDSO page. The TSC is converted to nanoseconds
+// of a reference clock with a rate calibrated at startup, so TSC timestamps can be mixed with timestamps of the
+// reference clock (e.g. kernel timestamps converted to it). Only used if the CPU has an invariant TSC (constant
+// rate in all P- and C-states, synchronized between cores), see tsc_available.
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+struct tsc_clock
+{
+    uint64_t base_tsc;   // TSC at base_ns
+    int64_t base_ns;     // reference clock at base_tsc
+    double ns_per_tick;
+};
+
+/* true if the CPU has an invariant TSC */
+inline bool tsc_available()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    return (edx >> 8) & 1;
+#else
+    return false;
+#endif
+}
+
+inline uint64_t tsc_read()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/* reads the TSC and {reference_ns}() at the same time: the reference is read between two TSC reads and the
+ * pair with the shortest gap of {tries} is taken */
+template <class Reference>
+inline void tsc_sample(Reference reference_ns, uint64_t *tsc, int64_t *ns, int tries = 16)
+{
+    uint64_t best_gap = UINT64_MAX;
+    int i = 0;
+    do {
+        uint64_t before = tsc_read();
+        int64_t reference = reference_ns();
+        uint64_t after = tsc_read();
+        if (i == 0 || after - before < best_gap) {
+            best_gap = after - before;
+            *tsc = before + (after - before) / 2;
+            *ns = reference;
+        }
+    } while (++i < tries);
+}
+
+/* measures the TSC rate against {reference_ns}() over {calibration_ms} milliseconds */
+template <class Reference>
+inline void tsc_calibrate(tsc_clock &clock, Reference reference_ns, int calibration_ms)
+{
+    uint64_t start_tsc, end_tsc;
+    int64_t start_ns, end_ns;
+    tsc_sample(reference_ns, &start_tsc, &start_ns);
+    std::this_thread::sleep_for(std::chrono::milliseconds(calibration_ms));
+    tsc_sample(reference_ns, &end_tsc, &end_ns);
+
+    clock.ns_per_tick = (double)(end_ns - start_ns) / (double)(end_tsc - start_tsc);
+    clock.base_tsc = end_tsc;
+    clock.base_ns = end_ns;
+}
+
+/* {tsc} in nanoseconds of the reference clock */
+inline int64_t tsc_to_ns(const tsc_clock &clock, uint64_t tsc)
+{
+    return clock.base_ns + (int64_t)((double)(int64_t)(tsc - clock.base_tsc) * clock.ns_per_tick);
+}
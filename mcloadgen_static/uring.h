@@ -0,0 +1,263 @@
+#pragma once
+
+// Minimal io_uring wrapper for the Memcached load generator (mcloadgen_static.cpp), using the raw system calls
+// (no liburing dependency)
+//
+// A ring is used by one thread only: it fills submission queue entries (uring_get_sqe), submits them and waits
+// for completions in one system call (uring_enter) and processes the completion queue without system calls
+// (uring_peek_cqe/uring_cqe_seen). Received datagrams are written by the kernel to a provided buffer ring
+// (uring_buf_ring), from which multishot receives pick a buffer per datagram; processed buffers are given back
+// with uring_buf_ring_add/uring_buf_ring_commit.
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+struct uring
+{
+    int fd;
+    bool disabled;  // created disabled, see uring_enable
+
+    // submission queue (shared with the kernel)
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    io_uring_sqe *sqes;
+    unsigned sqe_tail;       // entries filled by uring_get_sqe, published to the kernel by uring_enter
+    unsigned sqe_submitted;  // entries submitted to the kernel
+
+    // completion queue (shared with the kernel)
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned cq_mask;
+    io_uring_cqe *cqes;
+
+    void *sq_ptr;
+    size_t sq_size;
+    void *cq_ptr;
+    size_t cq_size;
+    size_t sqes_size;
+};
+
+/* buffer ring of {entries} buffers of {buf_size} bytes each, registered as buffer group {bgid} */
+struct uring_buf_ring
+{
+    io_uring_buf_ring *br;
+    size_t ring_size;
+    char *bufs;
+    size_t buf_size;
+    unsigned entries;
+    uint16_t bgid;
+    uint16_t tail;  // buffers added but not yet committed to the kernel
+};
+
+/* sets up a ring with {entries} submission and {cq_entries} completion queue entries (powers of two). The ring
+ * accepts submissions only from the thread that calls uring_enable. Returns false (errno set) if io_uring isn't available */
+inline bool uring_init(uring &r, unsigned entries, unsigned cq_entries)
+{
+    memset(&r, 0, sizeof(r));
+    io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    p.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_R_DISABLED;
+    p.cq_entries = cq_entries;
+    r.fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    r.disabled = true;
+    if (r.fd < 0 && errno == EINVAL) {
+        // kernels before 6.0 don't know IORING_SETUP_SINGLE_ISSUER
+        r.disabled = false;
+        memset(&p, 0, sizeof(p));
+        p.flags = IORING_SETUP_CQSIZE;
+        p.cq_entries = cq_entries;
+        r.fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    }
+    if (r.fd < 0) {
+        return false;
+    }
+
+    r.sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r.cq_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = p.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+        r.sq_size = r.cq_size = std::max(r.sq_size, r.cq_size);
+    }
+    r.sq_ptr = mmap(nullptr, r.sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r.fd, IORING_OFF_SQ_RING);
+    r.cq_ptr = single_mmap ? r.sq_ptr : mmap(nullptr, r.cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r.fd, IORING_OFF_CQ_RING);
+    r.sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+    r.sqes = (io_uring_sqe *)mmap(nullptr, r.sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r.fd, IORING_OFF_SQES);
+    if (r.sq_ptr == MAP_FAILED || r.cq_ptr == MAP_FAILED || r.sqes == MAP_FAILED) {
+        close(r.fd);
+        return false;
+    }
+
+    char *sq = (char *)r.sq_ptr;
+    char *cq = (char *)r.cq_ptr;
+    r.sq_head = (unsigned *)(sq + p.sq_off.head);
+    r.sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    r.sq_mask = *(unsigned *)(sq + p.sq_off.ring_mask);
+    r.sq_entries = p.sq_entries;
+    r.cq_head = (unsigned *)(cq + p.cq_off.head);
+    r.cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    r.cq_mask = *(unsigned *)(cq + p.cq_off.ring_mask);
+    r.cqes = (io_uring_cqe *)(cq + p.cq_off.cqes);
+
+    // submission queue entry i is always at index i of the array
+    unsigned *array = (unsigned *)(sq + p.sq_off.array);
+    for (unsigned i = 0; i < p.sq_entries; i++) {
+        array[i] = i;
+    }
+    r.sqe_tail = r.sqe_submitted = *r.sq_tail;
+    return true;
+}
+
+/* enables a ring on the thread that uses it */
+inline bool uring_enable(uring &r)
+{
+    if (r.disabled && syscall(__NR_io_uring_register, r.fd, IORING_REGISTER_ENABLE_RINGS, nullptr, 0) < 0) {
+        return false;
+    }
+    r.disabled = false;
+    return true;
+}
+
+inline void uring_exit(uring &r)
+{
+    munmap(r.sqes, r.sqes_size);
+    if (r.cq_ptr != r.sq_ptr) {
+        munmap(r.cq_ptr, r.cq_size);
+    }
+    munmap(r.sq_ptr, r.sq_size);
+    close(r.fd);
+}
+
+/* next free submission queue entry (cleared), nullptr if the submission queue is full */
+inline io_uring_sqe *uring_get_sqe(uring &r)
+{
+    unsigned head = __atomic_load_n(r.sq_head, __ATOMIC_ACQUIRE);
+    if (r.sqe_tail - head >= r.sq_entries) {
+        return nullptr;
+    }
+    io_uring_sqe *sqe = &r.sqes[r.sqe_tail & r.sq_mask];
+    r.sqe_tail++;
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+/* number of filled submission queue entries that were not submitted yet */
+inline unsigned uring_pending(const uring &r)
+{
+    return r.sqe_tail - r.sqe_submitted;
+}
+
+/* submits the filled entries and, if {wait_nr} > 0, waits until there are {wait_nr} completions or {timeout_ns} passed
+ * (timeout_ns < 0: no timeout). Returns the number of submitted entries or -errno (-ETIME if the timeout passed) */
+inline int uring_enter(uring &r, unsigned wait_nr, int64_t timeout_ns)
+{
+    unsigned to_submit = r.sqe_tail - r.sqe_submitted;
+    __atomic_store_n(r.sq_tail, r.sqe_tail, __ATOMIC_RELEASE);
+
+    unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+    __kernel_timespec ts;
+    io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    if (wait_nr > 0 && timeout_ns >= 0) {
+        ts.tv_sec = timeout_ns / 1000000000;
+        ts.tv_nsec = timeout_ns % 1000000000;
+        arg.sigmask_sz = _NSIG / 8;
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+        flags |= IORING_ENTER_EXT_ARG;
+    }
+
+    int ret = (int)syscall(__NR_io_uring_enter, r.fd, to_submit, wait_nr, flags, flags & IORING_ENTER_EXT_ARG ? (void *)&arg : nullptr, sizeof(arg));
+    if (ret < 0) {
+        return -errno;
+    }
+    r.sqe_submitted += ret;
+    return ret;
+}
+
+/* oldest completion queue entry, nullptr if there is none */
+inline io_uring_cqe *uring_peek_cqe(uring &r)
+{
+    unsigned head = *r.cq_head;
+    if (head == __atomic_load_n(r.cq_tail, __ATOMIC_ACQUIRE)) {
+        return nullptr;
+    }
+    return &r.cqes[head & r.cq_mask];
+}
+
+/* marks the entry of uring_peek_cqe as processed */
+inline void uring_cqe_seen(uring &r)
+{
+    __atomic_store_n(r.cq_head, *r.cq_head + 1, __ATOMIC_RELEASE);
+}
+
+/* buffer {bid} */
+inline char *uring_buf(uring_buf_ring &b, unsigned bid)
+{
+    return b.bufs + (size_t)bid * b.buf_size;
+}
+
+/* gives buffer {bid} (back) to the kernel, visible after uring_buf_ring_commit */
+inline void uring_buf_ring_add(uring_buf_ring &b, uint16_t bid)
+{
+    // not b.br->bufs: in C++, the empty struct of __DECLARE_FLEX_ARRAY moves bufs to offset 8
+    io_uring_buf &buf = ((io_uring_buf *)b.br)[b.tail & (b.entries - 1)];
+    buf.addr = (uint64_t)(uintptr_t)uring_buf(b, bid);
+    buf.len = (uint32_t)b.buf_size;
+    buf.bid = bid;
+    b.tail++;
+}
+
+inline void uring_buf_ring_commit(uring_buf_ring &b)
+{
+    __atomic_store_n(&b.br->tail, b.tail, __ATOMIC_RELEASE);
+}
+
+/* allocates {entries} (power of two) buffers of {buf_size} bytes, registers them as buffer group {bgid} of {r}
+ * and provides all of them to the kernel. Returns false (errno set) if provided buffer rings aren't available (Linux 5.19) */
+inline bool uring_buf_ring_init(uring &r, uring_buf_ring &b, uint16_t bgid, unsigned entries, size_t buf_size)
+{
+    b.ring_size = entries * sizeof(io_uring_buf);
+    b.br = (io_uring_buf_ring *)mmap(nullptr, b.ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (b.br == MAP_FAILED) {
+        return false;
+    }
+    b.bufs = new char[entries * buf_size];
+    b.buf_size = buf_size;
+    b.entries = entries;
+    b.bgid = bgid;
+    b.tail = 0;
+
+    io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)b.br;
+    reg.ring_entries = entries;
+    reg.bgid = bgid;
+    if (syscall(__NR_io_uring_register, r.fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        int err = errno;
+        munmap(b.br, b.ring_size);
+        delete[] b.bufs;
+        errno = err;
+        return false;
+    }
+    for (unsigned bid = 0; bid < entries; bid++) {
+        uring_buf_ring_add(b, bid);
+    }
+    uring_buf_ring_commit(b);
+    return true;
+}
+
+inline void uring_buf_ring_free(uring_buf_ring &b)
+{
+    munmap(b.br, b.ring_size);
+    delete[] b.bufs;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+// Zipf sampler for the Memcached load generator (mcloadgen_static.cpp)
+//
+// Rejection-inversion sampling (W. Hörmann, G. Derflinger: "Rejection-inversion to generate variates
+// from monotone discrete distributions", 1996): constant setup memory and an expected constant number
+// of steps per sample, independent of the number of objects. Ranks are optionally scrambled with a
+// keyed permutation, so the most popular objects are spread over the key space.
+
+#include <cmath>
+#include <cstdint>
+
+struct zipf_sampler
+{
+    uint64_t n;        // number of ranks
+    double exponent;   // alpha
+    double h_integral_x1;
+    double h_integral_n;
+    double s;
+
+    // rank scrambling: permutation of [0, 2^bits) restricted to [0, n) by cycle walking
+    bool scramble;
+    uint64_t scramble_mask;
+    uint64_t scramble_key;
+};
+
+/* log(1+x)/x, stable for small x */
+inline double zipf_helper1(double x)
+{
+    if (std::fabs(x) > 1e-8) {
+        return std::log1p(x) / x;
+    }
+    return 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+}
+
+/* (exp(x)-1)/x, stable for small x */
+inline double zipf_helper2(double x)
+{
+    if (std::fabs(x) > 1e-8) {
+        return std::expm1(x) / x;
+    }
+    return 1.0 + x * 0.5 * (1.0 + x * (1.0 / 3.0) * (1.0 + 0.25 * x));
+}
+
+/* integral of h(x) = x^-exponent (without constant), also defined for exponent=1 */
+inline double zipf_h_integral(const zipf_sampler &z, double x)
+{
+    double log_x = std::log(x);
+    return zipf_helper2((1.0 - z.exponent) * log_x) * log_x;
+}
+
+inline double zipf_h(const zipf_sampler &z, double x)
+{
+    return std::exp(-z.exponent * std::log(x));
+}
+
+inline double zipf_h_integral_inverse(const zipf_sampler &z, double x)
+{
+    double t = x * (1.0 - z.exponent);
+    if (t < -1.0) {
+        t = -1.0;  // rounding errors
+    }
+    return std::exp(zipf_helper1(t) * x);
+}
+
+/* initializes a sampler for ranks 1..{n} with P(k) ~ 1/k^{exponent} */
+inline void zipf_init(zipf_sampler &z, uint64_t n, double exponent, bool scramble = false, uint64_t scramble_key = 0)
+{
+    z.n = n;
+    z.exponent = exponent;
+    z.h_integral_x1 = zipf_h_integral(z, 1.5) - 1.0;
+    z.h_integral_n = zipf_h_integral(z, n + 0.5);
+    z.s = 2.0 - zipf_h_integral_inverse(z, zipf_h_integral(z, 2.5) - zipf_h(z, 2.0));
+
+    z.scramble = scramble;
+    z.scramble_mask = 1;
+    while (z.scramble_mask < n - 1) {
+        z.scramble_mask = z.scramble_mask << 1 | 1;
+    }
+    z.scramble_key = scramble_key | 1;
+}
+
+/* draws a rank 1..n, {uniform}() returns uniform random numbers in [0, 1) */
+template <class Uniform>
+inline uint64_t zipf_sample_rank(const zipf_sampler &z, Uniform uniform)
+{
+    while (true) {
+        double u = z.h_integral_n + uniform() * (z.h_integral_x1 - z.h_integral_n);
+        double x = zipf_h_integral_inverse(z, u);
+        uint64_t k = (uint64_t)(x + 0.5);
+        if (k < 1) {
+            k = 1;
+        } else if (k > z.n) {
+            k = z.n;
+        }
+        if (k - x <= z.s || u >= zipf_h_integral(z, k + 0.5) - zipf_h(z, (double)k)) {
+            return k;
+        }
+    }
+}
+
+/* keyed permutation of [0, n) (the key must be odd): every step is a bijection on [0, mask], values outside [0, n)
+ * are permuted again (cycle walking) */
+inline uint64_t zipf_permute(const zipf_sampler &z, uint64_t x, uint64_t key)
+{
+    do {
+        x = (x * key) & z.scramble_mask;
+        x ^= x >> 7;
+        x = (x + (key >> 17)) & z.scramble_mask;
+        x ^= (x << 5) & z.scramble_mask;
+        x = (x * 0x9E3779B97F4A7C15ull) & z.scramble_mask;
+        x ^= x >> 11;
+    } while (x >= z.n);
+    return x;
+}
+
+/* maps rank 1..n to an object index 0..n-1: identity, or a keyed permutation if scrambling is enabled */
+inline uint64_t zipf_rank_to_index(const zipf_sampler &z, uint64_t rank)
+{
+    if (!z.scramble) {
+        return rank - 1;
+    }
+    return zipf_permute(z, rank - 1, z.scramble_key);
+}
+
+/* draws an object index 0..n-1 */
+template <class Uniform>
+inline uint64_t zipf_sample(const zipf_sampler &z, Uniform uniform)
+{
+    return zipf_rank_to_index(z, zipf_sample_rank(z, uniform));
+}